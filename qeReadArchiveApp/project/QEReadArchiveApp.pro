@@ -85,12 +85,12 @@ MAKEFILE       = Makefile.$$(EPICS_HOST_ARCH)
 #===========================================================
 # Project files
 #
-HEADERS += \
-   ./rad_control.h
+# The rad sources are shared with the qerad_bench benchmark, see QERadBenchmark.pro
+#
+include (rad_sources.pri)
 
 SOURCES += \
-   ./rad.cpp \
-   ./rad_control.cpp
+   ./rad.cpp
 
 
 INCLUDEPATH += .
@@ -3,13 +3,25 @@
  */
 
 #include <QtCore/QCoreApplication>
+#include <QEOptions.h>
 #include <rad_control.h>
+#include <rad_jobs.h>
+#include <rad_server.h>
 
 int main (int argc, char *argv[]) {
 
    QCoreApplication app(argc, argv);
 
-   new Rad_Control ();
+   QEOptions options;
+   if (options.isSpecified ("serve")) {
+      new Rad_Server ();
+   } else if (options.isSpecified ("client")) {
+      new Rad_Client ();
+   } else if (options.isSpecified ("jobs")) {
+      new Rad_JobRunner ();
+   } else {
+      new Rad_Control ();
+   }
    return app.exec ();
 }
 
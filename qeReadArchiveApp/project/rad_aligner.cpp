@@ -0,0 +1,210 @@
+/*  rad_aligner.cpp
+ *
+ *  Copyright (c) 2025 Australian Synchrotron
+ *
+ *  The EPICS QT Framework is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The EPICS QT Framework is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Author:
+ *    Andrew Starritt
+ *  Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#include "rad_aligner.h"
+
+#include <functional>
+#include <queue>
+#include <vector>
+#include <QDebug>
+#include <QPair>
+#include <QECommon.h>
+#include <QEArchiveInterface.h>
+
+#define DEBUG qDebug () << "rad_aligner" << __LINE__ << __FUNCTION__ << "  "
+
+//------------------------------------------------------------------------------
+//
+Rad_Aligner::Rad_Aligner (const Grids gridIn, const Fills fillIn,
+                          const qint64 startTimeIn, const qint64 endTimeIn,
+                          const qint64 intervalIn) :
+   grid (gridIn),
+   fill (fillIn),
+   startTime (startTimeIn),
+   endTime (endTimeIn),
+   interval (MAX (intervalIn, (qint64) 1))
+{
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_Aligner::~Rad_Aligner () { }
+
+//------------------------------------------------------------------------------
+//
+void Rad_Aligner::makeFixedGrid (QVector<qint64>& times) const
+{
+   times.clear ();
+   if (this->endTime < this->startTime) return;
+
+   const qint64 number = (this->endTime - this->startTime) / this->interval + 1;
+   times.resize ((int) number);
+
+   qint64* t = times.data ();
+   for (int j = 0; j < (int) number; j++) {
+      t [j] = this->startTime + j * this->interval;
+   }
+}
+
+//------------------------------------------------------------------------------
+// A k-way merge of the PV time arrays - each array is visited once, and the
+// earliest next time is taken from a min-heap keyed on (time, series), so
+// each row costs O(log P) rather than a scan of all P series.
+//
+void Rad_Aligner::makeUnionGrid (const QVector<Series>& input,
+                                 QVector<qint64>& times) const
+{
+   typedef QPair<qint64, int> Entry;   // next time, series
+   typedef std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > Heap;
+
+   const int numberSeries = input.count ();
+   QVector<int> cursor (numberSeries, 0);
+   Heap heap;
+   int total = 1;
+
+   // Skip any points at or before the start time - the start time itself
+   // is always the first row.
+   //
+   for (int s = 0; s < numberSeries; s++) {
+      const QVector<qint64>& time = input [s].time;
+      int j = 0;
+      while ((j < time.count ()) && (time [j] <= this->startTime)) j++;
+      cursor [s] = j;
+      total += time.count () - j;
+      if (j < time.count ()) heap.push (Entry (time [j], s));
+   }
+
+   times.clear ();
+   times.reserve (total);
+   times.append (this->startTime);
+
+   qint64 previous = this->startTime;
+   while (!heap.empty ()) {
+      const Entry top = heap.top ();
+      heap.pop ();
+
+      const qint64 earliest = top.first;
+      if (earliest > this->endTime) break;
+
+      if (earliest > previous) {
+         times.append (earliest);
+         previous = earliest;
+      }
+
+      const int s = top.second;
+      const QVector<qint64>& time = input [s].time;
+      if (++cursor [s] < time.count ()) heap.push (Entry (time [cursor [s]], s));
+   }
+}
+
+//------------------------------------------------------------------------------
+// Three simple passes: locate (the single merge pass over the PV's times),
+// gather, and optionally interpolate. The gather and interpolate loops have
+// no loop carried dependencies and so are amenable to auto-vectorisation.
+//
+void Rad_Aligner::fillColumn (const Series& series, const QVector<qint64>& times,
+                              QVector<int>& index, Column& column) const
+{
+   const int numberRows = times.count ();
+   const int numberPoints = series.count ();
+   const quint16 invalid = (quint16) QEArchiveInterface::archSevInvalid;
+
+   const qint64* gridTime = times.constData ();
+   const qint64* time = series.time.constData ();
+   const double* value = series.value.constData ();
+   const quint16* severity = series.severity.constData ();
+   const quint16* status = series.status.constData ();
+   const bool* displayable = series.isDisplayable.constData ();
+
+   // Locate - index of the last point at or before each row time, else -1.
+   //
+   int* idx = index.data ();
+   int p = -1;
+   for (int j = 0; j < numberRows; j++) {
+      while ((p + 1 < numberPoints) && (time [p + 1] <= gridTime [j])) p++;
+      idx [j] = p;
+   }
+
+   // Gather - zero order hold.
+   //
+   double* outValue = column.value.data ();
+   quint16* outSeverity = column.severity.data ();
+   quint16* outStatus = column.status.data ();
+   bool* outDisplayable = column.isDisplayable.data ();
+
+   for (int j = 0; j < numberRows; j++) {
+      const int k = idx [j];
+      const bool isValid = (k >= 0);
+      const int s = isValid ? k : 0;
+      outValue [j] = isValid ? value [s] : 0.0;
+      outSeverity [j] = isValid ? severity [s] : invalid;
+      outStatus [j] = isValid ? status [s] : 0;
+      outDisplayable [j] = isValid && displayable [s];
+   }
+
+   if (this->fill != linearFill) return;
+
+   // Interpolate - only between two displayable points, otherwise hold.
+   //
+   for (int j = 0; j < numberRows; j++) {
+      const int k = idx [j];
+      if ((k < 0) || (k + 1 >= numberPoints)) continue;
+      if (!displayable [k] || !displayable [k + 1]) continue;
+
+      const double span = (double) (time [k + 1] - time [k]);
+      const double frac = (double) (gridTime [j] - time [k]) / span;
+      outValue [j] = value [k] + frac * (value [k + 1] - value [k]);
+   }
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Aligner::align (const QVector<Series>& input, Table& output) const
+{
+   if (this->grid == unionGrid) {
+      this->makeUnionGrid (input, output.time);
+   } else {
+      this->makeFixedGrid (output.time);
+   }
+
+   const int numberRows = output.time.count ();
+   const int numberColumns = input.count ();
+
+   output.numberRows = numberRows;
+   output.columns.clear ();
+   output.columns.resize (numberColumns);
+
+   QVector<int> index (numberRows);   // re-used for each column
+
+   for (int c = 0; c < numberColumns; c++) {
+      Column& column = output.columns [c];
+      column.value.resize (numberRows);
+      column.severity.resize (numberRows);
+      column.status.resize (numberRows);
+      column.isDisplayable.resize (numberRows);
+
+      this->fillColumn (input [c], output.time, index, column);
+   }
+}
+
+// end
@@ -0,0 +1,94 @@
+/* rad_aligner.h
+ *
+ * This file is part of the EPICS QT Framework, initially developed at the
+ * Australian Synchrotron.
+ *
+ * Copyright (c) 2025 Australian Synchrotron
+ *
+ * The EPICS QT Framework is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The EPICS QT Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author:
+ *    Andrew Starritt
+ * Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#ifndef RAD_ALIGNER_H
+#define RAD_ALIGNER_H
+
+#include <QVector>
+#include <QCaDateTime.h>
+#include <QCaDataPoint.h>
+
+#include "rad_point_store.h"
+
+// Aligns the data sets of multiple PVs onto a common time grid in one pass,
+// producing a table with one row per grid time and one column per PV.
+//
+// All times are nanoseconds since 1970-01-01 00:00:00 UTC. Input and output
+// are in structure of arrays form, so the per column loops work on contiguous
+// arrays rather than copying QCaDataPoint objects.
+//
+class Rad_Aligner {
+public:
+   enum Grids {
+      fixedGrid,     // start time, then every interval up to and including end time
+      unionGrid      // start time, plus every distinct PV time after start up to end time
+   };
+
+   enum Fills {
+      holdFill,      // zero order hold, i.e. the last value at or before the row time
+      linearFill     // linear interpolation between adjacent displayable values
+   };
+
+   // One PV's data - times must be in ascending order.
+   //
+   typedef Rad_PointStore Series;
+
+   // One PV's aligned data. Rows prior to the PV's first point are invalid.
+   //
+   struct Column {
+      QVector<double> value;
+      QVector<quint16> severity;
+      QVector<quint16> status;
+      QVector<bool> isDisplayable;
+   };
+
+   struct Table {
+      int numberRows;
+      QVector<qint64> time;
+      QVector<Column> columns;
+   };
+
+   explicit Rad_Aligner (const Grids grid, const Fills fill,
+                         const qint64 startTime, const qint64 endTime,
+                         const qint64 interval);     // nano seconds, fixed grid only
+   ~Rad_Aligner ();
+
+   void align (const QVector<Series>& input, Table& output) const;
+
+private:
+   const Grids grid;
+   const Fills fill;
+   const qint64 startTime;
+   const qint64 endTime;
+   const qint64 interval;
+
+   void makeFixedGrid (QVector<qint64>& times) const;
+   void makeUnionGrid (const QVector<Series>& input, QVector<qint64>& times) const;
+   void fillColumn (const Series& series, const QVector<qint64>& times,
+                    QVector<int>& index, Column& column) const;
+};
+
+#endif  // RAD_ALIGNER_H
@@ -0,0 +1,826 @@
+/*  rad_appliance_source.cpp
+ *
+ *  Copyright (c) 2025 Australian Synchrotron
+ *
+ *  The EPICS QT Framework is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The EPICS QT Framework is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Author:
+ *    Andrew Starritt
+ *  Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#include "rad_appliance_source.h"
+#include "rad_cache.h"
+#include <iostream>
+#include <math.h>
+#include <string.h>
+
+#include <QDate>
+#include <QDateTime>
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QTime>
+#include <QTimer>
+#include <QUrl>
+#include <QUrlQuery>
+#include <QtEndian>
+
+#include <QECommon.h>
+#include <QCaAlarmInfo.h>
+
+#define DEBUG qDebug () << "rad_appliance_source" << __LINE__ << __FUNCTION__ << "  "
+
+static const char escapeChar = 0x1B;
+static const qint64 nanoSecsPerSec = 1000000000;
+
+//------------------------------------------------------------------------------
+// Protocol buffer wire format helpers.
+//
+static bool readVarint (const char*& data, const char* end, quint64& value)
+{
+   value = 0;
+   for (int shift = 0; shift < 64; shift += 7) {
+      if (data >= end) return false;
+      const quint8 byte = (quint8) *data++;
+      value |= (quint64) (byte & 0x7F) << shift;
+      if (!(byte & 0x80)) return true;
+   }
+   return false;
+}
+
+//------------------------------------------------------------------------------
+//
+static bool readLength (const char*& data, const char* end, int& length)
+{
+   quint64 value;
+   if (!readVarint (data, end, value)) return false;
+   if (value > (quint64) (end - data)) return false;
+   length = (int) value;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+//
+static bool skipField (const int wireType, const char*& data, const char* end)
+{
+   quint64 value;
+   int length;
+
+   switch (wireType) {
+      case 0:  return readVarint (data, end, value);
+      case 1:  length = 8;  break;
+      case 2:  if (!readLength (data, end, length)) return false;  break;
+      case 5:  length = 4;  break;
+      default: return false;
+   }
+
+   if (length > end - data) return false;
+   data += length;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+// sint32 values are zig zag encoded.
+//
+static qint32 zigZagDecode (const quint64 value)
+{
+   return (qint32) ((value >> 1) ^ (~(value & 1) + 1));
+}
+
+//------------------------------------------------------------------------------
+//
+static double fixed64ToDouble (const char* data)
+{
+   const quint64 bits = qFromLittleEndian<quint64> ((const uchar*) data);
+   double result;
+   memcpy (&result, &bits, sizeof (result));
+   return result;
+}
+
+//------------------------------------------------------------------------------
+//
+static double fixed32ToFloat (const char* data)
+{
+   const quint32 bits = qFromLittleEndian<quint32> ((const uchar*) data);
+   float result;
+   memcpy (&result, &bits, sizeof (result));
+   return result;
+}
+
+//------------------------------------------------------------------------------
+// Lines without escapes, i.e. nearly all of them, are not copied.
+//
+static QByteArray unescape (const char* data, const int size, bool& okay)
+{
+   okay = true;
+   if (!memchr (data, escapeChar, size)) return QByteArray::fromRawData (data, size);
+
+   QByteArray result;
+   result.reserve (size);
+   for (int j = 0; j < size; j++) {
+      char c = data [j];
+      if (c == escapeChar) {
+         j++;
+         switch ((j < size) ? data [j] : 0) {
+            case 1:  c = escapeChar; break;
+            case 2:  c = '\n';       break;
+            case 3:  c = '\r';       break;
+            default: okay = false;   return result;
+         }
+      }
+      result.append (c);
+   }
+   return result;
+}
+
+//==============================================================================
+// Rad_ApplianceDecoder
+//==============================================================================
+//
+Rad_ApplianceDecoder::Rad_ApplianceDecoder (const unsigned int elementIn,
+                                            const int numberElementsIn) :
+   element (elementIn),
+   numberElements (MAX (1, numberElementsIn)),
+   values (MAX (1, numberElementsIn)),
+   type (-1),
+   yearStart (0),
+   expectHeader (true)
+{
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_ApplianceDecoder::~Rad_ApplianceDecoder () { }
+
+//------------------------------------------------------------------------------
+//
+bool Rad_ApplianceDecoder::isComplete () const
+{
+   return this->partial.isEmpty ();
+}
+
+//------------------------------------------------------------------------------
+//
+bool Rad_ApplianceDecoder::decode (const QByteArray& data, QCaDataPointList& points)
+{
+   return this->decodeData (data, &points, NULL);
+}
+
+//------------------------------------------------------------------------------
+//
+bool Rad_ApplianceDecoder::decode (const QByteArray& data, Rad_Waveform& waveform)
+{
+   return this->decodeData (data, NULL, &waveform);
+}
+
+//------------------------------------------------------------------------------
+//
+bool Rad_ApplianceDecoder::decodeData (const QByteArray& data,
+                                       QCaDataPointList* points, Rad_Waveform* waveform)
+{
+   const char* raw = data.constData ();
+   const int size = data.size ();
+   int start = 0;
+
+   // Complete any line left over from last time.
+   //
+   if (!this->partial.isEmpty ()) {
+      const int newline = data.indexOf ('\n');
+      if (newline < 0) {
+         this->partial.append (data);
+         return true;
+      }
+
+      this->partial.append (raw, newline);
+      const bool okay = this->decodeLine (this->partial.constData (), this->partial.size (),
+                                          points, waveform);
+      this->partial.clear ();
+      if (!okay) return false;
+      start = newline + 1;
+   }
+
+   while (start < size) {
+      const char* newline = (const char*) memchr (raw + start, '\n', size - start);
+      if (!newline) {
+         this->partial = QByteArray (raw + start, size - start);
+         break;
+      }
+
+      const int length = (int) (newline - (raw + start));
+      if (!this->decodeLine (raw + start, length, points, waveform)) return false;
+      start += length + 1;
+   }
+
+   return true;
+}
+
+//------------------------------------------------------------------------------
+//
+bool Rad_ApplianceDecoder::decodeLine (const char* data, const int size,
+                                       QCaDataPointList* points, Rad_Waveform* waveform)
+{
+   // An empty line ends the chunk - a header line follows.
+   //
+   if (size == 0) {
+      this->expectHeader = true;
+      return true;
+   }
+
+   bool okay;
+   const QByteArray message = unescape (data, size, okay);
+   if (!okay) return false;
+
+   if (this->expectHeader) {
+      this->expectHeader = false;
+      return this->decodeHeader (message);
+   }
+
+   qint64 time;
+   qint32 severity;
+   qint32 status;
+   double* values = this->values.data ();
+   if (!this->decodeSample (message, time, severity, status, values)) return false;
+
+   if (waveform) {
+      waveform->appendRow (time, values, (quint16) severity, (quint16) status);
+   } else {
+      QCaDataPoint point;
+      point.datetime = Rad_Cache::fromEpochNanoSeconds (time);
+      point.value = values [0];
+      point.alarm = QCaAlarmInfo (status, severity);
+      points->append (point);
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+// PayloadInfo - type is field 1, year is field 3.
+//
+bool Rad_ApplianceDecoder::decodeHeader (const QByteArray& message)
+{
+   const char* data = message.constData ();
+   const char* end = data + message.size ();
+   qint64 typeIn = -1;
+   qint64 year = -1;
+
+   while (data < end) {
+      quint64 key;
+      if (!readVarint (data, end, key)) return false;
+      const int field = (int) (key >> 3);
+      const int wireType = (int) (key & 7);
+
+      if (((field == 1) || (field == 3)) && (wireType == 0)) {
+         quint64 value;
+         if (!readVarint (data, end, value)) return false;
+         if (field == 1) typeIn = (qint64) value; else year = (qint64) value;
+      } else {
+         if (!skipField (wireType, data, end)) return false;
+      }
+   }
+
+   // E.g. V4 generic bytes are not supported.
+   //
+   if ((typeIn < scalarString) || (typeIn > waveformDouble) || (year <= 0)) {
+      this->type = -1;
+      return false;
+   }
+
+   this->type = (int) typeIn;
+   const QDateTime startOfYear (QDate ((int) year, 1, 1), QTime (0, 0), Qt::UTC);
+   this->yearStart = startOfYear.toMSecsSinceEpoch () * 1000000;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+// Scalar... and Vector... messages - seconds into year is field 1, nano
+// seconds field 2, value field 3, severity field 4 and status field 5.
+//
+bool Rad_ApplianceDecoder::decodeSample (const QByteArray& message, qint64& time,
+                                         qint32& severity, qint32& status, double* values) const
+{
+   if (this->type < 0) return false;
+
+   const char* data = message.constData ();
+   const char* end = data + message.size ();
+   quint64 seconds = 0;
+   quint64 nanoSecs = 0;
+   int occurrence = 0;
+
+   severity = 0;
+   status = 0;
+   for (int k = 0; k < this->numberElements; k++) {
+      values [k] = NAN;
+   }
+
+   while (data < end) {
+      quint64 key;
+      if (!readVarint (data, end, key)) return false;
+      const int field = (int) (key >> 3);
+      const int wireType = (int) (key & 7);
+
+      if (field == 3) {
+         if (!this->decodeValue (wireType, data, end, occurrence, values)) return false;
+
+      } else if ((field == 1 || field == 2 || field == 4 || field == 5) && (wireType == 0)) {
+         quint64 number;
+         if (!readVarint (data, end, number)) return false;
+         switch (field) {
+            case 1: seconds = number;            break;
+            case 2: nanoSecs = number;           break;
+            case 4: severity = (qint32) number;  break;
+            case 5: status = (qint32) number;    break;
+         }
+
+      } else {
+         if (!skipField (wireType, data, end)) return false;
+      }
+   }
+
+   // As per a single element, every element of a scalar is the scalar value.
+   //
+   if (this->type < waveformString) {
+      for (int k = 1; k < this->numberElements; k++) {
+         values [k] = values [0];
+      }
+   }
+
+   time = this->yearStart + (qint64) seconds * nanoSecsPerSec + (qint64) nanoSecs;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+// The value field, or one of, for repeated fields. occurrence counts the array
+// elements seen so far in this sample. Selected elements are stored in values,
+// i.e. element k at values [k - first].
+//
+bool Rad_ApplianceDecoder::decodeValue (const int wireType, const char*& data, const char* end,
+                                        int& occurrence, double* values) const
+{
+   const bool isWaveform = (this->type >= waveformString);
+   const int first = isWaveform ? (int) this->element : 0;
+   const int number = isWaveform ? this->numberElements : 1;
+   const bool isZigZag = (this->type == scalarShort) || (this->type == scalarEnum) ||
+                         (this->type == waveformShort) || (this->type == waveformEnum);
+   const bool isInt = (this->type == scalarInt) || (this->type == waveformInt);
+   int k;
+
+   switch (wireType) {
+      case 0: {
+         quint64 number64;
+         if (!readVarint (data, end, number64)) return false;
+         k = occurrence++ - first;
+         if ((k >= 0) && (k < number)) {
+            values [k] = isZigZag ? zigZagDecode (number64) : (qint32) number64;
+         }
+         return true;
+      }
+
+      case 1:
+         if (end - data < 8) return false;
+         k = occurrence++ - first;
+         if ((k >= 0) && (k < number)) values [k] = fixed64ToDouble (data);
+         data += 8;
+         return true;
+
+      case 5:
+         if (end - data < 4) return false;
+         k = occurrence++ - first;
+         if ((k >= 0) && (k < number)) {
+            values [k] = isInt ? (qint32) qFromLittleEndian<quint32> ((const uchar*) data)
+                               : fixed32ToFloat (data);
+         }
+         data += 4;
+         return true;
+
+      case 2:
+         break;
+
+      default:
+         return false;
+   }
+
+   // Length delimited - a string, bytes or packed repeated numbers. Of fixed
+   // size items, only the selected elements are decoded.
+   //
+   int length;
+   if (!readLength (data, end, length)) return false;
+   const char* item = data;
+   data += length;
+
+   int items = 0;
+   switch (this->type) {
+      case scalarString:
+      case waveformString:
+         k = occurrence++ - first;
+         if ((k >= 0) && (k < number)) {
+            bool okay;
+            values [k] = QString::fromUtf8 (item, length).toDouble (&okay);
+            if (!okay) values [k] = NAN;
+         }
+         return true;
+
+      case scalarByte:
+      case waveformByte:
+         items = length;
+         break;
+
+      case waveformDouble:
+         items = length / 8;
+         break;
+
+      case waveformFloat:
+      case waveformInt:
+         items = length / 4;
+         break;
+
+      default:
+         // Packed varints - must be scanned.
+         //
+         while (item < data) {
+            quint64 number64;
+            if (!readVarint (item, data, number64)) return false;
+            k = occurrence++ - first;
+            if ((k >= 0) && (k < number)) {
+               values [k] = isZigZag ? zigZagDecode (number64) : (qint32) number64;
+            }
+         }
+         return true;
+   }
+
+   const int from = MAX (first, occurrence);
+   const int to = MIN (first + number, occurrence + items);
+
+   for (int j = from; j < to; j++) {
+      const int index = j - occurrence;
+      double value;
+      switch (this->type) {
+         case waveformDouble:
+            value = fixed64ToDouble (item + 8 * index);
+            break;
+         case waveformFloat:
+         case waveformInt:
+            value = isInt ? (qint32) qFromLittleEndian<quint32> ((const uchar*) (item + 4 * index))
+                          : fixed32ToFloat (item + 4 * index);
+            break;
+         default:
+            value = (signed char) item [index];
+            break;
+      }
+      values [j - first] = value;
+   }
+
+   occurrence += items;
+   return true;
+}
+
+//==============================================================================
+// Rad_ApplianceArchiveSource
+//==============================================================================
+//
+Rad_ApplianceArchiveSource::Rad_ApplianceArchiveSource (const QString& urlIn,
+                                                        QObject* parent) :
+   Rad_ArchiveSource (parent),
+   url (urlIn.endsWith ('/') ? urlIn.left (urlIn.length () - 1) : urlIn),
+   isCatalogueDone (false)
+{
+   this->manager = new QNetworkAccessManager (this);
+
+   // The PV name catalogue is only used for wild card expansion, but as per
+   // the QE framework archive access it is read up front.
+   //
+   QUrl catalogueUrl (this->url + "/bpl/getMatchingPVs");
+   QUrlQuery query;
+   query.addQueryItem ("pv", "*");
+   query.addQueryItem ("limit", "-1");
+   catalogueUrl.setQuery (query);
+
+   QNetworkRequest request (catalogueUrl);
+   request.setAttribute (QNetworkRequest::FollowRedirectsAttribute, true);
+   this->catalogueReply = this->manager->get (request);
+
+   QObject::connect (this->catalogueReply, SIGNAL (finished ()),
+                     this,                 SLOT   (catalogueFinished ()));
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_ApplianceArchiveSource::~Rad_ApplianceArchiveSource ()
+{
+   QHash<QNetworkReply*, Request>::iterator it;
+   for (it = this->requests.begin (); it != this->requests.end (); ++it) {
+      delete it.value ().decoder;
+   }
+   qDeleteAll (this->sharedResponses);
+}
+
+//------------------------------------------------------------------------------
+//
+bool Rad_ApplianceArchiveSource::isReady () const
+{
+   return this->isCatalogueDone;
+}
+
+//------------------------------------------------------------------------------
+//
+bool Rad_ApplianceArchiveSource::isPaged () const
+{
+   return false;
+}
+
+//------------------------------------------------------------------------------
+//
+QStringList Rad_ApplianceArchiveSource::getAllPVs () const
+{
+   return this->catalogue;
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_ApplianceArchiveSource::catalogueFinished ()
+{
+   QNetworkReply* reply = this->catalogueReply;
+   this->catalogueReply = NULL;
+   if (!reply) return;
+   reply->deleteLater ();
+
+   if (reply->error () == QNetworkReply::NoError) {
+      const QJsonArray names = QJsonDocument::fromJson (reply->readAll ()).array ();
+      for (int j = 0; j < names.count (); j++) {
+         this->catalogue.append (names.at (j).toString ());
+      }
+   } else {
+      // Not fatal - wild cards just do not match anything.
+      //
+      std::cerr << colour::yellow
+                << "warning: cannot read appliance PV names: "
+                << reply->errorString ().toLatin1 ().data ()
+                << colour::reset << std::endl;
+   }
+
+   std::cout << "appliance: " << this->url.toLatin1 ().data ()
+             << ", " << this->catalogue.count () << " PVs" << std::endl;
+
+   this->isCatalogueDone = true;
+   emit this->statusChanged ();
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_ApplianceArchiveSource::readArchive (QObject* userData, const QString& pvName,
+                                              const QCaDateTime& startTime, const QCaDateTime& endTime,
+                                              const int count, const QEArchiveInterface::How how,
+                                              const unsigned int element)
+{
+   // Requests with an operator, e.g. mean_600(PV:NAME), are used as is.
+   //
+   QString requestName = pvName;
+   if ((how != QEArchiveInterface::Raw) && !pvName.contains ('(')) {
+      const double span = startTime.secondsTo (endTime);
+      const int binSize = (int) MAX (1.0, ceil (span / MAX (count, 1)));
+      requestName = QString ("linear_%1(%2)").arg (binSize).arg (pvName);
+   }
+
+   const QString isoFormat = "yyyy-MM-ddTHH:mm:ss.zzzZ";
+
+   QUrl requestUrl (this->url + "/data/getData.raw");
+   QUrlQuery query;
+   query.addQueryItem ("pv", requestName);
+   query.addQueryItem ("from", startTime.toUTC ().toString (isoFormat));
+   query.addQueryItem ("to", endTime.toUTC ().toString (isoFormat));
+   requestUrl.setQuery (query);
+
+   // Array elements within the element range share the one archiver request.
+   //
+   QString sharedKey;
+   const QPair<unsigned int, int> range = this->elementRanges.value (pvName, qMakePair (0u, 0));
+   if ((element >= range.first) && (element < range.first + range.second)) {
+      this->purgeShared ();
+      sharedKey = requestUrl.toString ();
+
+      SharedResponse* shared = this->sharedResponses.value (sharedKey, NULL);
+      if (shared) {
+         shared->waiting.append (qMakePair (userData, element));
+         if (shared->isComplete) {
+            // Deliver asynchronously, as per a real archiver.
+            //
+            QTimer::singleShot (0, this, [=] () { this->deliverShared (sharedKey); });
+         }
+         return;
+      }
+
+      shared = new SharedResponse ();
+      shared->pvName = pvName;
+      shared->first = range.first;
+      shared->waveform = Rad_Waveform (range.second);
+      shared->isComplete = false;
+      shared->waiting.append (qMakePair (userData, element));
+      this->sharedResponses.insert (sharedKey, shared);
+   }
+
+   QNetworkRequest request (requestUrl);
+   request.setAttribute (QNetworkRequest::FollowRedirectsAttribute, true);
+   QNetworkReply* reply = this->manager->get (request);
+
+   Request item;
+   item.userData = userData;
+   item.pvName = pvName;
+   item.sharedKey = sharedKey;
+   item.decoder = sharedKey.isEmpty () ? new Rad_ApplianceDecoder (element)
+                                       : new Rad_ApplianceDecoder (range.first, range.second);
+   item.isMalformed = false;
+   this->requests.insert (reply, item);
+
+   QObject::connect (reply, SIGNAL (readyRead ()),
+                     this,  SLOT   (replyReadyRead ()));
+   QObject::connect (reply, SIGNAL (finished ()),
+                     this,  SLOT   (replyFinished ()));
+}
+
+//------------------------------------------------------------------------------
+// Ranges of the same PV, e.g. from concurrent jobs, are combined.
+//
+void Rad_ApplianceArchiveSource::setElementRange (const QString& pvName, const unsigned int first,
+                                                  const int number)
+{
+   if (number <= 1) return;
+
+   unsigned int low = first;
+   unsigned int high = first + number;
+   if (this->elementRanges.contains (pvName)) {
+      const QPair<unsigned int, int> range = this->elementRanges.value (pvName);
+      low = MIN (low, range.first);
+      high = MAX (high, range.first + range.second);
+   }
+   this->elementRanges.insert (pvName, qMakePair (low, (int) (high - low)));
+}
+
+//------------------------------------------------------------------------------
+// Decode as received, and pass on in parts.
+//
+void Rad_ApplianceArchiveSource::replyReadyRead ()
+{
+   QNetworkReply* reply = qobject_cast<QNetworkReply*> (this->sender ());
+   if (!reply || !this->requests.contains (reply)) return;
+
+   // E.g. the error page of a 404 response.
+   //
+   const int httpStatus = reply->attribute (QNetworkRequest::HttpStatusCodeAttribute).toInt ();
+   if (httpStatus != 200) return;
+
+   Request& request = this->requests [reply];
+   if (request.isMalformed) return;
+
+   const QByteArray data = reply->readAll ();
+   emit this->bytesReceived (request.userData, data.size ());
+
+   const bool okay = request.sharedKey.isEmpty ()
+         ? request.decoder->decode (data, request.points)
+         : request.decoder->decode (data, this->sharedResponses [request.sharedKey]->waveform);
+
+   if (!okay) {
+      request.isMalformed = true;
+      reply->abort ();      // see replyFinished
+      return;
+   }
+
+   if (request.points.count () >= partPoints) {
+      QCaDataPointList part;
+      part.swap (request.points);
+
+      // The request reference may be invalidated by the signal, e.g. by a
+      // subsequent readArchive.
+      //
+      emit this->setPartialArchiveData (request.userData, part, request.pvName);
+   }
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_ApplianceArchiveSource::replyFinished ()
+{
+   QNetworkReply* reply = qobject_cast<QNetworkReply*> (this->sender ());
+   if (!reply || !this->requests.contains (reply)) return;
+
+   Request request = this->requests.take (reply);
+   reply->deleteLater ();
+
+   bool okay = false;
+   QString supplementary;
+
+   if (request.isMalformed) {
+      supplementary = "malformed appliance response";
+
+   } else if (reply->error () != QNetworkReply::NoError) {
+      supplementary = reply->errorString ();
+
+   } else {
+      const QByteArray data = reply->readAll ();
+      emit this->bytesReceived (request.userData, data.size ());
+
+      okay = request.sharedKey.isEmpty ()
+            ? request.decoder->decode (data, request.points)
+            : request.decoder->decode (data, this->sharedResponses [request.sharedKey]->waveform);
+      okay = okay && request.decoder->isComplete ();
+      supplementary = okay ? "direct appliance retrieval" : "malformed appliance response";
+   }
+
+   delete request.decoder;
+
+   if (!request.sharedKey.isEmpty ()) {
+      if (okay) {
+         SharedResponse* shared = this->sharedResponses [request.sharedKey];
+         shared->isComplete = true;
+         shared->age.start ();
+         this->deliverShared (request.sharedKey);
+      } else {
+         this->failShared (request.sharedKey, supplementary);
+      }
+      return;
+   }
+   if (!okay) request.points.clear ();
+
+   emit this->setArchiveData (request.userData, okay, request.points,
+                              request.pvName, supplementary);
+}
+
+//------------------------------------------------------------------------------
+// Note: emitted responses may issue further requests, i.e. add to waiting.
+//
+void Rad_ApplianceArchiveSource::deliverShared (const QString& key)
+{
+   SharedResponse* shared = this->sharedResponses.value (key, NULL);
+   if (!shared || !shared->isComplete) return;
+
+   while (!shared->waiting.isEmpty ()) {
+      const QPair<QObject*, unsigned int> item = shared->waiting.takeFirst ();
+      const Rad_PointStore points = shared->waveform.elementPoints (item.second - shared->first);
+      const QString pvName = shared->pvName;
+      shared->delivered.insert (item.second);
+      shared->age.start ();
+
+      emit this->setArchiveData (item.first, true, points.toList (), pvName,
+                                 "direct appliance retrieval (shared)");
+
+      // Look up again - purged or replaced by a request issued meanwhile.
+      //
+      shared = this->sharedResponses.value (key, NULL);
+      if (!shared || !shared->isComplete) return;
+   }
+
+   if (shared->delivered.count () >= shared->waveform.numberElements ()) {
+      this->sharedResponses.remove (key);
+      delete shared;
+   }
+}
+
+//------------------------------------------------------------------------------
+// Each waiting request fails, and is retried by the requester as usual.
+//
+void Rad_ApplianceArchiveSource::failShared (const QString& key, const QString& supplementary)
+{
+   SharedResponse* shared = this->sharedResponses.take (key);
+   if (!shared) return;
+
+   for (int j = 0; j < shared->waiting.count (); j++) {
+      emit this->setArchiveData (shared->waiting.value (j).first, false, QCaDataPointList (),
+                                 shared->pvName, supplementary);
+   }
+   delete shared;
+}
+
+//------------------------------------------------------------------------------
+// Drops complete shared responses whose remaining elements were never
+// requested, e.g. by a requester that has since terminated.
+//
+void Rad_ApplianceArchiveSource::purgeShared ()
+{
+   QHash<QString, SharedResponse*>::iterator it = this->sharedResponses.begin ();
+   while (it != this->sharedResponses.end ()) {
+      SharedResponse* shared = it.value ();
+      if (shared->isComplete && shared->waiting.isEmpty () &&
+          (shared->age.elapsed () > 1000 * (qint64) sharedRetention)) {
+         delete shared;
+         it = this->sharedResponses.erase (it);
+      } else {
+         ++it;
+      }
+   }
+}
+
+// end
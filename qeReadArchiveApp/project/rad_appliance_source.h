@@ -0,0 +1,207 @@
+/* rad_appliance_source.h
+ *
+ * This file is part of the EPICS QT Framework, initially developed at the
+ * Australian Synchrotron.
+ *
+ * Copyright (c) 2025 Australian Synchrotron
+ *
+ * The EPICS QT Framework is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The EPICS QT Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author:
+ *    Andrew Starritt
+ * Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#ifndef RAD_APPLIANCE_SOURCE_H
+#define RAD_APPLIANCE_SOURCE_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <QCaDataPoint.h>
+#include "rad_archive_source.h"
+#include "rad_waveform.h"
+
+class QNetworkAccessManager;
+class QNetworkReply;
+
+// Incremental decoder of the Archive Appliance raw (protocol buffer) format,
+// i.e. as returned by getData.raw. Data may be supplied in arbitrary pieces,
+// as received; complete lines are decoded and any partial line is retained.
+//
+// The format is a sequence of chunks, each a PayloadInfo header line followed
+// by one line per sample, chunks being separated by an empty line. Within a
+// line, 0x1B, newline and carriage return are escaped as 0x1B 0x01, 0x1B 0x02
+// and 0x1B 0x03 respectively. Sample times are seconds into the year given by
+// the chunk header.
+//
+// Only the fields required by qerad are decoded, i.e. type and year from the
+// header, and time, value, severity and status from each sample. The value
+// of array (waveform) samples is the specified element, or in multi-element
+// mode, i.e. numberElements more than 1, the specified range of elements from
+// element onwards. Scalar samples are element 0.
+//
+class Rad_ApplianceDecoder {
+public:
+   explicit Rad_ApplianceDecoder (const unsigned int element = 0,
+                                  const int numberElements = 1);
+   ~Rad_ApplianceDecoder ();
+
+   // Decodes the complete lines of data, appending samples to points, i.e.
+   // the value of the first element only. Returns false if the stream is
+   // malformed.
+   //
+   bool decode (const QByteArray& data, QCaDataPointList& points);
+
+   // As above, appending one row per sample to the waveform, which must have
+   // numberElements elements. Elements not in a sample are NaN.
+   //
+   bool decode (const QByteArray& data, Rad_Waveform& waveform);
+
+   // Returns true if no partial line remains, i.e. at the end of the stream.
+   //
+   bool isComplete () const;
+
+   // As per EPICSEvent.proto PayloadType.
+   //
+   enum PayloadTypes {
+      scalarString = 0,
+      scalarShort,
+      scalarFloat,
+      scalarEnum,
+      scalarByte,
+      scalarInt,
+      scalarDouble,
+      waveformString,
+      waveformShort,
+      waveformFloat,
+      waveformEnum,
+      waveformByte,
+      waveformInt,
+      waveformDouble
+   };
+
+private:
+   // One of points or waveform is specified.
+   //
+   bool decodeData (const QByteArray& data, QCaDataPointList* points, Rad_Waveform* waveform);
+   bool decodeLine (const char* data, const int size,
+                    QCaDataPointList* points, Rad_Waveform* waveform);
+   bool decodeHeader (const QByteArray& message);
+   bool decodeSample (const QByteArray& message, qint64& time,
+                      qint32& severity, qint32& status, double* values) const;
+   bool decodeValue (const int wireType, const char*& data, const char* end,
+                     int& occurrence, double* values) const;
+
+   const unsigned int element;
+   const int numberElements;
+   QVector<double> values;       // of the current sample
+   QByteArray partial;           // received, not yet complete, line
+   int type;                     // of the current chunk, -1 when unknown
+   qint64 yearStart;             // of the current chunk, epoch nano seconds
+   bool expectHeader;
+};
+
+
+// Archive source that retrieves data directly from an Archive Appliance over
+// HTTP, bypassing the QE framework archive access, i.e. --appliance.
+//
+// Each request is for the whole time range, i.e. the count is not applied
+// and there is no paging. The raw response is decoded as it is received and
+// is delivered in parts via the setPartialArchiveData signal, the remainder
+// being delivered via setArchiveData. Linear requests use the appliance's
+// linear interpolation operator, with a bin size to yield about count points.
+//
+// The requests for the elements of an array PV within the element range (see
+// setElementRange) share the one archiver request, i.e. per PV, time range and
+// how. The response is decoded in multi-element mode, and is held until each
+// element in the range has been requested, or until unused for
+// sharedRetention seconds. Shared responses are not delivered in parts.
+//
+// Any HTTP server providing the retrieval URLs may be used, e.g. the local
+// stand-in appliance of qerad_bench (--mock-appliance), see rad_mock_appliance.h.
+//
+class Rad_ApplianceArchiveSource : public Rad_ArchiveSource {
+Q_OBJECT
+public:
+   // url is the appliance retrieval URL, e.g. http://archiver:17665/retrieval
+   //
+   explicit Rad_ApplianceArchiveSource (const QString& url, QObject* parent = NULL);
+   ~Rad_ApplianceArchiveSource ();
+
+   bool isReady () const;
+   bool isPaged () const;
+   QStringList getAllPVs () const;
+   void readArchive (QObject* userData, const QString& pvName,
+                     const QCaDateTime& startTime, const QCaDateTime& endTime,
+                     const int count, const QEArchiveInterface::How how,
+                     const unsigned int element);
+   void setElementRange (const QString& pvName, const unsigned int first,
+                         const int number);
+
+   static const int partPoints = 10000;   // points per setPartialArchiveData
+   static const int sharedRetention = 300;
+
+private:
+   struct Request {
+      QObject* userData;
+      QString pvName;
+      QString sharedKey;                  // shared response, if any
+      Rad_ApplianceDecoder* decoder;
+      QCaDataPointList points;            // decoded, not yet delivered
+      bool isMalformed;
+   };
+
+   // The response to an archiver request for a range of array elements.
+   //
+   struct SharedResponse {
+      QString pvName;
+      unsigned int first;
+      Rad_Waveform waveform;
+      bool isComplete;
+      QElapsedTimer age;                  // since complete or last delivered
+      QList<QPair<QObject*, unsigned int> > waiting;     // request tag, element
+      QSet<unsigned int> delivered;
+   };
+
+   // Delivers a complete shared response to the waiting requests.
+   //
+   void deliverShared (const QString& key);
+   void failShared (const QString& key, const QString& supplementary);
+   void purgeShared ();
+
+   const QString url;
+   QNetworkAccessManager* manager;
+   QNetworkReply* catalogueReply;
+   QStringList catalogue;
+   bool isCatalogueDone;
+   QHash<QNetworkReply*, Request> requests;
+   QHash<QString, QPair<unsigned int, int> > elementRanges;   // first, number by PV name
+   QHash<QString, SharedResponse*> sharedResponses;          // by request URL
+
+private slots:
+   void catalogueFinished ();
+   void replyReadyRead ();
+   void replyFinished ();
+};
+
+#endif  // RAD_APPLIANCE_SOURCE_H
@@ -0,0 +1,475 @@
+/*  rad_archive_source.cpp
+ *
+ *  Copyright (c) 2025 Australian Synchrotron
+ *
+ *  The EPICS QT Framework is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The EPICS QT Framework is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Author:
+ *    Andrew Starritt
+ *  Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#include "rad_archive_source.h"
+#include "rad_appliance_source.h"
+#include "rad_binary_writer.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QTimer>
+
+#include <QECommon.h>
+#include <QEOptions.h>
+
+#define DEBUG qDebug () << "rad_archive_source" << __LINE__ << __FUNCTION__ << "  "
+
+// Archivers may still be receiving data for the recent past, so only cache
+// responses for time ranges that ended at least this long ago (seconds).
+//
+static const qint64 closedMargin = 600;
+
+// Raw data are cached per chunk of this many seconds, as per Rad_Cache.
+//
+static const qint64 chunkSeconds = 3600;
+static const qint64 nanoSecondsPerSecond = 1000000000;
+
+//------------------------------------------------------------------------------
+// Returns the start of the chunk (epoch seconds) containing the given time
+// (nano seconds since epoch).
+//
+static qint64 chunkOf (const qint64 time)
+{
+   qint64 seconds = time / nanoSecondsPerSecond;
+   if ((time < 0) && (time % nanoSecondsPerSecond) != 0) seconds -= 1;
+   qint64 chunk = seconds - (seconds % chunkSeconds);
+   if (seconds < 0 && (seconds % chunkSeconds) != 0) chunk -= chunkSeconds;
+   return chunk;
+}
+
+//------------------------------------------------------------------------------
+//
+static bool isClosedChunk (const qint64 chunk)
+{
+   const qint64 now = QDateTime::currentDateTimeUtc ().toMSecsSinceEpoch () / 1000;
+   return (chunk + chunkSeconds + closedMargin) <= now;
+}
+
+//==============================================================================
+// Rad_ArchiveSource
+//==============================================================================
+//
+Rad_ArchiveSource::Rad_ArchiveSource (QObject* parent) : QObject (parent) { }
+
+//------------------------------------------------------------------------------
+//
+Rad_ArchiveSource::~Rad_ArchiveSource () { }
+
+//------------------------------------------------------------------------------
+// static
+Rad_ArchiveSource* Rad_ArchiveSource::create (QEOptions* options, QObject* parent)
+{
+   if (options->isSpecified ("appliance")) {
+      return new Rad_ApplianceArchiveSource (options->getString ("appliance", ""), parent);
+   }
+   return new Rad_QEArchiveSource (parent);
+}
+
+//------------------------------------------------------------------------------
+//
+bool Rad_ArchiveSource::isPaged () const
+{
+   return true;
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_ArchiveSource::setElementRange (const QString&, const unsigned int, const int) { }
+
+
+//==============================================================================
+// Rad_QEArchiveSource
+//==============================================================================
+//
+Rad_QEArchiveSource::Rad_QEArchiveSource (QObject* parent) :
+   Rad_ArchiveSource (parent)
+{
+   this->archiveAccess = new QEArchiveAccess (this);
+
+   // Set up connection to archive access mamanger.
+   // The data signal is forwarded as is.
+   //
+   QObject::connect (this->archiveAccess, SIGNAL (setArchiveData (const QObject*, const bool, const QCaDataPointList&,
+                                                                  const QString&, const QString&)),
+                     this,                SIGNAL (setArchiveData (const QObject*, const bool, const QCaDataPointList&,
+                                                                  const QString&, const QString&)));
+
+   QObject::connect (this->archiveAccess, SIGNAL (archiveStatus (const QEArchiveAccess::StatusList&)),
+                     this,                SLOT   (archiveStatus (const QEArchiveAccess::StatusList&)));
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_QEArchiveSource::~Rad_QEArchiveSource () { }
+
+//------------------------------------------------------------------------------
+//
+bool Rad_QEArchiveSource::isReady () const
+{
+   return this->archiveAccess->isReady ();
+}
+
+//------------------------------------------------------------------------------
+//
+QStringList Rad_QEArchiveSource::getAllPVs () const
+{
+   return QEArchiveAccess::getAllPVs ();
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_QEArchiveSource::readArchive (QObject* userData, const QString& pvName,
+                                       const QCaDateTime& startTime, const QCaDateTime& endTime,
+                                       const int count, const QEArchiveInterface::How how,
+                                       const unsigned int element)
+{
+   this->archiveAccess->readArchive (userData, pvName, startTime, endTime,
+                                     count, how, element);
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_QEArchiveSource::archiveStatus (const QEArchiveAccess::StatusList&)
+{
+   emit this->statusChanged ();
+}
+
+
+
+//==============================================================================
+// Rad_CachingArchiveSource
+//==============================================================================
+//
+Rad_CachingArchiveSource::Rad_CachingArchiveSource (Rad_ArchiveSource* sourceIn,
+                                                    const int maxMegaBytes,
+                                                    QObject* parent) :
+   Rad_ArchiveSource (parent),
+   source (sourceIn),
+   cache (1024 * maxMegaBytes),
+   hits (0),
+   partialHits (0),
+   misses (0)
+{
+   QObject::connect (this->source, SIGNAL (setArchiveData (const QObject*, const bool, const QCaDataPointList&,
+                                                           const QString&, const QString&)),
+                     this,         SLOT   (sourceArchiveData (const QObject*, const bool, const QCaDataPointList&,
+                                                              const QString&, const QString&)));
+
+   QObject::connect (this->source, SIGNAL (setPartialArchiveData (const QObject*, const QCaDataPointList&,
+                                                                  const QString&)),
+                     this,         SLOT   (sourcePartialArchiveData (const QObject*, const QCaDataPointList&,
+                                                                     const QString&)));
+
+   QObject::connect (this->source, SIGNAL (bytesReceived (const QObject*, const qint64)),
+                     this,         SIGNAL (bytesReceived (const QObject*, const qint64)));
+
+   QObject::connect (this->source, SIGNAL (statusChanged ()),
+                     this,         SIGNAL (statusChanged ()));
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_CachingArchiveSource::~Rad_CachingArchiveSource () { }
+
+//------------------------------------------------------------------------------
+//
+bool Rad_CachingArchiveSource::isReady () const
+{
+   return this->source->isReady ();
+}
+
+//------------------------------------------------------------------------------
+//
+bool Rad_CachingArchiveSource::isPaged () const
+{
+   return this->source->isPaged ();
+}
+
+//------------------------------------------------------------------------------
+//
+QStringList Rad_CachingArchiveSource::getAllPVs () const
+{
+   return this->source->getAllPVs ();
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_CachingArchiveSource::setElementRange (const QString& pvName, const unsigned int first,
+                                                const int number)
+{
+   this->source->setElementRange (pvName, first, number);
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_CachingArchiveSource::readArchive (QObject* userData, const QString& pvName,
+                                            const QCaDateTime& startTime, const QCaDateTime& endTime,
+                                            const int count, const QEArchiveInterface::How how,
+                                            const unsigned int element)
+{
+   Request request;
+
+   request.isRaw = (how == QEArchiveInterface::Raw) && !pvName.contains ('(');
+   request.startNs = Rad_BinaryWriter::toEpochNanoSeconds (startTime);
+   request.endNs = Rad_BinaryWriter::toEpochNanoSeconds (endTime);
+   request.fetchNs = request.startNs;
+   request.fetchCount = count;
+   request.received = 0;
+   request.sent = 0;
+
+   // Tags are only unique while in use - forget any prior use.
+   //
+   this->pending.remove (userData);
+
+   if (request.isRaw) {
+      request.key = QString ("%1 %2 ").arg (pvName).arg (element);
+
+      // The response starts with the value held at the start time, i.e. the
+      // last point at or before the start time, which may well precede the
+      // first chunk - look back through the cached chunks for it.
+      //
+      const qint64 first = chunkOf (request.startNs);
+      const qint64 last = chunkOf (request.endNs);
+
+      Rad_PointStore& points = request.points;
+      for (qint64 chunk = first; ; chunk -= chunkSeconds) {
+         const Rad_PointStore* cached = this->cache.object (request.key + QString::number (chunk));
+         if (!cached) break;
+         const int j = (chunk == first) ? cached->firstAfter (request.startNs) : cached->count ();
+         if (j > 0) {
+            points.appendPoint (*cached, j - 1);
+            break;
+         }
+      }
+
+      // Then the cached leading chunks of the time range.
+      //
+      qint64 chunk = first;
+      if (points.count () > 0) {
+         for (; chunk <= last; chunk += chunkSeconds) {
+            const Rad_PointStore* cached = this->cache.object (request.key + QString::number (chunk));
+            if (!cached) break;
+            points.append (*cached, cached->firstAfter (request.startNs));
+            points.truncate (points.firstAfter (request.endNs));
+         }
+      }
+
+      const bool isPaged = this->source->isPaged ();
+      if (isPaged && (points.count () >= count)) {
+         points.truncate (count);
+         chunk = last + chunkSeconds;
+      }
+
+      if (chunk > last) {
+         // Deliver asynchronously, as per a real archiver.
+         //
+         this->hits++;
+         const QCaDataPointList data = points.toList ();
+         QTimer::singleShot (0, this, [=] () {
+            emit this->setArchiveData (userData, true, data, pvName, QString ("cached"));
+         });
+         return;
+      }
+
+      if (chunk == first) {
+         points.clear ();
+         this->misses++;
+      } else {
+         // Request just the remainder - the cached points are delivered ahead
+         // of the response.
+         //
+         request.fetchNs = chunk * nanoSecondsPerSecond;
+         if (isPaged) request.fetchCount = count - points.count ();
+         this->partialHits++;
+      }
+
+      // Only retain the response when it may complete a closed chunk.
+      //
+      const qint64 whole = chunkOf (request.fetchNs - 1) + chunkSeconds;
+      if ((points.count () > 0) || isClosedChunk (whole)) {
+         this->pending.insert (userData, request);
+      }
+
+   } else {
+      request.key = QString ("%1 %2 %3 %4 %5 %6")
+            .arg (pvName).arg (request.startNs).arg (request.endNs)
+            .arg (count).arg ((int) how).arg (element);
+
+      const Rad_PointStore* cached = this->cache.object (request.key);
+      if (cached) {
+         this->hits++;
+         const QCaDataPointList data = cached->toList ();
+         QTimer::singleShot (0, this, [=] () {
+            emit this->setArchiveData (userData, true, data, pvName, QString ("cached"));
+         });
+         return;
+      }
+
+      this->misses++;
+
+      const qint64 now = QDateTime::currentDateTimeUtc ().toMSecsSinceEpoch () / 1000;
+      if (endTime.toMSecsSinceEpoch () / 1000 + closedMargin <= now) {
+         this->pending.insert (userData, request);
+      }
+   }
+
+   const QCaDateTime fetchTime =
+         (request.fetchNs == request.startNs) ? startTime
+                                              : QCaDateTime (QDateTime::fromMSecsSinceEpoch (
+                                                   request.fetchNs / 1000000, Qt::UTC));
+
+   this->source->readArchive (userData, pvName, fetchTime, endTime,
+                              request.fetchCount, how, element);
+}
+
+//------------------------------------------------------------------------------
+// A request for the remainder of a partially cached time range also yields the
+// last point before its start, which the cached points already cover.
+//
+QCaDataPointList Rad_CachingArchiveSource::admit (Request& request,
+                                                  const QCaDataPointList& archiveData)
+{
+   const Rad_PointStore incoming = Rad_PointStore::fromList (archiveData);
+   const int first = (request.fetchNs != request.startNs)
+                     ? incoming.firstAfter (request.fetchNs - 1) : 0;
+
+   const bool isHeld = request.points.count () > request.sent;
+
+   request.received += incoming.count ();
+   request.points.append (incoming, first);
+
+   const int number = request.points.count ();
+   if (!isHeld && (first == 0)) {
+      // Nothing prepended nor dropped - pass on as is.
+      //
+      request.sent = number;
+      return archiveData;
+   }
+
+   QCaDataPointList result;
+   for (int j = request.sent; j < number; j++) {
+      result.append (request.points.point (j));
+   }
+   request.sent = number;
+   return result;
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_CachingArchiveSource::insertResponse (const Request& request)
+{
+   const Rad_PointStore& points = request.points;
+
+   if (!request.isRaw) {
+      Rad_PointStore* whole = new Rad_PointStore (points);
+      const int cost = (int) MAX ((qint64) 1, whole->memoryUsage () / 1024);
+      this->cache.insert (request.key, whole, cost);     // takes ownership
+      return;
+   }
+
+   // A paged response limited by the request count is only complete up to
+   // its last point.
+   //
+   qint64 coveredNs = request.endNs;
+   if (this->source->isPaged () && (request.received >= request.fetchCount) &&
+       (points.count () > 0))
+   {
+      coveredNs = points.time [points.count () - 1];
+   }
+
+   // Chunks wholly within the forwarded time range. Note: empty chunks are
+   // cached too - they are valid for sparse PVs.
+   //
+   for (qint64 chunk = chunkOf (request.fetchNs - 1) + chunkSeconds;
+        ((chunk + chunkSeconds) * nanoSecondsPerSecond <= coveredNs) && isClosedChunk (chunk);
+        chunk += chunkSeconds)
+   {
+      const QString key = request.key + QString::number (chunk);
+      if (this->cache.contains (key)) continue;
+
+      const int from = points.firstAfter (chunk * nanoSecondsPerSecond - 1);
+      const int to = points.firstAfter ((chunk + chunkSeconds) * nanoSecondsPerSecond - 1);
+
+      Rad_PointStore* part = new Rad_PointStore ();
+      part->reserve (to - from);
+      for (int j = from; j < to; j++) {
+         part->appendPoint (points, j);
+      }
+      const int cost = (int) MAX ((qint64) 1, part->memoryUsage () / 1024);
+      this->cache.insert (key, part, cost);     // takes ownership
+   }
+}
+
+//------------------------------------------------------------------------------
+// Parts are passed on, preceded by any cached points, and also retained so
+// that the whole response may be cached.
+//
+void Rad_CachingArchiveSource::sourcePartialArchiveData (const QObject* userData,
+                                                         const QCaDataPointList& archiveData,
+                                                         const QString& pvName)
+{
+   if (!this->pending.contains (userData)) {
+      emit this->setPartialArchiveData (userData, archiveData, pvName);
+      return;
+   }
+
+   const QCaDataPointList data = this->admit (this->pending [userData], archiveData);
+   emit this->setPartialArchiveData (userData, data, pvName);
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_CachingArchiveSource::sourceArchiveData (const QObject* userData, const bool okay,
+                                                  const QCaDataPointList& archiveData,
+                                                  const QString& pvName, const QString& supplementary)
+{
+   if (!this->pending.contains (userData)) {
+      emit this->setArchiveData (userData, okay, archiveData, pvName, supplementary);
+      return;
+   }
+
+   Request request = this->pending.take (userData);
+
+   // On failure the requester retries from where its data is up to, so any
+   // cached points not yet delivered are not needed.
+   //
+   if (!okay) {
+      emit this->setArchiveData (userData, okay, archiveData, pvName, supplementary);
+      return;
+   }
+
+   const QCaDataPointList data = this->admit (request, archiveData);
+   this->insertResponse (request);
+   emit this->setArchiveData (userData, okay, data, pvName, supplementary);
+}
+
+//------------------------------------------------------------------------------
+//
+QString Rad_CachingArchiveSource::statistics () const
+{
+   return QString ("memory cache: %1 hits, %2 partial hits, %3 misses, %4 of %5 MB used")
+         .arg (this->hits).arg (this->partialHits).arg (this->misses)
+         .arg (this->cache.totalCost () / 1024).arg (this->cache.maxCost () / 1024);
+}
+
+// end
@@ -0,0 +1,212 @@
+/* rad_archive_source.h
+ *
+ * This file is part of the EPICS QT Framework, initially developed at the
+ * Australian Synchrotron.
+ *
+ * Copyright (c) 2025 Australian Synchrotron
+ *
+ * The EPICS QT Framework is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The EPICS QT Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author:
+ *    Andrew Starritt
+ * Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#ifndef RAD_ARCHIVE_SOURCE_H
+#define RAD_ARCHIVE_SOURCE_H
+
+#include <QCache>
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include <QCaDateTime.h>
+#include <QCaDataPoint.h>
+#include <QEArchiveInterface.h>
+#include <QEArchiveManager.h>
+
+#include "rad_point_store.h"
+
+class QEOptions;
+
+// Abstract source of archive data used by Rad_Control. This decouples the
+// qerad pipeline from QEArchiveAccess, so that it may also be driven by a
+// local stand-in archiver (see rad_mock_archive.h).
+//
+class Rad_ArchiveSource : public QObject {
+Q_OBJECT
+public:
+   explicit Rad_ArchiveSource (QObject* parent = NULL);
+   virtual ~Rad_ArchiveSource ();
+
+   // The source specified by the options, i.e. direct Archive Appliance
+   // retrieval when --appliance is specified, otherwise the QE framework
+   // archive access.
+   //
+   static Rad_ArchiveSource* create (QEOptions* options, QObject* parent = NULL);
+
+   virtual bool isReady () const = 0;
+
+   // True when the response to a Raw request is limited by the request count,
+   // i.e. the caller must page through the time range. Default is true.
+   //
+   virtual bool isPaged () const;
+
+   // The archiver's PV name catalogue - used for wild card expansion.
+   //
+   virtual QStringList getAllPVs () const = 0;
+
+   // As per QEArchiveAccess::readArchive - the response is delivered via
+   // the setArchiveData signal.
+   //
+   virtual void readArchive (QObject* userData, const QString& pvName,
+                             const QCaDateTime& startTime, const QCaDateTime& endTime,
+                             const int count, const QEArchiveInterface::How how,
+                             const unsigned int element) = 0;
+
+   // Array PVs are read one element per request. Sources that decode whole
+   // array samples may serve the requests for elements first to
+   // first + number - 1 of the PV from the one archiver request. The default
+   // does nothing, i.e. each element is a separate archiver request.
+   //
+   virtual void setElementRange (const QString& pvName, const unsigned int first,
+                                 const int number);
+
+signals:
+   void setArchiveData (const QObject* userData, const bool okay,
+                        const QCaDataPointList& archiveData,
+                        const QString& pvName, const QString& supplementary);
+
+   // Sources that decode responses incrementally may deliver leading parts of
+   // a response ahead of setArchiveData, which then delivers the remainder.
+   //
+   void setPartialArchiveData (const QObject* userData,
+                               const QCaDataPointList& archiveData,
+                               const QString& pvName);
+
+   // Sources that know the size of a response as received, e.g. over HTTP,
+   // report it as received.
+   //
+   void bytesReceived (const QObject* userData, const qint64 bytes);
+
+   // Emitted when the source status may have changed, e.g. become ready.
+   //
+   void statusChanged ();
+};
+
+
+// Archive source using the QE framework archive access, i.e. a Channel
+// Access archiver or an Archive Appliance as per QE_ARCHIVE_LIST.
+//
+class Rad_QEArchiveSource : public Rad_ArchiveSource {
+Q_OBJECT
+public:
+   explicit Rad_QEArchiveSource (QObject* parent = NULL);
+   ~Rad_QEArchiveSource ();
+
+   bool isReady () const;
+   QStringList getAllPVs () const;
+   void readArchive (QObject* userData, const QString& pvName,
+                     const QCaDateTime& startTime, const QCaDateTime& endTime,
+                     const int count, const QEArchiveInterface::How how,
+                     const unsigned int element);
+
+private:
+   QEArchiveAccess* archiveAccess;
+
+private slots:
+   void archiveStatus (const QEArchiveAccess::StatusList& statusList);
+};
+
+
+// Archive source that keeps a bounded, least recently used, in-memory cache of
+// the responses of another source - used by the --serve daemon, so that repeat
+// queries are answered without reference to the archiver. As per Rad_Cache,
+// raw data are cached per PV (and element) per time chunk aligned to the
+// epoch, and only closed chunks, i.e. chunks that end well in the past, are
+// cached. A raw request is served from the cached chunks covering it, and when
+// only a leading run of those chunks is cached, just the remainder is
+// requested from the source. Other requests, e.g. linear interpolated data or
+// server side operators, are cached as whole responses keyed on the request,
+// i.e. only exact repeats are served. Cache entries are held as point stores
+// and are charged their allocated size.
+//
+class Rad_CachingArchiveSource : public Rad_ArchiveSource {
+Q_OBJECT
+public:
+   // The source is not owned.
+   //
+   explicit Rad_CachingArchiveSource (Rad_ArchiveSource* source,
+                                      const int maxMegaBytes,
+                                      QObject* parent = NULL);
+   ~Rad_CachingArchiveSource ();
+
+   bool isReady () const;
+   bool isPaged () const;
+   QStringList getAllPVs () const;
+   void readArchive (QObject* userData, const QString& pvName,
+                     const QCaDateTime& startTime, const QCaDateTime& endTime,
+                     const int count, const QEArchiveInterface::How how,
+                     const unsigned int element);
+   void setElementRange (const QString& pvName, const unsigned int first,
+                         const int number);
+
+   // One line summary, e.g. for the server log.
+   //
+   QString statistics () const;
+
+private:
+   // A request forwarded to the source whose response is to be cached.
+   //
+   struct Request {
+      QString key;              // exact request key, or chunk key prefix when raw
+      bool isRaw;
+      qint64 startNs;           // nano seconds since epoch
+      qint64 endNs;
+      qint64 fetchNs;           // start of the forwarded request
+      int fetchCount;           // count of the forwarded request
+      int received;             // number of points received from the source
+      int sent;                 // number of points delivered so far
+      Rad_PointStore points;    // cached leading chunks, if any, plus response
+   };
+
+   // Appends a response, or part of, to the request and returns the points
+   // not yet delivered.
+   //
+   QCaDataPointList admit (Request& request, const QCaDataPointList& archiveData);
+
+   // Inserts the raw chunks wholly covered by the request, or the whole
+   // response, into the cache.
+   //
+   void insertResponse (const Request& request);
+
+   Rad_ArchiveSource* source;
+   QCache<QString, Rad_PointStore> cache;      // cost in kilo bytes
+   QHash<const QObject*, Request> pending;     // request tag => request
+   int hits;
+   int partialHits;
+   int misses;
+
+private slots:
+   void sourcePartialArchiveData (const QObject* userData,
+                                  const QCaDataPointList& archiveData,
+                                  const QString& pvName);
+   void sourceArchiveData (const QObject* userData, const bool okay,
+                           const QCaDataPointList& archiveData,
+                           const QString& pvName, const QString& supplementary);
+};
+
+#endif  // RAD_ARCHIVE_SOURCE_H
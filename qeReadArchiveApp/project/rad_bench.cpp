@@ -0,0 +1,98 @@
+/* rad_bench.cpp
+ *
+ * Benchmark harness for qerad. This runs the qerad pipeline (Rad_Control)
+ * against a local in-process mock archiver, and then reports end-to-end and
+ * per-phase times together with peak RSS, e.g.:
+ *
+ *   qerad_bench --raw --mock-pvs=100 --mock-period=0.1 --mock-latency=20 \
+ *               /tmp/out.txt  "2025-01-01 00:00:00"  "2025-01-02 00:00:00"  'MOCK:PV00*'
+ *
+ * Mock archiver options (all other options as per qerad):
+ *
+ *   --mock-pvs=<n>       number of PVs served, MOCK:PV0001 to MOCK:PVnnnn, default 10
+ *   --mock-period=<s>    raw sample period (seconds), default 1.0
+ *   --mock-latency=<ms>  delay before each response is delivered, default 10
+ *   --mock-ready=<ms>    delay before the mock archiver reports ready, default 100
+ *
+ * Stand-in Archive Appliance options - data is as per the mock archiver, but is
+ * served over HTTP on the loopback interface and read by the --appliance path:
+ *
+ *   --mock-appliance        use the stand-in appliance rather than the mock archiver
+ *   --mock-elements=<n>     elements per PV, more than 1 for waveforms, default 1
+ *   --mock-piece=<bytes>    response piece size, default 1000
+ *   --mock-interval=<ms>    interval between response pieces, default 1
+ *   --mock-response=<file>  saved getData.raw response served for all data requests
+ *
+ * And, to check the appliance decoder against known streams, and exit:
+ *
+ *   qerad_bench --check-decoder
+ */
+
+#include <iostream>
+#include <QtCore/QCoreApplication>
+#include <QEOptions.h>
+#include <rad_appliance_source.h>
+#include <rad_control.h>
+#include <rad_mock_appliance.h>
+#include <rad_mock_archive.h>
+#include <rad_statistics.h>
+
+int main (int argc, char *argv[]) {
+
+   QCoreApplication app(argc, argv);
+
+   QEOptions options;
+
+   if (options.getBool ("check-decoder")) {
+      const bool okay = Rad_ApplianceDecoderCheck::run ();
+      std::cout << "appliance decoder checks " << (okay ? "passed" : "failed") << std::endl;
+      return okay ? 0 : 1;
+   }
+
+   const int numberPVs = options.getInt ("mock-pvs", 10);
+   const double period = options.getFloat ("mock-period", 1.0);
+   const int latency = options.getInt ("mock-latency", 10);
+   const int readyDelay = options.getInt ("mock-ready", 100);
+
+   Rad_MockApplianceServer* server = NULL;
+   Rad_ArchiveSource* source = NULL;
+   QString description;
+
+   if (options.getBool ("mock-appliance")) {
+      const int numberElements = options.getInt ("mock-elements", 1);
+      const int pieceSize = options.getInt ("mock-piece", 1000);
+      const int pieceInterval = options.getInt ("mock-interval", 1);
+
+      server = new Rad_MockApplianceServer (numberPVs, period, numberElements,
+                                            pieceSize, pieceInterval,
+                                            options.getString ("mock-response", ""));
+      if (!server->listen ()) {
+         delete server;
+         return 1;
+      }
+      source = new Rad_ApplianceArchiveSource (server->url ());
+      description = QString ("mock appliance: %1 PVs, %2 s period, %3 elements, %4 byte pieces")
+                    .arg (numberPVs).arg (period).arg (numberElements).arg (pieceSize);
+   } else {
+      source = new Rad_MockArchiveSource (numberPVs, period, latency, readyDelay);
+      description = QString ("mock archiver: %1 PVs, %2 s period, %3 ms latency")
+                    .arg (numberPVs).arg (period).arg (latency);
+   }
+
+   int status;
+   {
+      Rad_Control control (source);
+
+      status = app.exec ();
+
+      std::cout << "\nqerad benchmark (" << description.toLatin1 ().data () << ")\n"
+                << control.getStatistics ()->report ().toLatin1 ().data ()
+                << "exit status          " << status << std::endl;
+   }
+
+   delete source;
+   delete server;
+   return status;
+}
+
+// end
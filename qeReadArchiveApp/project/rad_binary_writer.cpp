@@ -0,0 +1,269 @@
+/*  rad_binary_writer.cpp
+ *
+ *  Copyright (c) 2025 Australian Synchrotron
+ *
+ *  The EPICS QT Framework is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The EPICS QT Framework is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Author:
+ *    Andrew Starritt
+ *  Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#include "rad_binary_writer.h"
+#include <iostream>
+
+#include <QByteArray>
+#include <QDebug>
+
+#define DEBUG qDebug () << "rad_binary_writer" << __LINE__ << __FUNCTION__ << "  "
+
+static const char magic [8] = { 'Q', 'E', 'R', 'A', 'D', 'B', 'I', 'N' };
+static const quint32 formatVersion = 2;
+static const qint64 fixedHeaderSize = 48;
+
+//------------------------------------------------------------------------------
+//
+static void setUpStream (QDataStream& stream)
+{
+   stream.setByteOrder (QDataStream::LittleEndian);
+   stream.setFloatingPointPrecision (QDataStream::DoublePrecision);
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_BinaryWriter::Rad_BinaryWriter (const QString& filenameIn,
+                                    const QStringList& pvNamesIn) :
+   filename (filenameIn),
+   pvNames (pvNamesIn),
+   rowCount (0)
+{
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_BinaryWriter::~Rad_BinaryWriter () { }
+
+//------------------------------------------------------------------------------
+//
+bool Rad_BinaryWriter::open ()
+{
+   if (!this->timeSpool.open () ||
+       !this->valueSpool.open () ||
+       !this->alarmSpool.open ())
+   {
+      std::cerr << "open spool file failed" << std::endl;
+      return false;
+   }
+
+   this->timeStream.setDevice (&this->timeSpool);
+   this->valueStream.setDevice (&this->valueSpool);
+   this->alarmStream.setDevice (&this->alarmSpool);
+
+   setUpStream (this->timeStream);
+   setUpStream (this->valueStream);
+   setUpStream (this->alarmStream);
+
+   this->rowCount = 0;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+// static
+qint64 Rad_BinaryWriter::toEpochNanoSeconds (const QCaDateTime& time)
+{
+   // QDateTime provides the mSec, QCaDateTime retains the sub-mSec part.
+   //
+   const qint64 mSec = time.toMSecsSinceEpoch ();
+   const qint64 subMSec = (qint64) (time.getNanoSeconds () % 1000000);
+   return (mSec * 1000000) + subMSec;
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_BinaryWriter::appendRow (const QCaDateTime& time, const QCaDataPoint p [])
+{
+   const int number = this->pvNames.count ();
+
+   this->timeStream << (qint64) Rad_BinaryWriter::toEpochNanoSeconds (time);
+
+   for (int pv = 0; pv < number; pv++) {
+      this->valueStream << (double) p [pv].value;
+      this->alarmStream << (quint16) p [pv].alarm.getSeverity ()
+                        << (quint16) p [pv].alarm.getStatus ();
+   }
+
+   this->rowCount++;
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_BinaryWriter::appendRow (const qint64 time, const double values [],
+                                  const quint16 severity [], const quint16 status [])
+{
+   const int number = this->pvNames.count ();
+
+   this->timeStream << time;
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+   // The file format is little endian - rows are written as is, which
+   // matters for wide rows, e.g. array PVs.
+   //
+   this->valueStream.writeRawData ((const char*) values, number * (int) sizeof (double));
+#else
+   for (int pv = 0; pv < number; pv++) {
+      this->valueStream << values [pv];
+   }
+#endif
+
+   for (int pv = 0; pv < number; pv++) {
+      this->alarmStream << severity [pv] << status [pv];
+   }
+
+   this->rowCount++;
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_BinaryWriter::appendPoints (const Rad_PointStore& points)
+{
+   const int number = points.count ();
+   for (int j = 0; j < number; j++) {
+      const double value = points.value [j];
+      const quint16 severity = points.severity [j];
+      const quint16 status = points.status [j];
+      this->appendRow (points.time [j], &value, &severity, &status);
+   }
+}
+
+//------------------------------------------------------------------------------
+// static
+void Rad_BinaryWriter::pad (QDataStream& target)
+{
+   const qint64 position = target.device ()->pos ();
+   const int extra = (int) ((8 - (position % 8)) % 8);
+   for (int j = 0; j < extra; j++) {
+      target << (quint8) 0;
+   }
+}
+
+//------------------------------------------------------------------------------
+// A failed spool write, e.g. the temporary directory is full, leaves a short
+// spool - this must not be copied under a header claiming all the rows.
+// static
+bool Rad_BinaryWriter::isSpoolComplete (QTemporaryFile& spool, const QDataStream& stream,
+                                        const qint64 expectedSize)
+{
+   if (stream.status () != QDataStream::Ok) return false;
+   if (!spool.flush ()) return false;
+   return spool.size () == expectedSize;
+}
+
+//------------------------------------------------------------------------------
+//
+bool Rad_BinaryWriter::copySpool (QTemporaryFile& spool, QDataStream& target)
+{
+   static const qint64 chunkSize = 1 << 20;
+
+   if (!spool.seek (0)) return false;
+
+   while (!spool.atEnd ()) {
+      const QByteArray chunk = spool.read (chunkSize);
+      if (chunk.isEmpty ()) return false;
+      if (target.writeRawData (chunk.constData (), chunk.size ()) != chunk.size ()) {
+         return false;
+      }
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+//
+bool Rad_BinaryWriter::close ()
+{
+   const qint64 numberPVs = this->pvNames.count ();
+
+   if (!Rad_BinaryWriter::isSpoolComplete (this->timeSpool, this->timeStream, 8 * this->rowCount) ||
+       !Rad_BinaryWriter::isSpoolComplete (this->valueSpool, this->valueStream, 8 * this->rowCount * numberPVs) ||
+       !Rad_BinaryWriter::isSpoolComplete (this->alarmSpool, this->alarmStream, 4 * this->rowCount * numberPVs))
+   {
+      std::cerr << "write spool file failed" << std::endl;
+      this->timeSpool.close ();
+      this->valueSpool.close ();
+      this->alarmSpool.close ();
+      return false;
+   }
+
+   QFile targetFile (this->filename);
+
+   if (!targetFile.open (QIODevice::WriteOnly)) {
+      std::cerr << "open file failed" << std::endl;
+      return false;
+   }
+
+   QDataStream target (&targetFile);
+   setUpStream (target);
+
+   // Calculate the array offsets.
+   //
+   qint64 namesSize = 0;
+   QList<QByteArray> encodedNames;
+   for (int pv = 0; pv < this->pvNames.count (); pv++) {
+      const QByteArray name = this->pvNames.value (pv).toUtf8 ();
+      encodedNames.append (name);
+      namesSize += 4 + name.size ();
+   }
+
+   const qint64 timesOffset  = ((fixedHeaderSize + namesSize + 7) / 8) * 8;
+   const qint64 valuesOffset = timesOffset + (8 * this->rowCount);
+   const qint64 alarmsOffset = valuesOffset + (8 * this->rowCount * numberPVs);
+
+   // Header
+   //
+   target.writeRawData (magic, sizeof (magic));
+   target << (quint32) formatVersion
+          << (quint32) numberPVs
+          << (quint64) this->rowCount
+          << (quint64) timesOffset
+          << (quint64) valuesOffset
+          << (quint64) alarmsOffset;
+
+   for (int pv = 0; pv < encodedNames.count (); pv++) {
+      const QByteArray& name = encodedNames [pv];
+      target << (quint32) name.size ();
+      target.writeRawData (name.constData (), name.size ());
+   }
+   Rad_BinaryWriter::pad (target);
+
+   // Arrays - each is a multiple of 8 bytes, except the final alarms array.
+   //
+   bool okay = this->copySpool (this->timeSpool, target) &&
+               this->copySpool (this->valueSpool, target) &&
+               this->copySpool (this->alarmSpool, target);
+
+   if (!okay || (target.status () != QDataStream::Ok)) {
+      std::cerr << "write binary file failed" << std::endl;
+      okay = false;
+   }
+
+   targetFile.close ();
+
+   this->timeSpool.close ();
+   this->valueSpool.close ();
+   this->alarmSpool.close ();
+
+   return okay;
+}
+
+// end
@@ -0,0 +1,114 @@
+/* rad_binary_writer.h
+ *
+ * This file is part of the EPICS QT Framework, initially developed at the
+ * Australian Synchrotron.
+ *
+ * Copyright (c) 2025 Australian Synchrotron
+ *
+ * The EPICS QT Framework is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The EPICS QT Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author:
+ *    Andrew Starritt
+ * Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#ifndef RAD_BINARY_WRITER_H
+#define RAD_BINARY_WRITER_H
+
+#include <QDataStream>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QTemporaryFile>
+
+#include <QCaDateTime.h>
+#include <QCaDataPoint.h>
+
+#include "rad_point_store.h"
+
+// Writes the qerad binary (columnar) output format. All values little endian.
+//
+//   offset  size  content
+//        0     8  magic "QERADBIN"
+//        8     4  uint32  format version (2)
+//       12     4  uint32  number of PVs, P
+//       16     8  uint64  number of rows, N
+//       24     8  uint64  file offset of times array
+//       32     8  uint64  file offset of values array
+//       40     8  uint64  file offset of alarms array
+//       48   ...  PV names, each a uint32 byte count followed by UTF-8 bytes
+//
+// Each array starts on an 8 byte boundary (zero padded):
+//
+//   times    int64   [N]        nanoseconds since 1970-01-01 00:00:00 UTC
+//   values   float64 [N][P]     row major, i.e. values for row 0, then row 1 ...
+//   alarms   uint16  [N][P][2]  severity, status
+//
+// e.g. numpy:  values = np.frombuffer (mm, '<f8', N*P, values_offset).reshape (N, P)
+//
+// Version 1 held severity and status as uint8.
+//
+// Rows are spooled to temporary files as they are added, so the writer can be
+// used for streamed output without holding all the data in memory.
+//
+class Rad_BinaryWriter {
+public:
+   explicit Rad_BinaryWriter (const QString& filename,
+                              const QStringList& pvNames);
+   ~Rad_BinaryWriter ();
+
+   bool open ();
+
+   // Appends one row - p must hold one point for each PV.
+   //
+   void appendRow (const QCaDateTime& time, const QCaDataPoint p []);
+
+   // Appends one row - each array must hold one element for each PV.
+   //
+   void appendRow (const qint64 time, const double values [],
+                   const quint16 severity [], const quint16 status []);
+
+   // Single PV convenience function.
+   //
+   void appendPoints (const Rad_PointStore& points);
+
+   // Assembles the output file from the spooled data.
+   //
+   bool close ();
+
+   qint64 numberRows () const { return this->rowCount; }
+
+   static qint64 toEpochNanoSeconds (const QCaDateTime& time);
+
+private:
+   static bool isSpoolComplete (QTemporaryFile& spool, const QDataStream& stream,
+                                const qint64 expectedSize);
+   bool copySpool (QTemporaryFile& spool, QDataStream& target);
+   static void pad (QDataStream& target);
+
+   QString filename;
+   QStringList pvNames;
+   qint64 rowCount;
+
+   QTemporaryFile timeSpool;
+   QTemporaryFile valueSpool;
+   QTemporaryFile alarmSpool;
+
+   QDataStream timeStream;
+   QDataStream valueStream;
+   QDataStream alarmStream;
+};
+
+#endif  // RAD_BINARY_WRITER_H
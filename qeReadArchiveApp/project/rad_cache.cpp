@@ -0,0 +1,254 @@
+/*  rad_cache.cpp
+ *
+ *  Copyright (c) 2025 Australian Synchrotron
+ *
+ *  The EPICS QT Framework is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The EPICS QT Framework is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Author:
+ *    Andrew Starritt
+ *  Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#include "rad_cache.h"
+#include <iostream>
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QUrl>
+
+#include <QECommon.h>
+
+#define DEBUG qDebug () << "rad_cache" << __LINE__ << __FUNCTION__ << "  "
+
+static const quint32 cacheMagic = 0x51524143;     // "QRAC"
+static const quint32 cacheVersion = 1;
+static const qint64 headerSize = 20;              // magic, version, chunk, number
+static const qint64 pointSize = 20;               // time, value, severity, status
+
+// Chunks must end at least this long ago (seconds) to be considered closed.
+// This allows for archiver engine write latency.
+//
+static const qint64 closedMargin = 600;
+
+// Offset between the POSIX epoch and the EPICS epoch (1990-01-01 UTC).
+//
+static const qint64 epicsEpochOffset = 631152000;
+
+//------------------------------------------------------------------------------
+//
+Rad_Cache::Rad_Cache (const QString& directoryIn,
+                      const QString& archiverKey,
+                      const int chunkSecondsIn) :
+   chunkSeconds (MAX (chunkSecondsIn, 60)),
+   hits (0),
+   misses (0),
+   writes (0),
+   bytesRead (0),
+   bytesWritten (0)
+{
+   this->directory = QDir (directoryIn).filePath (archiverKey);
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_Cache::~Rad_Cache () { }
+
+//------------------------------------------------------------------------------
+// static
+QString Rad_Cache::defaultDirectory ()
+{
+   // On Linux, this honours XDG_CACHE_HOME (default ~/.cache).
+   //
+   const QString base = QStandardPaths::writableLocation (QStandardPaths::GenericCacheLocation);
+   return QDir (base).filePath ("qerad");
+}
+
+//------------------------------------------------------------------------------
+//
+qint64 Rad_Cache::chunkOf (const QDateTime& time) const
+{
+   return this->chunkOf ((qint64) time.toMSecsSinceEpoch () * 1000000);
+}
+
+//------------------------------------------------------------------------------
+//
+qint64 Rad_Cache::chunkOf (const qint64 time) const
+{
+   qint64 seconds = time / 1000000000;
+   if ((time < 0) && (time % 1000000000) != 0) seconds -= 1;
+   qint64 chunk = seconds - (seconds % this->chunkSeconds);
+   if (seconds < 0 && (seconds % this->chunkSeconds) != 0) chunk -= this->chunkSeconds;
+   return chunk;
+}
+
+//------------------------------------------------------------------------------
+//
+QCaDateTime Rad_Cache::chunkTime (const qint64 chunk) const
+{
+   return QCaDateTime (QDateTime::fromMSecsSinceEpoch (chunk * 1000, Qt::UTC));
+}
+
+//------------------------------------------------------------------------------
+//
+bool Rad_Cache::isClosed (const qint64 chunk) const
+{
+   const qint64 now = QDateTime::currentDateTimeUtc ().toMSecsSinceEpoch () / 1000;
+   return (chunk + this->chunkSeconds + closedMargin) <= now;
+}
+
+//------------------------------------------------------------------------------
+// static
+QCaDateTime Rad_Cache::fromEpochNanoSeconds (const qint64 time)
+{
+   qint64 seconds = time / 1000000000;
+   qint64 nanoSecs = time % 1000000000;
+   if (nanoSecs < 0) {
+      nanoSecs += 1000000000;
+      seconds -= 1;
+   }
+
+   return QCaDateTime ((unsigned long) (seconds - epicsEpochOffset),
+                       (unsigned long) nanoSecs);
+}
+
+//------------------------------------------------------------------------------
+//
+QString Rad_Cache::chunkFilename (const QString& pvName, const qint64 chunk) const
+{
+   // Percent encode the PV name so that it is a valid directory name.
+   //
+   const QString encoded = QString::fromLatin1 (QUrl::toPercentEncoding (pvName, ":"));
+   QDir pvDir (QDir (this->directory).filePath (encoded));
+   return pvDir.filePath (QString ("%1.dat").arg (chunk));
+}
+
+//------------------------------------------------------------------------------
+//
+bool Rad_Cache::read (const QString& pvName, const qint64 chunk,
+                      Rad_PointStore& points)
+{
+   points.clear ();
+
+   QFile file (this->chunkFilename (pvName, chunk));
+   if (!file.open (QIODevice::ReadOnly)) {
+      this->misses++;
+      return false;
+   }
+
+   QDataStream source (&file);
+   source.setByteOrder (QDataStream::LittleEndian);
+   source.setFloatingPointPrecision (QDataStream::DoublePrecision);
+
+   quint32 magic;
+   quint32 version;
+   qint64 storedChunk;
+   quint32 number;
+
+   // The number of points must agree with the file size, so that a corrupt
+   // count is not trusted.
+   //
+   source >> magic >> version >> storedChunk >> number;
+   if ((source.status () != QDataStream::Ok) || (magic != cacheMagic) ||
+       (version != cacheVersion) || (storedChunk != chunk) ||
+       (file.size () != headerSize + (qint64) number * pointSize))
+   {
+      // Treat as a miss - it will be overwritten.
+      //
+      this->misses++;
+      return false;
+   }
+
+   points.reserve ((int) number);
+   for (quint32 j = 0; j < number; j++) {
+      qint64 time;
+      double value;
+      quint16 severity;
+      quint16 status;
+
+      source >> time >> value >> severity >> status;
+      points.append (time, value, severity, status);
+   }
+
+   if (source.status () != QDataStream::Ok) {
+      points.clear ();
+      this->misses++;
+      return false;
+   }
+
+   this->hits++;
+   this->bytesRead += file.size ();
+   return true;
+}
+
+//------------------------------------------------------------------------------
+//
+bool Rad_Cache::write (const QString& pvName, const qint64 chunk,
+                       const Rad_PointStore& points)
+{
+   if (!this->isClosed (chunk)) return false;
+
+   const QString filename = this->chunkFilename (pvName, chunk);
+   QDir ().mkpath (QFileInfo (filename).absolutePath ());
+
+   // Write via a temporary file so that concurrent readers never see a
+   // partially written chunk.
+   //
+   QSaveFile file (filename);
+   if (!file.open (QIODevice::WriteOnly)) {
+      std::cerr << "warning: cannot write cache file "
+                << filename.toLatin1 ().data () << std::endl;
+      return false;
+   }
+
+   QDataStream target (&file);
+   target.setByteOrder (QDataStream::LittleEndian);
+   target.setFloatingPointPrecision (QDataStream::DoublePrecision);
+
+   const int number = points.count ();
+   target << cacheMagic << cacheVersion << (qint64) chunk << (quint32) number;
+
+   for (int j = 0; j < number; j++) {
+      target << (qint64) points.time [j]
+             << (double) points.value [j]
+             << (quint16) points.severity [j]
+             << (quint16) points.status [j];
+   }
+
+   const qint64 size = file.size ();
+   if (!file.commit ()) return false;
+
+   this->writes++;
+   this->bytesWritten += size;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+//
+QString Rad_Cache::statistics () const
+{
+   return QString ("cache: %1 hits, %2 misses, %3 bytes read, %4 chunks (%5 bytes) written")
+         .arg (this->hits)
+         .arg (this->misses)
+         .arg (this->bytesRead)
+         .arg (this->writes)
+         .arg (this->bytesWritten);
+}
+
+// end
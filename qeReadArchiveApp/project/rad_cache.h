@@ -0,0 +1,94 @@
+/* rad_cache.h
+ *
+ * This file is part of the EPICS QT Framework, initially developed at the
+ * Australian Synchrotron.
+ *
+ * Copyright (c) 2025 Australian Synchrotron
+ *
+ * The EPICS QT Framework is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The EPICS QT Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author:
+ *    Andrew Starritt
+ * Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#ifndef RAD_CACHE_H
+#define RAD_CACHE_H
+
+#include <QDateTime>
+#include <QString>
+
+#include <QCaDateTime.h>
+#include <QCaDataPoint.h>
+
+#include "rad_point_store.h"
+
+// Local on-disk cache of archiver responses. Data is stored per PV per time
+// chunk (one hour by default) aligned to the epoch, under:
+//
+//    <directory>/<archiver key>/<encoded pv name>/<chunk start>.dat
+//
+// where the archiver key is derived from the archive list so that data from
+// different archivers are not mixed. Only closed chunks, i.e. chunks that end
+// well before the current time, are ever written.
+//
+class Rad_Cache {
+public:
+   explicit Rad_Cache (const QString& directory,
+                       const QString& archiverKey,
+                       const int chunkSeconds = 3600);
+   ~Rad_Cache ();
+
+   // $XDG_CACHE_HOME/qerad (or equivalent).
+   //
+   static QString defaultDirectory ();
+
+   int chunkSize () const { return this->chunkSeconds; }
+
+   // Returns the start of the chunk (epoch seconds) containing the given time.
+   //
+   qint64 chunkOf (const QDateTime& time) const;
+   qint64 chunkOf (const qint64 time) const;    // nano seconds since epoch
+   QCaDateTime chunkTime (const qint64 chunk) const;
+
+   // A closed chunk is one that can no longer receive new archive data.
+   //
+   bool isClosed (const qint64 chunk) const;
+
+   // Read returns false on a cache miss.
+   //
+   bool read (const QString& pvName, const qint64 chunk, Rad_PointStore& points);
+   bool write (const QString& pvName, const qint64 chunk, const Rad_PointStore& points);
+
+   // One line summary, e.g. for the run summary.
+   //
+   QString statistics () const;
+
+   static QCaDateTime fromEpochNanoSeconds (const qint64 time);
+
+private:
+   QString chunkFilename (const QString& pvName, const qint64 chunk) const;
+
+   QString directory;
+   int chunkSeconds;
+
+   int hits;
+   int misses;
+   int writes;
+   qint64 bytesRead;
+   qint64 bytesWritten;
+};
+
+#endif  // RAD_CACHE_H
@@ -22,12 +22,27 @@
  */
 
 #include "rad_control.h"
+#include "rad_archive_source.h"
+#include "rad_binary_writer.h"
+#include "rad_cache.h"
+#include "rad_export.h"
+#include "rad_follow.h"
+#include "rad_gzip.h"
+#include <math.h>
 #include <stdlib.h>
 #include <iostream>
 
+#include <QCoreApplication>
+#include <QCryptographicHash>
 #include <QDebug>
 #include <QDateTime>
 #include <QFile>
+#include <QMap>
+#include <QPointer>
+#include <QSet>
+#include <QRegularExpression>
+#include <QScopedPointer>
+#include <QtNumeric>
 
 #include <QECommon.h>
 #include <QEArchiveInterface.h>
@@ -47,40 +62,167 @@ const static char* reset  = "\033[00m";
 
 static const QString stdFormat = "dd/MM/yyyy HH:mm:ss";
 
+// Interval between "still awaiting" reminders (seconds).
+//
+static const double reminderInterval = 20.0;
+
+// Shards shorter than this (seconds) are not worth a separate request.
+//
+static const double minimumShardSpan = 600.0;
+
+// Default maximum number of outstanding archiver requests - enough to overlap
+// the archiver round trips of several PVs without swamping the archiver.
+//
+static const int defaultMaxInFlight = 4;
+
+// Request point count limits. The default maximum is the traditional fixed
+// request size, which all supported archivers accept.
+//
+static const int defaultMaxPoints = 20000;
+static const int minimumPoints = 1000;
+
+// Request failure defaults, seconds. The retry delay doubles for each
+// successive retry of a request, up to the maximum.
+//
+static const double defaultRequestTimeout = 60.0;
+static const int defaultMaxRetries = 2;
+static const double defaultRetryDelay = 2.0;
+static const double maximumRetryDelay = 60.0;
+
+// Array PV element ranges larger than this warrant a warning, unless all the
+// elements are read per archiver request.
+//
+static const int manyElements = 100;
+
 //------------------------------------------------------------------------------
 //
-Rad_Control::Rad_Control () : QObject (NULL)
+Rad_Control::Rad_Control (Rad_ArchiveSource* source,
+                          const QStringList& arguments) : QObject (NULL)
 {
-   this->options = new QEOptions ();
+   this->isEmbedded = !arguments.isEmpty ();
+   this->options = this->isEmbedded ? new QEOptions (arguments) : new QEOptions ();
 
    this->timeZoneSpec = Qt::LocalTime;
    this->state = setup;   // state machine state
-   this->timeout = 0;
+   this->isProcessing = false;
+   this->timeoutRemaining = 0.0;
    this->numberPVNames = 0;
-   this->pvIndex = 0;
+   this->maxInFlight = defaultMaxInFlight;
+   this->numberShards = 1;
+   this->maxPoints = defaultMaxPoints;
+   this->numberInFlight = 0;
+   this->numberComplete = 0;
+   this->requestTimeout = defaultRequestTimeout;
+   this->maxRetries = defaultMaxRetries;
+   this->retryDelay = defaultRetryDelay;
+   this->isPartial = false;
+   this->useFixedTime = false;
+   this->fixedTime = 1.0;
+   this->alignGrid = Rad_Aligner::fixedGrid;
+   this->alignFill = Rad_Aligner::holdFill;
+   this->isReducing = false;
+   this->reduceMode = Rad_Reducer::meanMode;
+   this->binWidth = 60;
+   this->useServerReduction = false;
+   this->archiveSource = source;
+   this->isOwnSource = (source == NULL);
+   this->isStatsReport = false;
+   this->outputFormat = textFormat;
+   this->exportColumns = timeColumn | relativeColumn | valueColumn;
+   this->useLongLayout = false;
+   this->useStreaming = false;
+   this->useCompression = false;
+   this->isWaveform = false;
+   this->firstElement = 0;
+   this->numberElements = 0;
+   this->isFollowing = false;
+   this->isAppending = false;
+   this->followOffset = -1;
+   this->pollPeriod = 0.0;
+   this->isEndNow = false;
+   this->streamFile = NULL;
+   this->streamTarget = NULL;
+   this->streamWriter = NULL;
+   this->streamFormatter = NULL;
+   this->isStreamFailed = false;
+   this->cache = NULL;
+
+   // The state machine is event driven - this timer is only used for timeouts.
+   //
+   this->timeoutTimer = new QTimer (this);
+   this->timeoutTimer->setSingleShot (true);
+   QObject::connect (this->timeoutTimer, SIGNAL (timeout ()),
+                     this, SLOT (timeoutExpired ()));
+
+   // QEArchiveAccess does not guarantee a notification when it becomes ready,
+   // so we also check frequently while waiting for the archiver interface.
+   //
+   this->readyTimer = new QTimer (this);
+   QObject::connect (this->readyTimer, SIGNAL (timeout ()),
+                     this, SLOT (processState ()));
 
-   this->tickTimer = new QTimer (this);
-   QObject::connect (this->tickTimer, SIGNAL (timeout ()),
-                     this, SLOT (tickTimeout ()));
+   // Follow mode with polling - initiates each subsequent poll.
+   //
+   this->pollTimer = new QTimer (this);
+   this->pollTimer->setSingleShot (true);
+   QObject::connect (this->pollTimer, SIGNAL (timeout ()),
+                     this, SLOT (pollExpired ()));
+
+   // Individual requests are timed out by this watchdog.
+   //
+   this->watchdogTimer = new QTimer (this);
+   QObject::connect (this->watchdogTimer, SIGNAL (timeout ()),
+                     this, SLOT (checkRequests ()));
 
-   this->tickTimer->start (100);  // mSes
+   // Start once the event loop is running.
+   //
+   QTimer::singleShot (0, this, SLOT (processState ()));
 }
 
 //------------------------------------------------------------------------------
 //
 Rad_Control::~Rad_Control ()
 {
+   for (int j = 0; j < this->pvDataList.count (); j++) {
+      delete this->pvDataList [j].reducer;
+   }
+   delete this->cache;
+   delete this->streamWriter;
+   delete this->streamTarget;
+   delete this->streamFile;
+   delete this->streamFormatter;
    delete this->options;
+   if (this->isOwnSource) delete this->archiveSource;
+}
+
+//------------------------------------------------------------------------------
+//
+const Rad_Statistics* Rad_Control::getStatistics () const
+{
+   return &this->statistics;
 }
 
 //------------------------------------------------------------------------------
 //
 void Rad_Control::setTimeout (const double delay)
 {
-   double n = this->tickTimer->interval ();    // 100 mS
+   this->timeoutRemaining = delay;
+   this->timeoutTimer->start ((int) (1000.0 * MIN (delay, reminderInterval)));
+}
 
-   this->timeout = (int) ((1000.0 * delay + (n - 1.0)) / n);
-   if (this->timeout < 1) this->timeout = 1;
+//------------------------------------------------------------------------------
+// Request the event loop to exit - rather than calling exit directly - so that
+// the caller, e.g. the benchmark, may report on the run.
+//
+void Rad_Control::terminate (const int status)
+{
+   this->pollTimer->stop ();
+   this->watchdogTimer->stop ();
+   this->readyTimer->stop ();
+   this->timeoutTimer->stop ();
+   this->state = terminated;
+   emit this->finished (status);
+   if (!this->isEmbedded) QCoreApplication::exit (status);
 }
 
 //------------------------------------------------------------------------------
@@ -97,86 +239,236 @@ QDateTime Rad_Control::toRadTime (const QDateTime dateTime) const
 }
 
 //------------------------------------------------------------------------------
-// A sort of state machine.
+// A sort of state machine. This runs through states until it reaches a
+// state that must wait for an event, i.e. archiver ready or archiver response.
 //
-void Rad_Control::tickTimeout ()
+void Rad_Control::processState ()
 {
-   switch (this->state) {
+   // Guard against re-entry, e.g. a response emitted from within readArchive.
+   // The outer invocation will continue processing the updated state.
+   //
+   if (this->isProcessing) return;
+   this->isProcessing = true;
+
+   bool isWaiting = false;
+   while (!isWaiting) {
+      switch (this->state) {
+
+         case setup:
+            this->initialise ();
+            if (this->state == waitArchiverReady) {
+               // Previously a fixed 20 second wait followed by up to 60 seconds.
+               //
+               this->setTimeout (80.0);
+               this->readyTimer->start (20);
+               this->statistics.start (Rad_Statistics::ArchiverReady);
+            }
+            break;
+
+         case waitArchiverReady:
+            if (this->archiveSource->isReady ()) {
+               this->readyTimer->stop ();
+               this->timeoutTimer->stop ();
+               this->statistics.stop (Rad_Statistics::ArchiverReady);
+               std::cout << "Archiver interface initialised" << std::endl;
+               this->state = setupPVs;
+            } else {
+               isWaiting = true;
+            }
+            break;
+
+         case setupPVs:
+            // Wild card expansion requires the archiver PV name catalogue,
+            // so this is done once the archiver interface is ready.
+            //
+            if (this->setUpPVData (this->expandPVNames (this->pvNameInput)) &&
+                (!this->isFollowing || this->readFollowFile ())) {
+               this->state = initialiseRequest;
+            } else {
+               this->state = errorExit;
+            }
+            break;
+
+         case initialiseRequest:
+            // Initialise (first) readArchive request values for each PV.
+            //
+            this->numberInFlight = 0;
+            this->numberComplete = 0;
+
+            // The stream must be open before any PV can complete.
+            //
+            if (this->useStreaming && !this->openStream ()) {
+               this->state = errorExit;
+               break;
+            }
 
-      case setup:
-         this->initialise ();
-         this->setTimeout (20.0);
-         break;
+            if (this->setUpSegments () > 0) {
+               this->state = sendRequest;
+            } else {
+               this->state = printAll;
+            }
+            break;
+
+         case sendRequest:
+            // Set next state before issuing requests - setArchiveData may
+            // update the state if a response is delivered immediately.
+            //
+            this->state = waitResponse;
+            if (!this->watchdogTimer->isActive ()) {
+               this->reminderTimer.start ();
+               this->watchdogTimer->start (250);
+            }
+            this->statistics.start (Rad_Statistics::Fetch);
+            this->sendRequests ();
+            break;
+
+         case waitResponse:
+            isWaiting = true;
+            break;
+
+         case printAll:
+            this->timeoutTimer->stop ();
+            this->watchdogTimer->stop ();
+            this->statistics.stop (Rad_Statistics::Fetch);
+            if (this->useStreaming) {
+               this->closeStream ();
+            } else {
+               this->putArchiveData ();
+            }
+            if (this->cache) {
+               std::cout << this->cache->statistics ().toLatin1 ().data () << std::endl;
+            }
+            this->putStatistics ();
+            if (this->state != printAll) break;
 
-      case initialWait:
-         // Just wait 20 ....
-         this->timeout--;
-         if (this->timeout % 10 == 0) std::cerr << '.';
-         if (this->timeout <= 0) {
-            std::cerr << '.' << std::endl;
-            this->setTimeout (60.0);
-            this->state = waitArchiverReady;
-         }
-         break;
+            if (this->pollPeriod > 0.0) {
+               std::cout << "next poll in " << this->pollPeriod << " s" << std::endl;
+               this->pollTimer->start ((int) (1000.0 * this->pollPeriod));
+               this->state = waitPoll;
+            } else {
+               this->state = allDone;
+            }
+            break;
+
+         case waitPoll:
+            isWaiting = true;
+            break;
+
+         case allDone:
+            if (this->numberFailed () > 0) {
+               // Only possible with --partial.
+               //
+               std::cout << "qerad complete - partial, " << this->numberFailed ()
+                         << " PV(s) incomplete" << std::endl;
+               this->terminate (2);
+            } else {
+               std::cout << "qerad complete" << std::endl;
+               this->terminate (0);
+            }
+            break;
+
+         case errorExit:
+            std::cout << "qerad terminated" << std::endl;
+            this->terminate (1);
+            break;
+
+         case terminated:
+            // Awaiting event loop exit - ignore any late events.
+            //
+            isWaiting = true;
+            break;
+
+         default:
+            std::cerr << "bad state:" << this->state << std::endl;
+            this->terminate (4);
+            break;
+      }
+   }
+
+   this->isProcessing = false;
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Control::timeoutExpired ()
+{
+   this->timeoutRemaining -= reminderInterval;
+
+   if (this->timeoutRemaining > 0.0) {
+      if (this->state == waitArchiverReady) {
+         std::cerr << "Still awating archiver interface initialisation" << std::endl;
+      }
+      this->timeoutTimer->start ((int) (1000.0 * MIN (this->timeoutRemaining, reminderInterval)));
+      return;
+   }
 
+   switch (this->state) {
       case waitArchiverReady:
-         if (this->archiveAccess->isReady ()) {
-            std::cout << "Archiver interface initialised" << std::endl;
-            this->state = initialiseRequest;
-         } else {
-            this->timeout--;
-            if (this->timeout <= 0) {
-               std::cerr << "Archiver interface initialise timeout" << std::endl;
-               exit (1);
-            } else if ((this->timeout == 20) || (this->timeout == 40)) {
-               std::cerr << "Still awating archiver interface initialisation" << std::endl;
-            }
-         }
+         std::cerr << "Archiver interface initialise timeout" << std::endl;
+         this->terminate (1);
          break;
 
-      case initialiseRequest:
-         // Initialise (first) readArchive request values.
-         //
-         this->pvIndex = 0;
-         this->nextTime = this->startTime;
-         this->state = sendRequest;
+      default:
          break;
+   }
+}
 
-      case sendRequest:
-         this->readArchive ();
-         this->state = waitResponse;
-         this->setTimeout (60.0);
-         break;
+//------------------------------------------------------------------------------
+// Time out individual requests - a timed out request is retried, as per a
+// failed request. Any late response to a timed out request is ignored.
+//
+void Rad_Control::checkRequests ()
+{
+   if (this->state != waitResponse) return;
 
-      case waitResponse:
-         this->timeout--;
-         if (this->timeout <= 0) {
-            std::cerr << "archive read timeout" << std::endl;
-            exit (1);
-         } else if ((this->timeout == 20) || (this->timeout == 40)) {
-            std::cerr << "Still awating archiver response" << std::endl;
-         }
-         break;
+   if ((this->numberInFlight > 0) &&
+       (this->reminderTimer.elapsed () >= (qint64) (1000.0 * reminderInterval))) {
+      std::cerr << "Still awating archiver response" << std::endl;
+      this->reminderTimer.start ();
+   }
 
-      case printAll:
-         this->putArchiveData();
-         this->state = allDone;
-         break;
+   const qint64 limit = (qint64) (1000.0 * this->requestTimeout);
+   for (int index = 0; index < this->segmentList.count (); index++) {
+      struct Segment* segment = &this->segmentList [index];
+      if (!segment->isInFlight || (segment->requestTimer.elapsed () < limit)) continue;
 
-      case allDone:
-         std::cout << "qerad complete" << std::endl;
-         exit (0);
-         break;
+      std::cerr << colour::yellow
+                << "warning: archive read timeout: "
+                << this->pvDataList [segment->pvIndex].pvName.toLatin1 ().data ()
+                << colour::reset << std::endl;
 
-      case errorExit:
-         std::cout << "qerad terminated" << std::endl;
-         exit (1);
-         break;
+      segment->isInFlight = false;
+      this->numberInFlight--;
+      this->statistics.increment (Rad_Statistics::Timeouts);
 
-      default:
-         std::cerr << "bad state:" << this->state << std::endl;
-         exit (4);
-         break;
+      this->staleTags.insert (segment->requestTag);
+      this->requestTagMap.remove (segment->requestTag);
+      segment->requestTag = new QObject (this);
+      this->requestTagMap.insert (segment->requestTag, index);
+
+      this->concludeResponse (segment, this->scheduleRetry (segment));
+      if (this->state != waitResponse) break;
+   }
+}
+
+//------------------------------------------------------------------------------
+// Follow mode - fetch and append whatever has been archived since last time.
+//
+void Rad_Control::pollExpired ()
+{
+   if (this->state != waitPoll) return;
+
+   this->endTime = QDateTime::currentDateTimeUtc ().toTimeSpec (this->timeZoneSpec);
+   this->state = setupPVs;
+   this->processState ();
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Control::archiveStatus ()
+{
+   if (this->state == waitArchiverReady) {
+      this->processState ();
    }
 }
 
@@ -216,6 +508,11 @@ QDateTime Rad_Control::value (const QString& timeImage, bool& okay)
    int j;
    QString image;
 
+   if (timeImage.trimmed ().toLower () == "now") {
+      okay = true;
+      return QDateTime::currentDateTimeUtc ().toTimeSpec (this->timeZoneSpec);
+   }
+
    okay = false;
    for (j = 0; j < ARRAY_LENGTH (formats); j++) {
       result = QCaDateTime::fromString (timeImage, formats [j]);
@@ -265,6 +562,79 @@ void Rad_Control::initialise ()
    }
 
 
+   this->isStatsReport = this->options->getBool ("stats");
+   this->statsJsonFile = this->options->getString ("stats-json", "");
+
+   // Statistics/decimation modes reduce raw data into bins.
+   //
+   this->isReducing = false;
+   if (this->options->isSpecified ("mode")) {
+      const QString mode = this->options->getString ("mode", "");
+      if (!Rad_Reducer::modeFromString (mode, this->reduceMode)) {
+         this->usage (QString ("Invalid mode \"%1\", must be mean, min, max, minmax, count or std").arg (mode));
+         return;
+      }
+      this->isReducing = true;
+      this->how = QEArchiveInterface::Raw;
+   }
+
+   // Array PVs - the archiver interface delivers one element per request,
+   // so each element is fetched as if a scalar PV. Sources that decode whole
+   // samples, i.e. --appliance, serve all the elements from the one archiver
+   // request - see setUpPVData.
+   //
+   this->isWaveform = false;
+   this->firstElement = 0;
+   this->numberElements = 0;
+   if (this->options->isSpecified ("elements")) {
+      const QString range = this->options->getString ("elements", "");
+      const QStringList parts = range.split (":");
+      bool firstOkay = true;
+      bool lastOkay = false;
+      int first = 0;
+      int last = -1;
+
+      if (parts.count () == 1) {
+         last = parts.value (0).toInt (&lastOkay) - 1;
+      } else if (parts.count () == 2) {
+         first = parts.value (0).toInt (&firstOkay);
+         last = parts.value (1).toInt (&lastOkay);
+      }
+
+      if (!firstOkay || !lastOkay || (first < 0) || (last < first)) {
+         this->usage (QString ("Invalid elements \"%1\", must be <number> or <first>:<last>").arg (range));
+         return;
+      }
+
+      if (this->isReducing) {
+         this->usage ("--elements not applicable with --mode");
+         return;
+      }
+
+      this->isWaveform = true;
+      this->firstElement = first;
+      this->numberElements = last - first + 1;
+
+      if ((this->numberElements > manyElements) && !this->options->isSpecified ("appliance")) {
+         std::cout << colour::yellow
+                   << "warning: " << this->numberElements
+                   << " elements, each is a separate archiver request per time range - consider --appliance"
+                   << colour::reset << std::endl;
+      }
+   }
+
+   this->maxInFlight = defaultMaxInFlight;
+   if (this->options->isSpecified ("concurrent")) {
+      this->maxInFlight = this->options->getInt ("concurrent", 0);
+      if (this->maxInFlight < 1) {
+         std::cerr << colour::red
+                   << "error: concurrent request limit must be at least 1."
+                   << colour::reset << std::endl;
+         this->state = errorExit;
+         return;
+      }
+   }
+
    this->useFixedTime = false;
    if (this->options->isSpecified ("fixed")) {
       // If the default value is returned assume error.
@@ -287,12 +657,209 @@ void Rad_Control::initialise ()
       }
    }
 
+   // Multiple PV alignment options.
+   //
+   this->alignGrid = Rad_Aligner::fixedGrid;
+   if (this->options->isSpecified ("align")) {
+      const QString align = this->options->getString ("align", "");
+      if (align == "fixed") {
+         this->alignGrid = Rad_Aligner::fixedGrid;
+      } else if (align == "union") {
+         this->alignGrid = Rad_Aligner::unionGrid;
+         if (this->useFixedTime) {
+            std::cout << colour::yellow
+                      << "warning: --fixed not applicable with --align=union - ignored"
+                      << colour::reset << std::endl;
+            this->useFixedTime = false;
+         }
+      } else {
+         std::cerr << colour::red
+                   << "error: align must be one of fixed or union."
+                   << colour::reset << std::endl;
+         this->state = errorExit;
+         return;
+      }
+   }
+
+   this->alignFill = Rad_Aligner::holdFill;
+   if (this->options->isSpecified ("fill")) {
+      const QString fill = this->options->getString ("fill", "");
+      if (fill == "hold") {
+         this->alignFill = Rad_Aligner::holdFill;
+      } else if (fill == "linear") {
+         this->alignFill = Rad_Aligner::linearFill;
+      } else {
+         std::cerr << colour::red
+                   << "error: fill must be one of hold or linear."
+                   << colour::reset << std::endl;
+         this->state = errorExit;
+         return;
+      }
+   }
+
+   this->maxPoints = defaultMaxPoints;
+   if (this->options->isSpecified ("max-points")) {
+      this->maxPoints = this->options->getInt ("max-points", 0);
+      if (this->maxPoints < minimumPoints) {
+         std::cerr << colour::red
+                   << "error: max points must be at least " << minimumPoints << "."
+                   << colour::reset << std::endl;
+         this->state = errorExit;
+         return;
+      }
+   }
+
+   // Sharding splits each PV's time range into independently paged segments.
+   // Only meaningful for raw data, linear data density depends on the span.
+   //
+   this->numberShards = 1;
+   if (this->options->isSpecified ("shards")) {
+      this->numberShards = this->options->getInt ("shards", 0);
+      if (this->numberShards < 1) {
+         std::cerr << colour::red
+                   << "error: number of shards must be at least 1."
+                   << colour::reset << std::endl;
+         this->state = errorExit;
+         return;
+      }
+
+      if (this->how != QEArchiveInterface::Raw) {
+         std::cout << colour::yellow
+                   << "warning: --shards only applicable to --raw data - ignored"
+                   << colour::reset << std::endl;
+         this->numberShards = 1;
+      } else if (!this->options->isSpecified ("concurrent")) {
+         // No point in sharding unless the shards are fetched concurrently.
+         //
+         this->maxInFlight = MAX (this->maxInFlight, this->numberShards);
+      }
+   }
+
+   // The cache is only applicable to raw data - linear interpolated values
+   // depend on the overall request time span.
+   //
+   if (this->options->getBool ("cache") || this->options->isSpecified ("cache-dir")) {
+      if (this->how != QEArchiveInterface::Raw) {
+         std::cout << colour::yellow
+                   << "warning: --cache only applicable to --raw data - ignored"
+                   << colour::reset << std::endl;
+      } else if (this->isReducing) {
+         std::cout << colour::yellow
+                   << "warning: --cache not applicable with --mode - ignored"
+                   << colour::reset << std::endl;
+      } else if (this->options->getBool ("stream")) {
+         std::cout << colour::yellow
+                   << "warning: --cache not applicable with --stream - ignored"
+                   << colour::reset << std::endl;
+      } else {
+         // Key the cache by archiver so that data are not mixed.
+         //
+         QEAdaptationParameters ap ("QE_");
+         const QString archives = ap.getString ("archive_list", "");
+         const QString key = QString::fromLatin1 (QCryptographicHash::hash (archives.toUtf8 (),
+                                                  QCryptographicHash::Md5).toHex ().left (12));
+
+         const QString directory = this->options->getString ("cache-dir", Rad_Cache::defaultDirectory ());
+         this->cache = new Rad_Cache (directory, key);
+         std::cout << "cache directory: " << directory.toLatin1 ().data () << std::endl;
+      }
+   }
+
+   const QString format = this->options->getString ("format", this->isWaveform ? "binary" : "text");
+   if (format == "text") {
+      this->outputFormat = textFormat;
+   } else if (format == "binary") {
+      this->outputFormat = binaryFormat;
+   } else if (format == "csv") {
+      this->outputFormat = csvFormat;
+   } else if (format == "tsv") {
+      this->outputFormat = tsvFormat;
+   } else if (format == "columnar") {
+      this->outputFormat = columnarFormat;
+   } else {
+      this->usage (QString ("Invalid output format \"%1\", must be text, binary, csv, tsv or columnar").arg (format));
+      return;
+   }
+
+   if (this->isWaveform &&
+       (this->outputFormat != textFormat) && (this->outputFormat != binaryFormat)) {
+      this->usage ("--elements requires text or binary format");
+      return;
+   }
+
+   const bool isExport = (this->outputFormat == csvFormat) ||
+                         (this->outputFormat == tsvFormat) ||
+                         (this->outputFormat == columnarFormat);
+
+   this->exportColumns = timeColumn | relativeColumn | valueColumn;
+   if (this->options->isSpecified ("columns")) {
+      const QStringList names = this->options->getString ("columns", "").split (",");
+      this->exportColumns = 0;
+      for (j = 0; j < names.count (); j++) {
+         const QString name = names.value (j).trimmed ();
+         if (name == "time") {
+            this->exportColumns |= timeColumn;
+         } else if (name == "relative") {
+            this->exportColumns |= relativeColumn;
+         } else if (name == "value") {
+            this->exportColumns |= valueColumn;
+         } else if (name == "severity") {
+            this->exportColumns |= severityColumn;
+         } else if (name == "status") {
+            this->exportColumns |= statusColumn;
+         } else {
+            this->usage (QString ("Invalid column \"%1\", must be time, relative, value, severity or status").arg (name));
+            return;
+         }
+      }
+
+      if (!isExport) {
+         std::cout << colour::yellow
+                   << "warning: --columns only applicable to csv, tsv and columnar formats - ignored"
+                   << colour::reset << std::endl;
+      }
+   }
+
+   this->useLongLayout = false;
+   if (this->options->isSpecified ("layout")) {
+      const QString layout = this->options->getString ("layout", "wide");
+      if (layout == "long") {
+         this->useLongLayout = true;
+      } else if (layout != "wide") {
+         this->usage (QString ("Invalid layout \"%1\", must be wide or long").arg (layout));
+         return;
+      }
+
+      if (!isExport) {
+         std::cout << colour::yellow
+                   << "warning: --layout only applicable to csv, tsv and columnar formats - ignored"
+                   << colour::reset << std::endl;
+         this->useLongLayout = false;
+      }
+   }
+
    this->outputFile = this->options->getParameter (0);
    if (this->outputFile.isEmpty()) {
       this->usage ("missing output file");
       return;
    }
 
+   // Compressed output - as per the file name, or requested explicitly.
+   //
+   this->useCompression = Rad_GzipFile::isGzipName (this->outputFile);
+   if (this->options->getBool ("compress") && !this->useCompression) {
+      this->useCompression = true;
+      this->outputFile.append (".gz");
+   }
+
+   if (this->useCompression &&
+       ((this->outputFormat == binaryFormat) || (this->outputFormat == columnarFormat))) {
+      std::cout << colour::yellow
+                << "warning: compression not applicable to binary and columnar formats - ignored"
+                << colour::reset << std::endl;
+      this->useCompression = false;
+   }
+
    timeImage = this->options->getParameter (1);
    this->startTime = this->value (timeImage, okay);
    if (!okay) {
@@ -306,429 +873,2143 @@ void Rad_Control::initialise ()
       this->usage ("Invalid end time format. Valid example is \"17/06/2020 16:30:00\"");
       return;
    }
+   this->isEndNow = (timeImage.trimmed ().toLower () == "now");
 
-   pv = this->options->getParameter (3);
-   if (pv.isEmpty()) {
-      this->usage ("missing pv name");
+   if (this->options->isSpecified ("appliance") &&
+       this->options->getString ("appliance", "").isEmpty ())
+   {
+      this->usage ("appliance requires the appliance retrieval URL");
       return;
    }
 
-   this->pvDataList [0].pvName = pv;
-   this->numberPVNames = 1;
-
-   for (j = 1; j < MaximumPVNames; j++) {
-      pv = this->options->getParameter (j + 3);
-      if (pv.isEmpty()) {
-         break;
+   // Request failure policy.
+   //
+   this->requestTimeout = defaultRequestTimeout;
+   if (this->options->isSpecified ("timeout")) {
+      this->requestTimeout = this->options->getFloat ("timeout", 0.0);
+      if (this->requestTimeout <= 0.0) {
+         this->usage ("timeout must be positive");
+         return;
       }
+   }
 
-      if (!this->useFixedTime) {
-         // Multiple PVs - must use fixed time.
-         //
-         this->useFixedTime = true;
-         this->fixedTime = 1.0;
-         std::cout  << colour::yellow
-                    << "warning: multiple PVs - auto selecting fixed time of 1.0 s"
-                    << colour::reset << std::endl;
+   this->maxRetries = defaultMaxRetries;
+   if (this->options->isSpecified ("retries")) {
+      this->maxRetries = this->options->getInt ("retries", -1);
+      if (this->maxRetries < 0) {
+         this->usage ("retries must not be negative");
+         return;
       }
-
-      this->pvDataList [j].pvName = pv;
-      this->pvDataList [j].isOkayStatus = false;
-      this->pvDataList [j].responseCount = 0;
-      this->pvDataList [j].archiveData.clear ();
-
-      this->numberPVNames = j + 1;
    }
 
-   line = "start time: ";
-   line.append (this->startTime.toString (stdFormat));
-   line.append (" ");
-   line.append (QEUtilities::getTimeZoneTLA (this->startTime));
-   std::cout << line.toStdString().c_str() << std::endl;
+   this->retryDelay = defaultRetryDelay;
+   if (this->options->isSpecified ("retry-delay")) {
+      this->retryDelay = this->options->getFloat ("retry-delay", -1.0);
+      if (this->retryDelay < 0.0) {
+         this->usage ("retry delay must not be negative");
+         return;
+      }
+   }
 
-   line = "end time:   ";
-   line.append (this->endTime.toString (stdFormat));
-   line.append (" ");
-   line.append (QEUtilities::getTimeZoneTLA (this->endTime));
-   std::cout << line.toStdString().c_str() << std::endl;
+   this->isPartial = this->options->getBool ("partial");
+   this->originTime = this->startTime;
 
-   QEAdaptationParameters ap ("QE_");
-   QString archives = ap.getString ("archive_list", "");
+   if (this->isReducing) {
+      if (this->useFixedTime) {
+         std::cout << colour::yellow
+                   << "warning: --fixed not applicable with --mode - ignored"
+                   << colour::reset << std::endl;
+         this->useFixedTime = false;
+      }
 
-   line = "archives: ";
-   line.append (archives);
-   std::cout << line.toStdString().c_str() << std::endl;
+      // Default to approximately 1000 bins. Whole seconds, as per the
+      // Archive Appliance operators.
+      //
+      const double span = this->startTime.secondsTo (this->endTime);
+      this->binWidth = MAX (1, (int) ceil (span / 1000.0));
+      if (this->options->isSpecified ("bin")) {
+         this->binWidth = this->options->getInt ("bin", 0);
+         if (this->binWidth < 1) {
+            std::cerr << colour::red
+                      << "error: bin width must be at least 1 second."
+                      << colour::reset << std::endl;
+            this->state = errorExit;
+            return;
+         }
+      }
 
-   this->archiveAccess = new QEArchiveAccess ();
+      // Only the Archive Appliance provides server side operators.
+      //
+      QEAdaptationParameters ap ("QE_");
+      const QString archiveType = ap.getString ("archive_type", "CA").toUpper ();
+      this->useServerReduction = (archiveType == "ARCHAPPL") &&
+                                 !Rad_Reducer::serverOperator (this->reduceMode).isEmpty () &&
+                                 !this->options->getBool ("client-reduce");
+
+      std::cout << "mode: " << this->options->getString ("mode", "").toLatin1 ().data ()
+                << ", bin width " << this->binWidth << " s, "
+                << (this->useServerReduction ? "server" : "client") << " side" << std::endl;
+   }
 
-   // Set up connection to archive access mamanger.
+   // Follow mode appends newer data to an existing output file.
    //
-   QObject::connect (this->archiveAccess, SIGNAL (setArchiveData (const QObject*, const bool, const QCaDataPointList&,
-                                                                  const QString&, const QString&)),
-                     this,                SLOT   (setArchiveData (const QObject*, const bool, const QCaDataPointList&,
-                                                                  const QString&, const QString&)));
+   this->isFollowing = this->options->getBool ("follow");
+   this->pollPeriod = 0.0;
+   if (this->isFollowing) {
+      if ((this->outputFormat != textFormat) &&
+          (this->outputFormat != csvFormat) && (this->outputFormat != tsvFormat)) {
+         this->usage ("--follow only applicable to text, csv and tsv formats");
+         return;
+      }
 
-   this->state = initialWait;    // First proper state
-}
+      if (this->useFixedTime || this->isReducing) {
+         this->usage ("--follow not applicable with --fixed or --mode");
+         return;
+      }
 
-//------------------------------------------------------------------------------
-//
-void Rad_Control::readArchive ()
+      if (this->useCompression) {
+         this->usage ("--follow not applicable to compressed output");
+         return;
+      }
+
+      if (this->cache) {
+         std::cout << colour::yellow
+                   << "warning: --cache not applicable with --follow - ignored"
+                   << colour::reset << std::endl;
+         delete this->cache;
+         this->cache = NULL;
+      }
+
+      if (this->options->isSpecified ("poll")) {
+         this->pollPeriod = this->options->getFloat ("poll", 0.0);
+         if (this->pollPeriod <= 0.0) {
+            this->usage ("poll period must be positive");
+            return;
+         }
+         if (!this->isEndNow) {
+            this->usage ("--poll requires an end_time of now");
+            return;
+         }
+      }
+   } else if (this->options->isSpecified ("poll")) {
+      std::cout << colour::yellow
+                << "warning: --poll only applicable with --follow - ignored"
+                << colour::reset << std::endl;
+   }
+
+   // PV names may come from the command line and/or from a file.
+   //
+   this->pvNameInput.clear ();
+   for (j = 3; true; j++) {
+      pv = this->options->getParameter (j);
+      if (pv.isEmpty()) {
+         break;
+      }
+      this->pvNameInput.append (pv);
+   }
+
+   if (this->options->isSpecified ("pv-file")) {
+      const QString pvFile = this->options->getString ("pv-file", "");
+      if (!Rad_Control::readPVFile (pvFile, this->pvNameInput)) {
+         return;
+      }
+   }
+
+   if (this->pvNameInput.isEmpty()) {
+      this->usage ("missing pv name");
+      return;
+   }
+
+   line = "start time: ";
+   line.append (this->startTime.toString (stdFormat));
+   line.append (" ");
+   line.append (QEUtilities::getTimeZoneTLA (this->startTime));
+   std::cout << line.toStdString().c_str() << std::endl;
+
+   line = "end time:   ";
+   line.append (this->endTime.toString (stdFormat));
+   line.append (" ");
+   line.append (QEUtilities::getTimeZoneTLA (this->endTime));
+   std::cout << line.toStdString().c_str() << std::endl;
+
+   QEAdaptationParameters ap ("QE_");
+   QString archives = ap.getString ("archive_list", "");
+   if (this->options->isSpecified ("appliance")) {
+      archives = this->options->getString ("appliance", "") + " (direct)";
+   }
+
+   line = "archives: ";
+   line.append (archives);
+   std::cout << line.toStdString().c_str() << std::endl;
+
+   if (!this->archiveSource) {
+      this->archiveSource = Rad_ArchiveSource::create (this->options);
+   }
+
+   // Set up connection to archive source.
+   //
+   QObject::connect (this->archiveSource, SIGNAL (setArchiveData (const QObject*, const bool, const QCaDataPointList&,
+                                                                  const QString&, const QString&)),
+                     this,                SLOT   (setArchiveData (const QObject*, const bool, const QCaDataPointList&,
+                                                                  const QString&, const QString&)));
+
+   QObject::connect (this->archiveSource, SIGNAL (setPartialArchiveData (const QObject*, const QCaDataPointList&,
+                                                                         const QString&)),
+                     this,                SLOT   (setPartialArchiveData (const QObject*, const QCaDataPointList&,
+                                                                         const QString&)));
+
+   QObject::connect (this->archiveSource, SIGNAL (bytesReceived (const QObject*, const qint64)),
+                     this,                SLOT   (archiveBytesReceived (const QObject*, const qint64)));
+
+   QObject::connect (this->archiveSource, SIGNAL (statusChanged ()),
+                     this,                SLOT   (archiveStatus ()));
+
+   this->state = waitArchiverReady;    // First proper state
+}
+
+//------------------------------------------------------------------------------
+// static
+bool Rad_Control::readPVFile (const QString& filename, QStringList& pvNames)
+{
+   QFile pvFile;
+   bool okay;
+
+   // '-' denotes standard input.
+   //
+   if (filename == "-") {
+      okay = pvFile.open (stdin, QIODevice::ReadOnly | QIODevice::Text);
+   } else {
+      pvFile.setFileName (filename);
+      okay = pvFile.open (QIODevice::ReadOnly | QIODevice::Text);
+   }
+
+   if (!okay) {
+      std::cerr << colour::red
+                << "error: cannot open PV file: " << filename.toLatin1 ().data ()
+                << colour::reset << std::endl;
+      return false;
+   }
+
+   QTextStream source (&pvFile);
+   while (!source.atEnd ()) {
+      QString line = source.readLine ();
+
+      // Allow # comments, either whole line or trailing.
+      //
+      const int hash = line.indexOf ('#');
+      if (hash >= 0) line.truncate (hash);
+      line = line.trimmed ();
+
+      if (!line.isEmpty ()) {
+         pvNames.append (line);
+      }
+   }
+
+   pvFile.close ();
+   return true;
+}
+
+//------------------------------------------------------------------------------
+// static
+bool Rad_Control::isPattern (const QString& pvName)
+{
+   return pvName.contains ('*') || pvName.contains ('?') || pvName.contains ('[');
+}
+
+//------------------------------------------------------------------------------
+// Expand any wild card names using the archiver's PV name catalogue.
+// Output order follows the input order, duplicates are removed.
+//
+QStringList Rad_Control::expandPVNames (const QStringList& input) const
+{
+   QStringList result;
+   QStringList catalogue;
+   bool catalogueLoaded = false;
+
+   for (int j = 0; j < input.count (); j++) {
+      const QString name = input.value (j);
+
+      if (!Rad_Control::isPattern (name)) {
+         if (!result.contains (name)) result.append (name);
+         continue;
+      }
+
+      if (!catalogueLoaded) {
+         catalogue = this->archiveSource->getAllPVs ();
+         catalogue.sort ();
+         catalogueLoaded = true;
+      }
+
+      const QRegularExpression re (QRegularExpression::wildcardToRegularExpression (name));
+      int count = 0;
+      for (int k = 0; k < catalogue.count (); k++) {
+         const QString candidate = catalogue.value (k);
+         if (re.match (candidate).hasMatch ()) {
+            if (!result.contains (candidate)) result.append (candidate);
+            count++;
+         }
+      }
+
+      std::cout << "pattern " << name.toLatin1 ().data ()
+                << " matched " << count << " PV name(s)" << std::endl;
+      if (count == 0) {
+         std::cout << colour::yellow
+                   << "warning: no archived PVs match " << name.toLatin1 ().data ()
+                   << colour::reset << std::endl;
+      }
+   }
+
+   return result;
+}
+
+//------------------------------------------------------------------------------
+// Creates the per PV data structures. Returns false if there are no PVs.
+//
+bool Rad_Control::setUpPVData (const QStringList& pvNames)
+{
+   this->pvDataList.clear ();
+   this->numberPVNames = 0;
+
+   // Array PV - one PVData per element, named as per PV[element].
+   //
+   QStringList names = pvNames;
+   if (this->isWaveform) {
+      if (pvNames.count () != 1) {
+         std::cerr << colour::red
+                   << "error: --elements requires a single PV"
+                   << colour::reset << std::endl;
+         return false;
+      }
+
+      names.clear ();
+      for (int e = 0; e < this->numberElements; e++) {
+         names.append (QString ("%1[%2]").arg (pvNames.value (0)).arg (this->firstElement + e));
+      }
+      this->waveform = Rad_Waveform (this->numberElements);
+      this->archiveSource->setElementRange (pvNames.value (0), this->firstElement,
+                                            this->numberElements);
+   }
+
+   for (int j = 0; j < names.count (); j++) {
+      if ((j > 0) && !this->useFixedTime && !this->useLongLayout && !this->isReducing &&
+          !this->isWaveform && (this->alignGrid == Rad_Aligner::fixedGrid)) {
+         // Multiple PVs - must use fixed time unless aligned on the union
+         // of the PVs' times, or output in long form.
+         //
+         this->useFixedTime = true;
+         this->fixedTime = 1.0;
+         std::cout  << colour::yellow
+                    << "warning: multiple PVs - auto selecting fixed time of 1.0 s"
+                    << colour::reset << std::endl;
+      }
+
+      struct PVData pvData;
+      pvData.pvName = names.value (j);
+      pvData.archiveName = this->isWaveform ? pvNames.value (0) : pvData.pvName;
+      pvData.element = this->isWaveform ? this->firstElement + j : 0;
+      pvData.index = j;
+      pvData.isOkayStatus = false;
+      pvData.isFetchFailed = false;
+      pvData.isFailed = false;
+      pvData.numberSegmentsComplete = 0;
+      pvData.streamHead = 0;
+      pvData.streamCount = 0;
+      pvData.streamFirst = 0;
+      pvData.pages = 0;
+      pvData.points = 0;
+      pvData.reducer = NULL;
+
+      this->pvDataList.append (pvData);
+      this->numberPVNames = j + 1;
+   }
+
+   if (this->numberPVNames == 0) {
+      std::cerr << colour::red
+                << "error: no PV names to process"
+                << colour::reset << std::endl;
+      return false;
+   }
+
+   std::cout << "number of PVs: " << this->numberPVNames << std::endl;
+
+   // Streaming writes each page as it arrives, so is only applicable when
+   // no re-sampling/alignment of the whole data set is required.
+   //
+   this->useStreaming = false;
+   if (this->options->getBool ("stream")) {
+      if ((this->numberPVNames == 1) && !this->useFixedTime && !this->isReducing &&
+          !this->isWaveform &&
+          ((this->outputFormat == textFormat) || (this->outputFormat == binaryFormat)))
+      {
+         this->useStreaming = true;
+      } else {
+         std::cout << colour::yellow
+                   << "warning: --stream only applicable to a single scalar PV without --fixed or --mode, text or binary format - ignored"
+                   << colour::reset << std::endl;
+      }
+   }
+
+   // Follow mode - rows are only ever appended, so there can be no alignment
+   // with the existing rows.
+   //
+   if (this->isFollowing) {
+      if (this->isWaveform) {
+         std::cerr << colour::red
+                   << "error: --follow not applicable with --elements"
+                   << colour::reset << std::endl;
+         return false;
+      }
+
+      if ((this->numberPVNames > 1) &&
+          ((this->outputFormat == textFormat) || !this->useLongLayout)) {
+         std::cerr << colour::red
+                   << "error: --follow requires a single PV, or csv/tsv format with --layout=long"
+                   << colour::reset << std::endl;
+         return false;
+      }
+
+      // Text rows are appended as they arrive, as per --stream.
+      //
+      this->useStreaming = (this->outputFormat == textFormat);
+   }
+
+   return true;
+}
+
+//------------------------------------------------------------------------------
+// Determine where the existing output file left off, and hence the time from
+// which each PV is requested. PVs not in the file (or all PVs if there is no
+// file) are requested from the start time as per usual.
+//
+bool Rad_Control::readFollowFile ()
+{
+   Rad_FollowFile file (this->outputFile);
+   bool okay;
+
+   if (this->outputFormat == textFormat) {
+      okay = file.readText (this->timeZoneSpec);
+   } else {
+      // No data yet, so this is just the columns.
+      //
+      Rad_ExportTable table;
+      this->buildExportTable (table);
+      const char separator = (this->outputFormat == tsvFormat) ? '\t' : ',';
+      okay = file.readDelimited (separator, table.header (separator), this->pvNameList ());
+   }
+   if (!okay) return false;
+
+   this->isAppending = !file.isEmpty ();
+   this->followOffset = file.trailerOffset ();
+   this->originTime = file.origin ().isValid () ? file.origin () : this->startTime;
+
+   for (int j = 0; j < this->numberPVNames; j++) {
+      struct PVData* pvData = &this->pvDataList [j];
+      const QString key = this->useLongLayout ? pvData->pvName : QString ("");
+
+      pvData->followTime = QCaDateTime ();
+      if (!file.contains (key)) continue;
+
+      // The last row's actual time may be anywhere within the resolution of
+      // the file's time stamps - all such data has already been output.
+      //
+      const Rad_FollowFile::Position position = file.position (key);
+      pvData->followTime = Rad_Cache::fromEpochNanoSeconds (
+               Rad_BinaryWriter::toEpochNanoSeconds (position.lastTime) + file.resolution () - 1);
+
+      pvData->streamFirst = position.lastRow;
+      pvData->streamCount = position.lastRow;
+      pvData->streamOrigin = this->toRadTime (this->originTime);
+      pvData->streamPrevious = pvData->followTime;
+
+      std::cout << "following " << pvData->pvName.toLatin1 ().data () << " from "
+                << this->toRadTime (position.lastTime).toString (stdFormat).toLatin1 ().data ()
+                << std::endl;
+   }
+
+   return true;
+}
+
+//------------------------------------------------------------------------------
+// Determine the time ranges (segments) to be fetched for each PV. Returns
+// the number of PVs that still require data from the archiver.
+//
+int Rad_Control::setUpSegments ()
+{
+   int result = 0;
+
+   // Release the previous cycle's request tags, so that the number of tags
+   // is bounded under --follow. Tags of timed out requests are retained for
+   // one further cycle, so that a late response is still ignored as such.
+   //
+   for (int j = 0; j < this->segmentList.count (); j++) {
+      this->segmentList [j].requestTag->deleteLater ();
+   }
+
+   QSet<const QObject*>::const_iterator it;
+   for (it = this->previousStaleTags.constBegin (); it != this->previousStaleTags.constEnd (); ++it) {
+      const_cast<QObject*> (*it)->deleteLater ();
+   }
+   this->previousStaleTags = this->staleTags;
+   this->staleTags.clear ();
+
+   this->segmentList.clear ();
+   this->requestTagMap.clear ();
+   this->pendingList.clear ();
+
+   for (int j = 0; j < this->numberPVNames; j++) {
+      struct PVData* pvData = &this->pvDataList [j];
+      QList<TimeRange> ranges;
+
+      pvData->segments.clear ();
+      pvData->numberSegmentsComplete = 0;
+      pvData->streamHead = 0;
+
+      if (this->isReducing) {
+         delete pvData->reducer;
+         pvData->reducer = new Rad_Reducer (this->reduceMode, (qint64) this->binWidth * 1000000000,
+                                            Rad_BinaryWriter::toEpochNanoSeconds (this->startTime),
+                                            Rad_BinaryWriter::toEpochNanoSeconds (this->endTime));
+      }
+
+      if (this->cache) {
+         ranges = this->planCachedFetch (pvData);
+      } else {
+         // When following, only request what is not already in the file.
+         //
+         TimeRange range;
+         range.start = this->startTime;
+         if (pvData->followTime.isValid () && (pvData->followTime > range.start)) {
+            range.start = pvData->followTime;
+         }
+         range.end = this->endTime;
+         if (range.start < range.end) ranges.append (range);
+      }
+
+      // Split each range into shards that are paged independently.
+      //
+      for (int r = 0; r < ranges.count (); r++) {
+         const TimeRange range = ranges.value (r);
+         const double span = range.start.secondsTo (range.end);
+         const int number = MAX (1, MIN (this->numberShards, (int) (span / minimumShardSpan)));
+
+         QCaDateTime start = range.start;
+         for (int s = 1; s <= number; s++) {
+            QCaDateTime end;
+            if (s < number) {
+               end = range.start.addMSecs ((qint64) (1000.0 * span * s / number));
+               if (this->isReducing) {
+                  // Keep bins wholly within a shard.
+                  //
+                  const qint64 width = (qint64) this->binWidth * 1000000000;
+                  const qint64 snapped = Rad_Reducer::binStart (Rad_BinaryWriter::toEpochNanoSeconds (end), width);
+                  end = Rad_Cache::fromEpochNanoSeconds (snapped);
+                  if (end <= start) continue;
+               }
+            } else {
+               end = range.end;
+            }
+            this->addSegment (pvData, start, end);
+            start = end;
+         }
+      }
+
+      if (pvData->segments.isEmpty ()) {
+         // Wholly satisfied from the cache - this PV is already done.
+         //
+         this->completePV (pvData);
+      } else {
+         result++;
+      }
+   }
+
+   return result;
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Control::addSegment (struct PVData* pvData,
+                              const QCaDateTime& start, const QCaDateTime& end)
+{
+   struct Segment segment;
+
+   segment.pvIndex = pvData->index;
+   segment.requestTag = new QObject (this);
+   segment.startTime = start;
+   segment.nextTime = start;
+   segment.endTime = end;
+   segment.isInFlight = false;
+   segment.isServerReduced = this->useServerReduction;
+   segment.isComplete = false;
+   segment.pointsReceived = 0;
+   segment.retries = 0;
+
+   // When following, treat the data already output as received, i.e. as per
+   // Raw paging, skip the overlap.
+   //
+   if (pvData->followTime.isValid () && (start <= pvData->followTime)) {
+      segment.lastTime = pvData->followTime;
+   }
+
+   const int index = this->segmentList.count ();
+   this->segmentList.append (segment);
+   this->requestTagMap.insert (segment.requestTag, index);
+   this->pendingList.append (index);
+   pvData->segments.append (index);
+}
+
+//------------------------------------------------------------------------------
+// Issue requests for pending segments, up to the concurrent request limit.
+//
+void Rad_Control::sendRequests ()
+{
+   while ((this->numberInFlight < this->maxInFlight) && !this->pendingList.isEmpty ()) {
+      const int index = this->pendingList.takeFirst ();
+      this->readArchive (&this->segmentList [index]);
+   }
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_Control::Segment* Rad_Control::findSegment (const QObject* userData,
+                                                const QString& pvName)
+{
+   // Responses to timed out requests are too late.
+   //
+   if (this->staleTags.contains (userData)) return NULL;
+
+   // Match on the request tag first, fall back to the PV name.
+   //
+   const int index = this->requestTagMap.value (userData, -1);
+   if (index >= 0) {
+      struct Segment* segment = &this->segmentList [index];
+      if (segment->isInFlight) return segment;
+   }
+
+   // The PV name may well be in use by another batch job.
+   //
+   if (this->isEmbedded) return NULL;
+
+   for (int j = 0; j < this->segmentList.count (); j++) {
+      struct Segment* segment = &this->segmentList [j];
+      if (segment->isInFlight &&
+          (this->pvDataList [segment->pvIndex].archiveName == pvName)) return segment;
+   }
+
+   return NULL;
+}
+
+//------------------------------------------------------------------------------
+// Determine the number of points to request for the next request of the
+// given segment, never more than maxPoints.
+//
+int Rad_Control::requestPointCount (const struct Segment* segment) const
+{
+   const double span = segment->nextTime.secondsTo (segment->endTime);
+   double estimate;
+
+   if (segment->isServerReduced) {
+      // One point per bin, plus a bin either end.
+      //
+      return (int) MAX (1.0, MIN ((double) this->maxPoints, span / this->binWidth + 2.0));
+   }
+
+   if (this->how == QEArchiveInterface::Linear) {
+      if (!this->useFixedTime) return this->maxPoints;
+
+      // Interpolated points are subsequently re-sampled at the fixed interval,
+      // twice that density is sufficient.
+      //
+      estimate = 2.0 * span / this->fixedTime;
+
+   } else {
+      // Raw - use the point density observed so far in this segment, plus a
+      // margin, to size the request for the remaining span. With no history
+      // we know nothing, so ask for the maximum.
+      //
+      if (segment->pointsReceived <= 0 || !segment->firstTime.isValid ()) {
+         return this->maxPoints;
+      }
+
+      const double covered = segment->firstTime.secondsTo (segment->lastTime);
+      if (covered <= 0.0) return this->maxPoints;
+
+      const double density = segment->pointsReceived / covered;
+      estimate = 1.1 * density * span;
+   }
+
+   return (int) MAX ((double) minimumPoints, MIN (estimate, (double) this->maxPoints));
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Control::readArchive (struct Segment* segment)
+{
+   if (!segment) {
+      std::cerr << colour::red
+                << "Null segment pointer"
+                << colour::reset << std::endl;
+      exit (1);
+      return;
+   }
+
+   const struct PVData* pvData = &this->pvDataList [segment->pvIndex];
+   QString pvName = pvData->pvName;
+   QCaDateTime adjustedEndTime;
+   double interval;
+
+   // Add 5% - and ensure at least 60 seconds.
+   //
+   interval = segment->nextTime.secondsTo (segment->endTime);
+   interval = MAX (interval * 1.05, 60.0);
+
+   adjustedEndTime = segment->nextTime.addSecs ((int) interval);
+
+   // The archivers work in UTC
+   // Maybe readArchive should be modified to do this based on the
+   // time zone in the start/finish times.
+   //
+   QDateTime t0 = segment->nextTime.toUTC();
+   QDateTime t1 = adjustedEndTime.toUTC();
+
+   // Server side reduction, if still in use, must apply to the whole segment.
+   //
+   if (!this->useServerReduction && !segment->lastTime.isValid ()) {
+      segment->isServerReduced = false;
+   }
+
+   // Archive Appliance operator syntax, e.g. mean_600(PV:NAME)
+   //
+   QString requestName = pvData->archiveName;
+   if (segment->isServerReduced) {
+      requestName = QString ("%1_%2(%3)")
+            .arg (Rad_Reducer::serverOperator (this->reduceMode))
+            .arg (this->binWidth).arg (pvData->archiveName);
+   }
+
+   const int count = this->requestPointCount (segment);
+
+   segment->isInFlight = true;
+   this->numberInFlight++;
+
+   this->statistics.increment (Rad_Statistics::Requests);
+   segment->requestTimer.start ();
+   this->archiveSource->readArchive (segment->requestTag, requestName, t0, t1,
+                                     count, this->how, pvData->element);
+
+   // Segment times are held as received, i.e. in UTC - convert for display.
+   //
+   adjustedEndTime = this->toRadTime (adjustedEndTime);
+
+   std::cout << "\nArchiver request issued:    "
+             << pvName.toLatin1 ().data ()
+             << " ("<< this->toRadTime (segment->nextTime).toString(stdFormat).toLatin1 ().data ()
+             << " to " << adjustedEndTime.toString(stdFormat).toLatin1 ().data ()
+             << " " << QEUtilities::getTimeZoneTLA (adjustedEndTime).toLatin1 ().data ()
+             << ", " << count << " points"
+             << ")" << std::endl;
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Control::setArchiveData (const QObject* userData, const bool okay,
+                                  const QCaDataPointList& archiveDataIn,
+                                  const QString& responsePvName, const QString& supplementary)
+{
+   if (this->state == terminated) return;
+
+   struct Segment* segment = this->findSegment (userData, responsePvName);
+   if (!segment) {
+      // Batch jobs share the archive source, i.e. other jobs' responses.
+      //
+      if (this->isEmbedded) return;
+
+      std::cerr << colour::yellow
+                << "warning: unexpected archiver response for "
+                << responsePvName.toLatin1 ().data ()
+                << " ignored" << colour::reset << std::endl;
+      return;
+   }
+
+   segment->isInFlight = false;
+   this->numberInFlight--;
+   this->reminderTimer.start ();
+   this->statistics.increment (Rad_Statistics::Responses);
+   this->statistics.increment (Rad_Statistics::PointsReceived, archiveDataIn.count ());
+   this->statistics.sample (Rad_Statistics::RoundTrip, segment->requestTimer.nsecsElapsed ());
+
+   struct PVData* pvData = &this->pvDataList [segment->pvIndex];
+   pvData->pages++;
+   const int index = (int) (segment - this->segmentList.constData ());
+   QString pvName = pvData->pvName;
+   QString line;
+   QCaDateTime firstTime;
+   QCaDateTime lastTime;
+
+   int number = archiveDataIn.count ();
+
+   line = "Archiver response received: ";
+   line.append (pvName);
+   line.append (" status: ");
+   line.append (okay ? "okay" : "failed");
+   line.append (", number of points: ");
+   line.append (QString ("%1").arg (number));
+   line.append ("\n");
+   line.append (supplementary);
+
+   // Times are retained as received from the archiver (UTC) and are only
+   // converted to the required time zone for display and output.
+   //
+   if (number > 0) {
+      firstTime = this->toRadTime (archiveDataIn.value (0).datetime);
+      lastTime =  this->toRadTime (archiveDataIn.value (number - 1).datetime);
+
+      line.append (" (");
+      line.append (firstTime.toString (stdFormat));
+      line.append (" to ");
+      line.append (lastTime.toString (stdFormat));
+      line.append (" ");
+      line.append (QEUtilities::getTimeZoneTLA (lastTime));
+      line.append (")");
+   }
+
+   line.append ("\n");
+   std::cout << line.toLatin1 ().data ();
+
+   // Now start processing the data in earnets.
+   //
+   bool moreData = false;
+
+   if (!okay && segment->isServerReduced) {
+      // Assume the operator is not supported - reduce client side instead,
+      // for this and all subsequent segments.
+      //
+      std::cout << colour::yellow
+                << "warning: server side reduction failed for "
+                << pvName.toLatin1 ().data ()
+                << " - using client side reduction"
+                << colour::reset << std::endl;
+
+      this->useServerReduction = false;
+      segment->isServerReduced = false;
+      segment->nextTime = segment->startTime;
+      segment->firstTime = QCaDateTime ();
+      segment->lastTime = QCaDateTime ();
+      segment->pointsReceived = 0;
+      segment->archiveData.clear ();
+      this->pendingList.append (index);
+      moreData = true;
+
+   } else if (!okay) {
+      // Try again from where this segment is up to, i.e. nextTime.
+      //
+      moreData = this->scheduleRetry (segment);
+
+   } else {
+      segment->retries = 0;
+   }
+
+   if (okay && number > 0) {
+      this->ingestData (segment, archiveDataIn);
+   }
+
+   // Unpaged sources return the whole time range in the one response.
+   //
+   lastTime = segment->lastTime;
+
+   if (okay && lastTime.isValid () &&
+       (this->how == QEArchiveInterface::Raw) &&
+       this->archiveSource->isPaged () &&
+       (lastTime < segment->endTime) &&
+       (lastTime > segment->nextTime))
+   {
+      std::cout << "requesting more data ... " << std::endl;
+      segment->nextTime = lastTime;
+      this->pendingList.append (index);
+      moreData = true;
+   }
+
+   this->concludeResponse (segment, moreData);
+}
+
+//------------------------------------------------------------------------------
+// A leading part of a response, from a source that decodes incrementally.
+// This is ingested now, so that processing overlaps the transfer.
+//
+void Rad_Control::setPartialArchiveData (const QObject* userData,
+                                         const QCaDataPointList& archiveDataIn,
+                                         const QString& responsePvName)
+{
+   if (this->state == terminated) return;
+
+   // Any warning is given for the final part of the response.
+   //
+   struct Segment* segment = this->findSegment (userData, responsePvName);
+   if (!segment) return;
+
+   // The request timeout applies to the time between parts.
+   //
+   segment->requestTimer.start ();
+   this->reminderTimer.start ();
+   this->statistics.increment (Rad_Statistics::PointsReceived, archiveDataIn.count ());
+
+   if (archiveDataIn.count () > 0) {
+      this->ingestData (segment, archiveDataIn);
+   }
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Control::archiveBytesReceived (const QObject* userData, const qint64 bytes)
+{
+   if (this->state == terminated) return;
+   if (!this->findSegment (userData, QString ())) return;
+
+   this->statistics.increment (Rad_Statistics::BytesReceived, bytes);
+}
+
+//------------------------------------------------------------------------------
+// Adds a page, or part of, to the segment - common to whole and partial responses.
+//
+void Rad_Control::ingestData (struct Segment* segment, const QCaDataPointList& archiveDataIn)
+{
+   struct PVData* pvData = &this->pvDataList [segment->pvIndex];
+   const int index = (int) (segment - this->segmentList.constData ());
+   const int number = archiveDataIn.count ();
+
+   pvData->isOkayStatus = true;
+
+   this->statistics.start (Rad_Statistics::Ingest);
+
+   // Subsequent update - skip any overlap times.
+   //
+   int first = 0;
+   if (segment->lastTime.isValid ()) {
+      first = Rad_Control::firstAfter (archiveDataIn, segment->lastTime);
+   }
+
+   this->statistics.increment (Rad_Statistics::OverlapDropped, first);
+   pvData->points += number - first;
+
+   if (first < number) {
+      if (!segment->firstTime.isValid ()) {
+         segment->firstTime = archiveDataIn.value (first).datetime;
+      }
+      segment->lastTime = archiveDataIn.value (number - 1).datetime;
+      segment->pointsReceived += number - first;
+   }
+
+   const bool isStreamHead = this->useStreaming &&
+                             (pvData->segments.value (pvData->streamHead) == index);
+
+   if (isStreamHead) {
+      // Write this page now - only the current page is held in memory.
+      // Any overlap is also removed by streamArchiveData.
+      //
+      this->statistics.stop (Rad_Statistics::Ingest);
+      this->streamArchiveData (pvData, archiveDataIn);
+   } else if (pvData->reducer && !segment->isServerReduced) {
+      // Reduce the page now - raw points are not retained.
+      //
+      pvData->reducer->addPoints (archiveDataIn, first,
+                                  Rad_BinaryWriter::toEpochNanoSeconds (segment->startTime),
+                                  Rad_BinaryWriter::toEpochNanoSeconds (segment->endTime));
+   } else {
+      // Pack the page - the page itself is released on return.
+      //
+      segment->archiveData.append (archiveDataIn, first);
+   }
+
+   this->statistics.stop (Rad_Statistics::Ingest);
+}
+
+//------------------------------------------------------------------------------
+// Returns true if a retry of the segment's current request has been scheduled.
+// Otherwise the segment, and hence the PV, has failed.
+//
+bool Rad_Control::scheduleRetry (struct Segment* segment)
 {
-   if (this->pvIndex < 0 || this->pvIndex >= ARRAY_LENGTH (this->pvDataList)) {
+   struct PVData* pvData = &this->pvDataList [segment->pvIndex];
+   const int index = (int) (segment - this->segmentList.constData ());
+
+   if (segment->retries >= this->maxRetries) {
       std::cerr << colour::red
-                << "PV index (" << this->pvIndex << ") out of range"
+                << "error: archiver request for "
+                << pvData->pvName.toLatin1 ().data ()
+                << " failed after " << segment->retries << " retries"
                 << colour::reset << std::endl;
-      exit (1);
+
+      // Do not update the cache for this PV.
+      //
+      pvData->isFetchFailed = true;
+      pvData->isFailed = true;
+      return false;
+   }
+
+   // Resume from the last point received, e.g. after a partial response.
+   //
+   if (segment->lastTime.isValid () && (segment->lastTime > segment->nextTime)) {
+      segment->nextTime = segment->lastTime;
+   }
+
+   double delay = this->retryDelay;
+   for (int j = 0; j < segment->retries; j++) delay *= 2.0;
+   delay = MIN (delay, maximumRetryDelay);
+
+   segment->retries++;
+   this->statistics.increment (Rad_Statistics::Retries);
+
+   std::cout << "retry " << segment->retries << " of " << this->maxRetries
+             << " for " << pvData->pvName.toLatin1 ().data ()
+             << " in " << delay << " s" << std::endl;
+
+   // The tag identifies this segment - the segment list is replaced on each
+   // poll, and the tag is replaced on a timeout.
+   //
+   const QPointer<QObject> tag (segment->requestTag);
+   QTimer::singleShot ((int) (1000.0 * delay), this, [this, index, tag] () {
+      this->retryRequest (index, tag.data ());
+   });
+   return true;
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Control::retryRequest (const int index, const QObject* requestTag)
+{
+   // E.g. terminated, or a subsequent poll with a new segment list.
+   //
+   if ((this->state != waitResponse) || !requestTag ||
+       (index >= this->segmentList.count ()) ||
+       (this->segmentList [index].requestTag != requestTag)) return;
+
+   this->pendingList.append (index);
+   this->state = sendRequest;
+   this->processState ();
+}
+
+//------------------------------------------------------------------------------
+// Common to responses and timeouts.
+//
+void Rad_Control::concludeResponse (struct Segment* segment, const bool moreData)
+{
+   struct PVData* pvData = &this->pvDataList [segment->pvIndex];
+
+   if (pvData->isFailed && !this->isPartial) {
+      std::cerr << colour::red
+                << "error: data incomplete - use --partial to write the data collected"
+                << colour::reset << std::endl;
+      this->state = errorExit;
+      this->processState ();
       return;
    }
 
-   struct PVData* pvData = &this->pvDataList [this->pvIndex];
-   QString pvName = pvData->pvName;
-   QCaDateTime adjustedEndTime;
-   double interval;
+   if (!moreData) {
+      // All done with this segment - for good or bad.
+      //
+      segment->isComplete = true;
+      pvData->numberSegmentsComplete++;
 
-   // Add 5% - and ensure at least 60 seconds.
+      if (this->useStreaming) {
+         this->advanceStream (pvData);
+      }
+
+      if (pvData->numberSegmentsComplete >= pvData->segments.count ()) {
+         // All done with this PV.
+         //
+         this->stitchSegments (pvData);
+         this->completePV (pvData);
+      }
+   }
+
+   if (this->numberComplete >= this->numberPVNames) {
+      this->state = printAll;
+   } else if (!this->pendingList.isEmpty ()) {
+      this->state = sendRequest;  // do next request(s)
+   }
+
+   // Otherwise still awaiting other responses and/or retries.
    //
-   interval = this->nextTime.secondsTo (this->endTime);
-   interval = MAX (interval * 1.05, 60.0);
+   this->processState ();
+}
 
-   adjustedEndTime = this->nextTime.addSecs ((int) interval);
+//------------------------------------------------------------------------------
+//
+int Rad_Control::numberFailed () const
+{
+   int result = 0;
+   for (int pv = 0 ; pv < this->numberPVNames; pv++) {
+      if (this->pvDataList [pv].isFailed) result++;
+   }
+   return result;
+}
 
-   // The archivers work in UTC
-   // Maybe readArchive should be modified to do this based on the
-   // time zone in the start/finish times.
+//------------------------------------------------------------------------------
+// static
+// Returns the index of the first point after the given time, or the number of
+// points if none. Points must be in time order.
+//
+int Rad_Control::firstAfter (const QCaDataPointList& points, const QCaDateTime& time)
+{
+   int low = 0;
+   int high = points.count ();
+
+   while (low < high) {
+      const int mid = low + (high - low) / 2;
+      if (points.value (mid).datetime <= time) {
+         low = mid + 1;
+      } else {
+         high = mid;
+      }
+   }
+   return low;
+}
+
+//------------------------------------------------------------------------------
+// Join the segments in time order - the same overlap removal as applied
+// to successive pages, i.e. drop points at or before the last time retained.
+//
+void Rad_Control::stitchSegments (struct PVData* pvData)
+{
+   Rad_Statistics::Timer timer (&this->statistics, Rad_Statistics::Ingest);
+   bool isFirst = true;
+   qint64 lastTime = 0;
+
+   pvData->archiveData.clear ();
+
+   for (int s = 0; s < pvData->segments.count (); s++) {
+      struct Segment* segment = &this->segmentList [pvData->segments.value (s)];
+      Rad_PointStore& data = segment->archiveData;
+      const int number = data.count ();
+
+      if (number > 0) {
+         const int first = isFirst ? 0 : data.firstAfter (lastTime);
+         pvData->archiveData.append (data, first);
+         this->statistics.increment (Rad_Statistics::OverlapDropped, first);
+         pvData->points -= first;
+         lastTime = data.time [number - 1];
+         isFirst = false;
+      }
+
+      data.clear ();
+   }
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Control::completePV (struct PVData* pvData)
+{
+   if (this->cache) this->mergeCachedData (pvData);
+   if (!this->useStreaming) this->postProcess (pvData);
+
+   // Array PV - add this element to the waveform, and release the element's
+   // own data set.
    //
-   QDateTime t0 = this->nextTime.toUTC();
-   QDateTime t1 = adjustedEndTime.toUTC();
+   if (this->isWaveform) {
+      const int dropped = this->waveform.addElement (pvData->element - this->firstElement,
+                                                     pvData->archiveData);
+      if (dropped > 0) {
+         std::cout << colour::yellow
+                   << "warning: " << dropped << " point(s) of "
+                   << pvData->pvName.toLatin1 ().data ()
+                   << " do not match the waveform sample times - dropped"
+                   << colour::reset << std::endl;
+      }
+      pvData->archiveData.clear ();
+   }
 
-   this->archiveAccess->readArchive (this, pvName, t0, t1,
-                                     20000, this->how, 0);
+   this->numberComplete++;
+}
 
-   std::cout << "\nArchiver request issued:    "
-             << pvName.toLatin1 ().data ()
-             << " ("<< this->nextTime.toString(stdFormat).toLatin1 ().data ()
-             << " to " << adjustedEndTime.toString(stdFormat).toLatin1 ().data ()
-             << " " << QEUtilities::getTimeZoneTLA (adjustedEndTime).toLatin1 ().data ()
-             << ")" << std::endl;
+//------------------------------------------------------------------------------
+// Read what we can from the cache, and determine the time ranges, aligned to
+// cache chunks, that must be fetched from the archiver.
+//
+QList<Rad_Control::TimeRange> Rad_Control::planCachedFetch (struct PVData* pvData)
+{
+   const qint64 size = this->cache->chunkSize ();
+   const qint64 first = this->cache->chunkOf (this->startTime);
+   const qint64 last = this->cache->chunkOf (this->endTime);
+   const qint64 startNs = Rad_BinaryWriter::toEpochNanoSeconds (this->startTime);
+
+   QList<TimeRange> result;
+
+   pvData->cachedData.clear ();
+   pvData->missingChunks.clear ();
+
+   bool inRun = false;
+   TimeRange run;
+
+   for (qint64 chunk = first; chunk <= last; chunk += size) {
+      Rad_PointStore points;
+
+      const bool isCached = this->cache->isClosed (chunk) &&
+                            this->cache->read (pvData->pvName, chunk, points);
+
+      // The value held at the start time may well precede the first chunk,
+      // i.e. the archiver's last point at or before the start time. Unless
+      // the cached first chunk has such a point, the chunk is fetched.
+      //
+      const bool isStartHeld = (chunk != first) || (points.firstAfter (startNs) > 0);
+
+      if (isCached && isStartHeld) {
+         if (inRun) {
+            run.end = QCaDateTime (this->toRadTime (this->cache->chunkTime (chunk)));
+            result.append (run);
+            inRun = false;
+         }
+
+         pvData->cachedData.append (points);
+
+      } else {
+         if (!isCached && this->cache->isClosed (chunk)) {
+            pvData->missingChunks.append (chunk);
+         }
+
+         if (!inRun) {
+            run.start = QCaDateTime (this->toRadTime (this->cache->chunkTime (chunk)));
+            inRun = true;
+         }
+      }
+   }
+
+   if (inRun) {
+      // Fetch to the end of the last chunk if closed, so that it may be cached.
+      //
+      if (this->cache->isClosed (last)) {
+         run.end = QCaDateTime (this->toRadTime (this->cache->chunkTime (last + size)));
+      } else {
+         run.end = this->endTime;
+      }
+      result.append (run);
+   }
+
+   std::cout << pvData->pvName.toLatin1 ().data () << ": "
+             << pvData->cachedData.count () << " points from cache, "
+             << result.count () << " range(s) to fetch" << std::endl;
+
+   return result;
 }
 
 //------------------------------------------------------------------------------
+// Write newly fetched closed chunks to the cache, then merge the cached and
+// fetched data in time order.
 //
-void Rad_Control::setArchiveData (const QObject*, const bool okay,
-                                  const QCaDataPointList& archiveDataIn,
-                                  const QString&, const QString& supplementary)
+void Rad_Control::mergeCachedData (struct PVData* pvData)
+{
+   const Rad_PointStore fetched = pvData->archiveData;
+   const int numberFetched = fetched.count ();
+
+   if (!pvData->isFetchFailed && !pvData->missingChunks.isEmpty ()) {
+      QSet<qint64> missing;
+      QMap<qint64, Rad_PointStore> grouped;
+
+      for (int c = 0; c < pvData->missingChunks.count (); c++) {
+         missing.insert (pvData->missingChunks.value (c));
+      }
+
+      for (int j = 0; j < numberFetched; j++) {
+         const qint64 chunk = this->cache->chunkOf (fetched.time [j]);
+         if (missing.contains (chunk)) {
+            grouped [chunk].appendPoint (fetched, j);
+         }
+      }
+
+      // Note: empty chunks are written too - they are valid for sparse PVs.
+      //
+      for (int c = 0; c < pvData->missingChunks.count (); c++) {
+         const qint64 chunk = pvData->missingChunks.value (c);
+         this->cache->write (pvData->pvName, chunk, grouped.value (chunk));
+      }
+   }
+
+   // Merge - cached chunks and fetched ranges are disjoint, but on equal
+   // times prefer the cached point. Chunks are aligned to the hour, not the
+   // start time, so skip points before the start time - except, as per an
+   // uncached request, the last point at or before the start time, from
+   // whichever source has the later such point.
+   //
+   const Rad_PointStore& cached = pvData->cachedData;
+   const qint64 startNs = Rad_BinaryWriter::toEpochNanoSeconds (this->startTime);
+   const int numberCached = cached.count ();
+   Rad_PointStore merged;
+   int i = cached.firstAfter (startNs);
+   int k = fetched.firstAfter (startNs);
+
+   if ((i > 0) && ((k == 0) || (cached.time [i - 1] >= fetched.time [k - 1]))) {
+      i--;
+   } else if (k > 0) {
+      k--;
+   }
+
+   merged.reserve (numberCached - i + numberFetched - k);
+
+   while ((i < numberCached) || (k < numberFetched)) {
+      if (k >= numberFetched) {
+         merged.appendPoint (cached, i++);
+      } else if (i >= numberCached) {
+         merged.appendPoint (fetched, k++);
+      } else if (fetched.time [k] < cached.time [i]) {
+         merged.appendPoint (fetched, k++);
+      } else {
+         if (fetched.time [k] == cached.time [i]) k++;
+         merged.appendPoint (cached, i++);
+      }
+   }
+
+   pvData->archiveData = merged;
+   pvData->cachedData.clear ();
+   if (merged.count () > 0) pvData->isOkayStatus = true;
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Control::postProcess (struct PVData* pvData)
 {
-   if ((this->pvIndex < 0) || (this->pvIndex >= ARRAY_LENGTH (this->pvDataList))) {
+   int number;
+
+   if (!pvData) {
       std::cerr << colour::red
-                << "PV index (" << this->pvIndex << ") out of range"
+                << "Null pvData pointer"
                 << colour::reset << std::endl;
       exit (1);
       return;
    }
 
-   struct PVData* pvData = &this->pvDataList [this->pvIndex];
-   QString pvName = pvData->pvName;
-   QString line;
-   QCaDateTime firstTime;
-   QCaDateTime lastTime;
+   Rad_Statistics::Timer timer (&this->statistics, Rad_Statistics::Resample);
 
-   int number = archiveDataIn.count ();
+   if (this->isReducing) {
+      this->reduce (pvData);
+      return;
+   }
 
-   line = "Archiver response received: ";
-   line.append (pvName);
-   line.append (" status: ");
-   line.append (okay ? "okay" : "failed");
-   line.append (", number of points: ");
-   line.append (QString ("%1").arg (number));
-   line.append ("\n");
-   line.append (supplementary);
+   // Multiple PV data sets are aligned together on output - see buildOutputTable -
+   // unless output in long form. Array PV elements are resampled individually,
+   // onto the same times.
+   //
+   if (this->useFixedTime &&
+       ((this->numberPVNames == 1) || this->useLongLayout || this->isWaveform)) {
+
+      number = pvData->archiveData.count ();
+      std::cout << "resampling ... " << number << " points";
+
+      // Resample onto the fixed grid as per multiple PV output, see
+      // buildOutputTable, but for this one series. Rows prior to the first
+      // point are omitted.
+      //
+      const Rad_PointStore& source = pvData->archiveData;
+      const Rad_Aligner aligner (Rad_Aligner::fixedGrid, this->alignFill,
+                                 Rad_BinaryWriter::toEpochNanoSeconds (this->startTime),
+                                 Rad_BinaryWriter::toEpochNanoSeconds (this->endTime),
+                                 (qint64) (this->fixedTime * 1.0e9));
+      Rad_Aligner::Table table;
+      aligner.align (QVector<Rad_Aligner::Series> (1, source), table);
+
+      const Rad_Aligner::Column& column = table.columns [0];
+      int first = 0;
+      if (number > 0) {
+         while ((first < table.numberRows) && (table.time [first] < source.time [0])) first++;
+      } else {
+         first = table.numberRows;
+      }
+
+      Rad_PointStore resampled;
+      resampled.time = table.time.mid (first);
+      resampled.value = column.value.mid (first);
+      resampled.severity = column.severity.mid (first);
+      resampled.status = column.status.mid (first);
+      resampled.isDisplayable = column.isDisplayable.mid (first);
+      pvData->archiveData = resampled;
+
+      number = pvData->archiveData.count ();
+      std::cout << " resampled to " << number << " points." << std::endl;
+
+   } else {
+      // Remove points beyond endTime, i.e. only retain the first point
+      // at/beyond endTime (though always keep at least two points).
+      //
+      const qint64 endNs = Rad_BinaryWriter::toEpochNanoSeconds (this->endTime);
+      const qint64* time = pvData->archiveData.time.constData ();
+
+      number = pvData->archiveData.count ();
+      while ((number > 2) && (time [number - 2] >= endNs)) number--;
+      pvData->archiveData.truncate (number);
+   }
+}
+
+//------------------------------------------------------------------------------
+// Combines server reduced points with any client side reduced points, the
+// latter from segments requested after a server side reduction failure.
+//
+void Rad_Control::reduce (struct PVData* pvData)
+{
+   const qint64 width = (qint64) this->binWidth * 1000000000;
+   const qint64 startNs = Rad_Reducer::binStart (Rad_BinaryWriter::toEpochNanoSeconds (this->startTime), width);
+   const qint64 endNs = Rad_BinaryWriter::toEpochNanoSeconds (this->endTime);
+
+   const Rad_PointStore& server = pvData->archiveData;
+   const int first = server.firstAfter (startNs - 1);
+   const int last = server.firstAfter (endNs - 1);
+
+   const QCaDataPointList client = pvData->reducer ? pvData->reducer->result ()
+                                                   : QCaDataPointList ();
+
+   // Segments are disjoint in time, so a simple merge suffices.
+   //
+   Rad_PointStore merged;
+   int s = first;
+   int c = 0;
+   while ((s < last) || (c < client.count ())) {
+      if ((c >= client.count ()) ||
+          ((s < last) &&
+           (server.time [s] <= Rad_BinaryWriter::toEpochNanoSeconds (client.value (c).datetime)))) {
+         merged.appendPoint (server, s++);
+      } else {
+         merged.append (client.value (c++));
+      }
+   }
+
+   pvData->archiveData = merged;
+   std::cout << "reduced to " << merged.count () << " points." << std::endl;
+}
+
+//------------------------------------------------------------------------------
+// Align all PVs' data sets onto a common time grid - either the fixed interval
+// grid or the union of all the PVs' times. PVs for which the archiver request
+// failed are output as invalid, i.e. nil.
+//
+void Rad_Control::buildOutputTable (Rad_Aligner::Table& table) const
+{
+   QVector<Rad_Aligner::Series> input (this->numberPVNames);
+
+   for (int pv = 0 ; pv < this->numberPVNames; pv++) {
+      const struct PVData* pvData = &this->pvDataList [pv];
+      if (pvData->isOkayStatus) {
+         input [pv] = pvData->archiveData;
+      }
+   }
+
+   // Reduced bins are stamped at epoch multiples of the bin width, so share
+   // times across PVs - the union grid aligns them exactly.
+   //
+   Rad_Aligner::Grids grid = this->useFixedTime ? Rad_Aligner::fixedGrid : this->alignGrid;
+   if (this->isReducing) grid = Rad_Aligner::unionGrid;
+
+   const Rad_Aligner aligner (grid, this->alignFill,
+                              Rad_BinaryWriter::toEpochNanoSeconds (this->startTime),
+                              Rad_BinaryWriter::toEpochNanoSeconds (this->endTime),
+                              (qint64) (this->fixedTime * 1.0e9));
+   aligner.align (input, table);
+
+   std::cout << "aligned " << this->numberPVNames << " PVs to "
+             << table.numberRows << " rows" << std::endl;
+}
+
+//------------------------------------------------------------------------------
+//
+QStringList Rad_Control::pvNameList () const
+{
+   QStringList result;
+   for (int pv = 0 ; pv < this->numberPVNames; pv++) {
+      result.append (this->pvDataList [pv].pvName);
+   }
+   return result;
+}
+
+//------------------------------------------------------------------------------
+// Binary (columnar) output - see rad_binary_writer.h for format.
+//
+void Rad_Control::putBinaryArchiveData ()
+{
+   Rad_BinaryWriter writer (this->outputFile, this->pvNameList ());
+
+   if (!writer.open ()) {
+      this->state = errorExit;
+      return;
+   }
 
-   // We need a working copy - archiveDataIn is const.
-   // Also need to adjust time zone
-   //
-   QCaDataPointList working;
-   for (int j = 0; j < number; j++) {
-      QCaDataPoint item = archiveDataIn.value (j);
-      item.datetime = this->toRadTime (item.datetime);
-      working.append (item);
+   if (this->numberPVNames == 1) {
+      this->statistics.start (Rad_Statistics::Write);
+      writer.appendPoints (this->pvDataList [0].archiveData);
+   } else {
+      Rad_Aligner::Table table;
+      this->statistics.start (Rad_Statistics::Resample);
+      this->buildOutputTable (table);
+      this->statistics.stop (Rad_Statistics::Resample);
+      this->statistics.start (Rad_Statistics::Write);
+
+      // Row buffers, re-used for each row.
+      //
+      QVector<double> values (this->numberPVNames);
+      QVector<quint16> severity (this->numberPVNames);
+      QVector<quint16> status (this->numberPVNames);
+
+      for (int j = 0; j < table.numberRows; j++) {
+         for (int pv = 0 ; pv < this->numberPVNames; pv++) {
+            const Rad_Aligner::Column& column = table.columns [pv];
+            values [pv] = column.value [j];
+            severity [pv] = column.severity [j];
+            status [pv] = column.status [j];
+         }
+         writer.appendRow (table.time [j],
+                           values.constData (), severity.constData (), status.constData ());
+      }
    }
 
-   if (number > 0) {
-      firstTime = working.value (0).datetime;
-      lastTime =  working.value (number - 1).datetime;
+   const bool closed = writer.close ();
+   this->statistics.stop (Rad_Statistics::Write);
 
-      line.append (" (");
-      line.append (firstTime.toString (stdFormat));
-      line.append (" to ");
-      line.append (lastTime.toString (stdFormat));
-      line.append (" ");
-      line.append (QEUtilities::getTimeZoneTLA (lastTime));
-      line.append (")");
+   if (!closed) {
+      this->state = errorExit;
+      return;
    }
 
-   line.append ("\n");
-   std::cout << line.toLatin1 ().data ();
+   this->statistics.increment (Rad_Statistics::PointsWritten, writer.numberRows ());
+   std::cout << "Written " << writer.numberRows () << " rows" << std::endl;
+}
 
-   // Now start processing the data in earnets.
-   //
-   pvData->responseCount++;
-   if (okay && number > 0) {
-      pvData->isOkayStatus = true;
+//------------------------------------------------------------------------------
+// Array PV: binary - one row per sample, one value per element - or text.
+//
+void Rad_Control::putWaveformData ()
+{
+   const Rad_Waveform& waveform = this->waveform;
+   const int numberElements = waveform.numberElements ();
+   const int numberRows = waveform.numberRows ();
+   const QVector<qint64>& times = waveform.time ();
 
-      if (pvData->responseCount == 1) {
-         // First update - just copy
-         //
-         pvData->archiveData = working;
-      } else {
-         // Subsequent update.
-         //
-         number = pvData->archiveData.count ();
-         lastTime = pvData->archiveData.value (number - 1).datetime;
+   if (this->outputFormat == binaryFormat) {
+      Rad_BinaryWriter writer (this->outputFile, this->pvNameList ());
 
-         // Remove any overlap times.
-         //
-         while ((working.count () > 0) && (working.value (0).datetime <= lastTime)) {
-            working.removeFirst ();
-         }
-         pvData->archiveData.append (working);
+      if (!writer.open ()) {
+         this->state = errorExit;
+         return;
       }
 
-      number = pvData->archiveData.count ();
-      lastTime = pvData->archiveData.value (number - 1).datetime;
+      this->statistics.start (Rad_Statistics::Write);
 
-      if ((this->how == QEArchiveInterface::Raw) &&
-          (lastTime < this->endTime) &&
-          (lastTime > this->nextTime))
-      {
-         std::cout << "requesting more data ... " << std::endl;
-         this->nextTime = lastTime;
-      } else {
+      // The alarm applies to the whole sample, i.e. to every element.
+      //
+      QVector<quint16> severity (numberElements);
+      QVector<quint16> status (numberElements);
+
+      for (int j = 0; j < numberRows; j++) {
+         severity.fill (waveform.severity (j));
+         status.fill (waveform.status (j));
+         writer.appendRow (times [j], waveform.row (j),
+                           severity.constData (), status.constData ());
+      }
 
-         // All done with this PV - for good or bad.
-         //
-         this->postProcess (pvData);
+      const bool closed = writer.close ();
+      this->statistics.stop (Rad_Statistics::Write);
 
-         // Move onto next PV (if defined).
-         //
-         this->pvIndex++;
-         this->nextTime = this->startTime;
+      if (!closed) {
+         this->state = errorExit;
+         return;
       }
 
    } else {
-      // All done with this PV - for good or bad.
-      //
-      this->postProcess (pvData);
+      QScopedPointer<QIODevice> target_file (this->createOutput ());
+
+      if (!target_file->open (QIODevice::WriteOnly | QIODevice::Text)) {
+         std::cerr << "open file failed" << std::endl;
+         this->state = errorExit;
+         return;
+      }
 
-      // Move onto next PV (if defined).
+      QTextStream target (target_file.data ());
+
+      target << QString ("# %1 elements %2 to %3")
+                .arg (this->pvDataList [0].archiveName)
+                .arg (this->firstElement)
+                .arg (this->firstElement + numberElements - 1);
+      if (this->numberFailed () > 0) {
+         target << " (incomplete - archiver request failed)";
+      }
+      target << "\n\n";
+      target << "#   No   Time                        Rel. Time    Values...\n";
+      target.flush ();
+
+      // A row may be wide - write out whenever a block's worth is formatted.
       //
-      this->pvIndex++;
-      this->nextTime = this->startTime;
-   }
+      const int blockSize = 1 << 20;
+      Rad_TextFormatter formatter (this->timeZoneSpec);
+      formatter.setOrigin (Rad_BinaryWriter::toEpochNanoSeconds (this->startTime));
+
+      bool okay = true;
+      for (int j = 0; okay && (j < numberRows); j++) {
+         const double* value = waveform.row (j);
+         const bool isDisplayable = waveform.isDisplayable (j);
+
+         this->statistics.start (Rad_Statistics::Format);
+         formatter.beginRow (j, times [j]);
+         for (int e = 0; e < numberElements; e++) {
+            if (isDisplayable && !qIsNaN (value [e])) {
+               formatter.appendValue (value [e]);
+            } else {
+               formatter.appendNil ();
+            }
+         }
+         formatter.endRow ();
+         this->statistics.stop (Rad_Statistics::Format);
+
+         if ((formatter.buffer ().size () >= blockSize) || (j == numberRows - 1)) {
+            const QByteArray& buffer = formatter.buffer ();
+            this->statistics.start (Rad_Statistics::Write);
+            okay = (target_file->write (buffer) == buffer.size ());
+            this->statistics.stop (Rad_Statistics::Write);
+            formatter.clear ();
+         }
+      }
 
-   if (pvIndex < this->numberPVNames) {
-      this->state = sendRequest;  // do next request
-   } else {
-      this->state =  printAll;
+      target << "\n";
+      target << "# end\n";
+      target.flush ();
+      okay = this->closeOutput (target_file.data ()) && okay;
+
+      if (!okay) {
+         std::cerr << colour::red
+                   << "write file " << this->outputFile.toLatin1 ().data () << " failed"
+                   << colour::reset << std::endl;
+         this->state = errorExit;
+         return;
+      }
    }
+
+   this->statistics.increment (Rad_Statistics::PointsWritten, (qint64) numberRows * numberElements);
+   std::cout << "Written " << numberRows << " samples of " << numberElements
+             << " elements" << std::endl;
 }
 
 //------------------------------------------------------------------------------
+// static
+// Output columns hold severity and status as uint16, as per the binary format.
 //
-void Rad_Control::postProcess (struct PVData* pvData)
+void Rad_Control::appendAlarms (Rad_Aligner::Column& column, const Rad_PointStore& points)
 {
-   int number;
+   const int number = points.count ();
+   const int offset = column.severity.count ();
 
-   if (!pvData) {
-      std::cerr << colour::red
-                << "Null pvData pointer"
-                << colour::reset << std::endl;
-      exit (1);
-      return;
-   }
+   column.severity.resize (offset + number);
+   column.status.resize (offset + number);
 
-   if (this->useFixedTime) {
+   quint16* severity = column.severity.data () + offset;
+   quint16* status = column.status.data () + offset;
+   for (int j = 0; j < number; j++) {
+      severity [j] = points.severity [j];
+      status [j] = points.status [j];
+   }
+}
 
-      QCaDataPointList working;
-      QCaDataPoint nullPoint;
+//------------------------------------------------------------------------------
+// Wide form: time, relative, then value/severity/status columns for each PV.
+// Long form: pv, time, relative, value, severity, status - each PV's own times.
+// Relative times are with respect to the start time (or when following, the
+// start time of the existing file).
+//
+void Rad_Control::buildExportTable (Rad_ExportTable& table)
+{
+   const qint64 origin = Rad_BinaryWriter::toEpochNanoSeconds (this->originTime);
+   const int selected = this->exportColumns;
+   Rad_Aligner::Table aligned;
 
-      number = pvData->archiveData.count ();
-      std::cout << "resampling ... " << number << " points";
+   if (this->useLongLayout) {
+      // Long form - each PV's own data set, i.e. no alignment required.
+      // Held as a single column table, with a PV index per row.
+      //
+      Rad_Aligner::Column all;
+      QVector<qint32> pvIndex;
+
+      for (int pv = 0 ; pv < this->numberPVNames; pv++) {
+         const struct PVData* pvData = &this->pvDataList [pv];
+         if (!pvData->isOkayStatus) continue;
+
+         const Rad_PointStore& series = pvData->archiveData;
+         aligned.time << series.time;
+         all.value << series.value;
+         Rad_Control::appendAlarms (all, series);
+         all.isDisplayable << series.isDisplayable;
+         pvIndex << QVector<qint32> (series.count (), (qint32) pv);
+      }
+      aligned.numberRows = aligned.time.count ();
+      aligned.columns.append (all);
 
-      if (this->numberPVNames == 1) {
-         // Just do a simple resample.
-         //
-         // Create a distinct and separate copy to resample from.
-         //
-         working = pvData->archiveData;
-         pvData->archiveData.resample (working, this->fixedTime, this->endTime);
-      } else {
-         // All sets must start at the same time.
-         //
-         nullPoint.alarm = QCaAlarmInfo (0, (int) QEArchiveInterface::archSevInvalid);
-         nullPoint.datetime = this->startTime;
-         nullPoint.value = 0.0;
+      Rad_ExportTable::Column& pvColumn = table.addColumn ("pv", Rad_ExportTable::categoryType);
+      pvColumn.categories = pvIndex;
+      pvColumn.dictionary = this->pvNameList ();
 
-         working.clear ();
-         working.append (nullPoint);
-         working.append (pvData->archiveData);
-         pvData->archiveData.resample (working, this->fixedTime, this->endTime);
+   } else if (this->numberPVNames == 1) {
+      // Wide form, single PV - the data set as is.
+      //
+      Rad_PointStore series;
+      if (this->pvDataList [0].isOkayStatus) {
+         series = this->pvDataList [0].archiveData;
       }
 
-      number = pvData->archiveData.count ();
-      std::cout << " resampled to " << number << " points." << std::endl;
+      Rad_Aligner::Column column;
+      column.value = series.value;
+      Rad_Control::appendAlarms (column, series);
+      column.isDisplayable = series.isDisplayable;
+      aligned.numberRows = series.count ();
+      aligned.time = series.time;
+      aligned.columns.append (column);
 
    } else {
-      // Remove points beyond endTime
+      // Wide form, multiple PVs - the aligned table.
       //
-      QCaDateTime penUltimate;
+      this->statistics.start (Rad_Statistics::Resample);
+      this->buildOutputTable (aligned);
+      this->statistics.stop (Rad_Statistics::Resample);
+   }
+
+   Rad_Statistics::Timer timer (&this->statistics, Rad_Statistics::Format);
+   const QVector<qint64>& times = aligned.time;
+   const int number = aligned.numberRows;
+
+   if (selected & timeColumn) {
+      table.addColumn ("time", Rad_ExportTable::timeType).times = times;
+   }
+
+   if (selected & relativeColumn) {
+      Rad_ExportTable::Column& column = table.addColumn ("relative", Rad_ExportTable::doubleType);
+      column.doubles.resize (number);
+      column.isValid.fill (true, number);
+      for (int j = 0; j < number; j++) {
+         column.doubles [j] = (double) (times [j] - origin) * 1.0e-9;
+      }
+   }
 
-      while (true) {
-         if (pvData->archiveData.count () <= 2) break;
-         number = pvData->archiveData.count ();
-         penUltimate = pvData->archiveData.value (number - 2).datetime;
-         if (penUltimate < this->endTime) break;
-         pvData->archiveData.removeLast ();
+   for (int c = 0 ; c < aligned.columns.count (); c++) {
+      const Rad_Aligner::Column& source = aligned.columns [c];
+      const QString prefix = this->useLongLayout ? QString ("") : this->pvDataList [c].pvName + ".";
+
+      if (selected & valueColumn) {
+         Rad_ExportTable::Column& column = table.addColumn (prefix + "value", Rad_ExportTable::doubleType);
+         column.doubles = source.value;
+         column.isValid = source.isDisplayable;
+      }
+      if (selected & severityColumn) {
+         table.addColumn (prefix + "severity", Rad_ExportTable::shortType).shorts = source.severity;
+      }
+      if (selected & statusColumn) {
+         table.addColumn (prefix + "status", Rad_ExportTable::shortType).shorts = source.status;
       }
    }
 }
 
 //------------------------------------------------------------------------------
+// CSV, TSV and columnar output - see rad_export.h
 //
-void Rad_Control::putDatumSet (QTextStream& target, QCaDataPoint p [],
-                               const int j, const QCaDateTime& firstTime)
+void Rad_Control::putExportData ()
 {
-   double relative;
-   QCaDateTime time;
-   QString zone;
-   QString line;
-   int n;
-   bool valid;
+   Rad_ExportTable table;
+   this->buildExportTable (table);
 
-   // Calculate the relative time from start.
-   //
-   relative = firstTime.secondsTo(p [0].datetime);
+   bool okay;
+   this->statistics.start (Rad_Statistics::Write);
+   if (this->outputFormat == columnarFormat) {
+      okay = table.writeColumnar (this->outputFile);
+   } else {
+      const char separator = (this->outputFormat == tsvFormat) ? '\t' : ',';
+      QScopedPointer<QIODevice> target (this->createOutput ());
+      okay = target->open (this->isAppending ? (QIODevice::WriteOnly | QIODevice::Append)
+                                             : QIODevice::WriteOnly);
+      if (!okay) {
+         std::cerr << "open file failed" << std::endl;
+      } else {
+         okay = table.writeDelimited (*target, separator, this->timeZoneSpec,
+                                      !this->isAppending);
+         if (!this->closeOutput (target.data ()) && okay) {
+            std::cerr << colour::red
+                      << "write file " << this->outputFile.toLatin1 ().data () << " failed"
+                      << colour::reset << std::endl;
+            okay = false;
+         }
+      }
+   }
+   this->statistics.stop (Rad_Statistics::Write);
 
-   // Copy and covert to required time zone.
-   //
-   time = p [0].datetime;
+   if (!okay) {
+      this->state = errorExit;
+      return;
+   }
 
-   // Now set to the required time zone.
-   //
-   time = time.toTimeSpec (this->timeZoneSpec);
+   this->statistics.increment (Rad_Statistics::PointsWritten, table.numberRows ());
+   std::cout << (this->isAppending ? "Appended " : "Written ")
+             << table.numberRows () << " rows, "
+             << table.numberColumns () << " columns" << std::endl;
+}
 
-   zone = QEUtilities::getTimeZoneTLA (time);
+//------------------------------------------------------------------------------
+// Per PV details are recorded regardless, e.g. for the benchmark report.
+//
+void Rad_Control::putStatistics ()
+{
+   this->statistics.clearPVs ();
+   for (int pv = 0 ; pv < this->numberPVNames; pv++) {
+      const struct PVData* pvData = &this->pvDataList [pv];
+      this->statistics.addPV (pvData->pvName, pvData->pages, pvData->points);
+   }
 
-   line = QString ("%1   %2 %3 %4 ")
-         .arg (j, 6)
-         .arg (time.toString (stdFormat), 20)
-         .arg (zone)
-         .arg (relative, 12, 'f', 3);
+   if (this->isStatsReport) {
+      std::cout << "\nStatistics\n"
+                << this->statistics.report ().toLatin1 ().data ();
+   }
 
-   for (n = 0; n < this->numberPVNames; n++) {
-      valid = p [n].isDisplayable ();
-      // f, 8   => 1.12345678e+00 = 8 + 6 => 14, so allow a couple spare.
-      if (valid) {
-         line.append (QString (" %1").arg (p [n].value, 16, 'e', 8));
-      } else {
-         line.append (QString (" %1").arg ("nil", 16));
+   if (!this->statsJsonFile.isEmpty ()) {
+      QFile file (this->statsJsonFile);
+      const QByteArray json = this->statistics.toJson ();
+      if (!file.open (QIODevice::WriteOnly | QIODevice::Text) ||
+          (file.write (json) != json.size ()))
+      {
+         std::cerr << colour::yellow
+                   << "warning: write statistics file "
+                   << this->statsJsonFile.toLatin1 ().data () << " failed"
+                   << colour::reset << std::endl;
       }
    }
-
-   target << line << "\n";
 }
 
 //------------------------------------------------------------------------------
 //
 void Rad_Control::putArchiveData ()
 {
-   QFile target_file (this->outputFile);
+   QScopedPointer<QIODevice> target_file (this->createOutput ());
 
    int pv;
    int number;
    QCaDateTime firstTime;
    int j;
-   QCaDataPoint point;
 
    std::cout << "\nOutputing data to file: " << this->outputFile.toLatin1 ().data () << std::endl;
 
-   if (!target_file.open (QIODevice::WriteOnly | QIODevice::Text)) {
+   if (this->isWaveform) {
+      this->putWaveformData ();
+      return;
+   }
+
+   if (this->outputFormat == binaryFormat) {
+      this->putBinaryArchiveData ();
+      return;
+   }
+
+   if (this->outputFormat != textFormat) {
+      this->putExportData ();
+      return;
+   }
+
+   if (!target_file->open (QIODevice::WriteOnly | QIODevice::Text)) {
       std::cerr << "open file failed" << std::endl;
       this->state = errorExit;
       return;
    }
 
-   QTextStream target (&target_file);
+   QTextStream target (target_file.data ());
 
    if (this->numberPVNames == 1) {
 
-      QCaDataPointList* archiveData = &this->pvDataList [0].archiveData;
-
-      number = archiveData->count ();
-      if (number > 0 ) {
+      const Rad_PointStore& archiveData = this->pvDataList [0].archiveData;
 
-         firstTime = archiveData->value (0).datetime;
+      if (this->pvDataList [0].isFailed) {
+         target << "# " << this->pvDataList [0].pvName << " (incomplete - archiver request failed)\n";
+      }
 
+      number = archiveData.count ();
+      if (number > 0 ) {
          target << "\n";
          target << "#   No  Time                          Relative Time             Value      Valid     Severity    Status\n";
 
-         archiveData->toStream (target, true, true);
+         // Rows are formatted straight from the store in chunks, and the
+         // chunks written directly to the file, so flush the headers.
+         // Relative times are with respect to the first point.
+         //
+         target.flush ();
+
+         Rad_TextFormatter formatter (this->timeZoneSpec);
+         formatter.setOrigin (archiveData.time [0]);
+
+         for (j = 0; j < number; j += Rad_TableTextWriter::chunkRows) {
+            const int last = MIN (j + Rad_TableTextWriter::chunkRows, number);
+
+            this->statistics.start (Rad_Statistics::Format);
+            formatter.clear ();
+            formatter.appendPoints (archiveData, j, last, j + 1);
+            this->statistics.stop (Rad_Statistics::Format);
+
+            this->statistics.start (Rad_Statistics::Write);
+            const QByteArray& buffer = formatter.buffer ();
+            const bool written = (target_file->write (buffer) == buffer.size ());
+            this->statistics.stop (Rad_Statistics::Write);
+
+            if (!written) {
+               std::cerr << colour::red
+                         << "write file " << this->outputFile.toLatin1 ().data () << " failed"
+                         << colour::reset << std::endl;
+               target_file->close ();
+               this->state = errorExit;
+               return;
+            }
+         }
+         this->statistics.increment (Rad_Statistics::PointsWritten, number);
       }
 
    } else {
       // multiple PV outputFile
       //
-      QCaDataPoint p_set [MaximumPVNames];
-      QCaDataPoint nullPoint;
-
-      nullPoint.alarm = QCaAlarmInfo (0, (int) QEArchiveInterface::archSevInvalid);
+      Rad_Aligner::Table table;
 
       firstTime = this->startTime;
-
-      // Because of the way we re-sample the data - the number of points in
-      // each data set should be the same, but just in case ....
-      //
-      number = 0;
-      for (pv = 0 ; pv < this->numberPVNames; pv++) {
-         QCaDataPointList* archiveData = &this->pvDataList [pv].archiveData;
-         if (this->pvDataList [pv].isOkayStatus) {
-            number = MAX (number, archiveData->count ());
-         }
-      }
+      this->statistics.start (Rad_Statistics::Resample);
+      this->buildOutputTable (table);
+      this->statistics.stop (Rad_Statistics::Resample);
+      number = table.numberRows;
 
       for (pv = 0 ; pv < this->numberPVNames; pv++) {
          // Note: for output we number PVs 1 to N as opposed to 0 to N-1.
          // The output is for human consumption as opposed to C/C++ compiler consumption.
          //
-         target << QString ("# %1 %2").arg (pv + 1, 3).arg (this->pvDataList [pv].pvName) << "\n";
+         target << QString ("# %1 %2").arg (pv + 1, 3).arg (this->pvDataList [pv].pvName);
+         if (this->pvDataList [pv].isFailed) {
+            target << " (incomplete - archiver request failed)";
+         }
+         target << "\n";
       }
       target << "\n";
       target << "#   No   Time                        Rel. Time    Values...\n";
 
-      for (j = 0; j < number; j++) {
-         for (pv = 0 ; pv < this->numberPVNames; pv++) {
-            QCaDataPointList* archiveData = &this->pvDataList [pv].archiveData;
+      // Rows are formatted in chunks in parallel, and the chunks written
+      // directly to the file in order, so flush the headers.
+      //
+      const Rad_TableTextWriter writer (this->timeZoneSpec,
+                                        Rad_BinaryWriter::toEpochNanoSeconds (firstTime));
+      target.flush ();
 
-            if (this->pvDataList [pv].isOkayStatus) {
-               if (j < archiveData->count ()) {
-                  p_set [pv] = archiveData->value (j);
-               } else {
-                  p_set [pv] = nullPoint;
-               }
-            } else {
-               p_set [pv] = nullPoint;
-            }
-         }
-         this->putDatumSet (target, p_set, j, firstTime);
+      if (!writer.write (target_file.data (), table, &this->statistics)) {
+         std::cerr << colour::red
+                   << "write file " << this->outputFile.toLatin1 ().data () << " failed"
+                   << colour::reset << std::endl;
+         target_file->close ();
+         this->state = errorExit;
+         return;
       }
+      this->statistics.increment (Rad_Statistics::PointsWritten, number);
    }
 
    target << "\n";
    target << "# end\n";
 
-   target_file.close ();
+   this->statistics.start (Rad_Statistics::Write);
+   target.flush ();
+   const bool closed = this->closeOutput (target_file.data ());   // compressed output: waits for the compressor
+   this->statistics.stop (Rad_Statistics::Write);
+
+   if (!closed) {
+      std::cerr << colour::red
+                << "write file " << this->outputFile.toLatin1 ().data () << " failed"
+                << colour::reset << std::endl;
+      this->state = errorExit;
+   }
+}
+
+
+//------------------------------------------------------------------------------
+//
+QIODevice* Rad_Control::createOutput () const
+{
+   if (this->useCompression) {
+      return new Rad_GzipFile (this->outputFile);
+   }
+   return new QFile (this->outputFile);
+}
+
+//------------------------------------------------------------------------------
+//
+bool Rad_Control::closeOutput (QIODevice* device) const
+{
+   device->close ();
+
+   const Rad_GzipFile* gzipFile = dynamic_cast<const Rad_GzipFile*> (device);
+   if (gzipFile) return gzipFile->isOkay ();
+
+   const QFileDevice* file = dynamic_cast<const QFileDevice*> (device);
+   return !file || (file->error () == QFileDevice::NoError);
+}
+
+//------------------------------------------------------------------------------
+//
+bool Rad_Control::openStream ()
+{
+   std::cout << "\nStreaming data to file: " << this->outputFile.toLatin1 ().data () << std::endl;
+
+   // Follow mode polls re-open the stream.
+   //
+   delete this->streamWriter;
+   delete this->streamTarget;
+   delete this->streamFile;
+   delete this->streamFormatter;
+   this->streamWriter = NULL;
+   this->streamTarget = NULL;
+   this->streamFile = NULL;
+   this->streamFormatter = NULL;
+   this->isStreamFailed = false;
+
+   if (this->outputFormat == binaryFormat) {
+      this->streamWriter = new Rad_BinaryWriter (this->outputFile, this->pvNameList ());
+      return this->streamWriter->open ();
+   }
+
+   this->streamFile = this->createOutput ();
+
+   QIODevice::OpenMode mode = QIODevice::WriteOnly | QIODevice::Text;
+   if (this->isAppending && (this->followOffset >= 0)) {
+      // Remove the trailer - the new rows and a new trailer replace it.
+      //
+      if (!QFile::resize (this->outputFile, this->followOffset)) {
+         std::cerr << "truncate file failed" << std::endl;
+         return false;
+      }
+      mode |= QIODevice::Append;
+   }
+
+   if (!this->streamFile->open (mode)) {
+      std::cerr << "open file failed" << std::endl;
+      return false;
+   }
+
+   this->streamTarget = new QTextStream (this->streamFile);
+
+   // When following, relative times continue from the existing file's origin.
+   //
+   this->streamFormatter = new Rad_TextFormatter (this->timeZoneSpec);
+   if (this->pvDataList [0].streamCount > 0) {
+      this->streamFormatter->setOrigin (Rad_BinaryWriter::toEpochNanoSeconds (this->pvDataList [0].streamOrigin));
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+// Writes one de-overlapped page in the same format as the single PV
+// output of putArchiveData, i.e. as per Rad_TextFormatter::appendPointRow.
+//
+void Rad_Control::streamArchiveData (struct PVData* pvData,
+                                     const QCaDataPointList& page)
+{
+   if (!this->streamTarget && !this->streamWriter) return;
+
+   Rad_Statistics::Timer timer (&this->statistics, Rad_Statistics::Write);
+   const int number = page.count ();
+
+   for (int j = 0; j < number; j++) {
+      QCaDataPoint point = page.value (j);
+
+      // Remove any overlap between segments.
+      //
+      if ((pvData->streamCount > 0) && (point.datetime <= pvData->streamPrevious)) continue;
+
+      // As per postProcess - only retain the first point at/beyond endTime
+      // (though always keep at least two points).
+      //
+      if ((pvData->streamCount >= 2) && (pvData->streamPrevious >= this->endTime)) break;
+
+      if (this->streamWriter) {
+         pvData->streamCount++;
+         pvData->streamPrevious = point.datetime;
+         this->streamWriter->appendRow (point.datetime, &point);
+         continue;
+      }
+
+      const qint64 time = Rad_BinaryWriter::toEpochNanoSeconds (point.datetime);
+
+      if (pvData->streamCount == 0) {
+         pvData->streamOrigin = point.datetime;
+         this->streamFormatter->setOrigin (time);
+         *this->streamTarget << "\n";
+         *this->streamTarget << "#   No  Time                          Relative Time             Value      Valid     Severity    Status\n";
+      }
+
+      pvData->streamCount++;
+      pvData->streamPrevious = point.datetime;
+
+      this->streamFormatter->appendPointRow (pvData->streamCount, time, point.value,
+                                             (quint16) point.alarm.getSeverity (),
+                                             (quint16) point.alarm.getStatus ());
+   }
+
+   // Any header is written via the text stream, the rows directly.
+   //
+   if (this->streamTarget) {
+      this->streamTarget->flush ();
+      const QByteArray& buffer = this->streamFormatter->buffer ();
+      if (!this->isStreamFailed && (this->streamFile->write (buffer) != buffer.size ())) {
+         std::cerr << colour::red
+                   << "write file " << this->outputFile.toLatin1 ().data () << " failed"
+                   << colour::reset << std::endl;
+         this->isStreamFailed = true;
+      }
+      this->streamFormatter->clear ();
+   }
+}
+
+//------------------------------------------------------------------------------
+// Segments complete in any order, but must be streamed in time order. Once
+// the head segment is complete, write out any data buffered by subsequent
+// segments; the new head segment then streams its pages directly.
+//
+void Rad_Control::advanceStream (struct PVData* pvData)
+{
+   const int number = pvData->segments.count ();
+
+   while (pvData->streamHead < number) {
+      struct Segment* head = &this->segmentList [pvData->segments.value (pvData->streamHead)];
+      if (!head->isComplete) break;
+
+      pvData->streamHead++;
+      if (pvData->streamHead >= number) break;
+
+      struct Segment* next = &this->segmentList [pvData->segments.value (pvData->streamHead)];
+      this->streamArchiveData (pvData, next->archiveData.toList ());
+      next->archiveData.clear ();
+   }
 }
 
+//------------------------------------------------------------------------------
+//
+void Rad_Control::closeStream ()
+{
+   if (this->streamWriter) {
+      if (!this->streamWriter->close ()) {
+         this->state = errorExit;
+         return;
+      }
+   }
+
+   if (this->streamTarget) {
+      // The header has long since been written.
+      //
+      *this->streamTarget << "\n";
+      if (this->pvDataList [0].isFailed) {
+         *this->streamTarget << "# " << this->pvDataList [0].pvName
+                             << " (incomplete - archiver request failed)\n";
+      }
+      *this->streamTarget << "# end\n";
+      this->streamTarget->flush ();
+
+      if (!this->closeOutput (this->streamFile) && !this->isStreamFailed) {
+         std::cerr << colour::red
+                   << "write file " << this->outputFile.toLatin1 ().data () << " failed"
+                   << colour::reset << std::endl;
+         this->isStreamFailed = true;
+      }
+
+      if (this->isStreamFailed) {
+         this->state = errorExit;
+         return;
+      }
+   }
+
+   const int number = this->pvDataList [0].streamCount - this->pvDataList [0].streamFirst;
+   this->statistics.increment (Rad_Statistics::PointsWritten, number);
+   std::cout << "Streamed " << number << " points" << std::endl;
+}
 
 //------------------------------------------------------------------------------
 //
@@ -28,8 +28,16 @@
 #define RAD_CONTROL_H
 
 #include <QObject>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QSet>
 #include <QString>
+#include <QStringList>
+#include <QTextStream>
 #include <QTimer>
+#include <QVector>
 
 #include <QCaDateTime.h>
 #include <QCaDataPoint.h>
@@ -37,68 +45,265 @@
 #include <QEArchiveManager.h>
 #include <QEOptions.h>
 
-class Rad_Control : QObject {
+#include "rad_aligner.h"
+#include "rad_point_store.h"
+#include "rad_reducer.h"
+#include "rad_statistics.h"
+#include "rad_text_formatter.h"
+#include "rad_waveform.h"
+
+class Rad_ArchiveSource;
+class Rad_BinaryWriter;
+class Rad_Cache;
+class Rad_ExportTable;
+
+class Rad_Control : public QObject {
 Q_OBJECT
 public:
-   Rad_Control ();
+   // When source is NULL, the QE framework archive access is used. A supplied
+   // source, e.g. a mock archiver, is not owned by Rad_Control.
+   //
+   // When arguments are supplied (program name first), these are used in
+   // lieu of the command line, and on completion only the finished signal
+   // is emitted, i.e. the application event loop is left running. This is
+   // used for batch jobs - see rad_jobs.h - where the source is shared.
+   //
+   explicit Rad_Control (Rad_ArchiveSource* source = NULL,
+                         const QStringList& arguments = QStringList ());
    ~Rad_Control ();
 
+   const Rad_Statistics* getStatistics () const;
+
+   // Reads PV names, one per line, '#' comments allowed. '-' is standard input.
+   //
+   static bool readPVFile (const QString& filename, QStringList& pvNames);
+
+signals:
+   // Emitted once on completion, with the exit status, just prior to
+   // requesting the application event loop to exit.
+   //
+   void finished (const int status);
+
 private:
-   static const int MaximumPVNames = 20;
+   struct TimeRange {
+      QCaDateTime start;
+      QCaDateTime end;
+   };
+
+   // A time range of one PV that is fetched, and paged, independently of any
+   // other range. Without sharding or the cache there is one segment per PV.
+   //
+   struct Segment {
+      int pvIndex;              // index into pvDataList
+      QObject* requestTag;      // passed as readArchive userData, identifies the segment
+      QCaDateTime startTime;    // start of this segment's time range
+      QCaDateTime nextTime;     // continuation time for Raw paging
+      QCaDateTime endTime;      // end of this segment's time range
+      QCaDateTime firstTime;    // time of first point received
+      QCaDateTime lastTime;     // time of last point received (after de-overlap)
+      int pointsReceived;       // used to estimate point density
+      bool isInFlight;          // request issued, awaiting response
+      bool isServerReduced;     // requested via an archiver statistics operator
+      bool isComplete;
+      QElapsedTimer requestTimer;   // round trip time of the current request
+      int retries;              // consecutive failed/timed out requests
+      Rad_PointStore archiveData;
+   };
 
    struct PVData {
       QString pvName;
+      QString archiveName;      // as known to the archiver, e.g. sans element suffix
+      int element;              // array element requested
+      int index;                // index into pvDataList
       bool isOkayStatus;
-      int responseCount;
-      QCaDataPointList archiveData;
+      bool isFetchFailed;       // at least one archiver request failed
+      bool isFailed;            // a request failed even after retries, i.e. incomplete
+      QList<int> segments;      // indices into segmentList, in time order
+      int numberSegmentsComplete;
+      int streamHead;           // position in segments of the segment being streamed
+      QList<qint64> missingChunks;      // closed chunks to be added to the cache
+      Rad_PointStore cachedData;        // data read from the cache
+      int streamCount;          // number of points streamed to file so far
+      QCaDateTime streamOrigin; // first streamed point - relative time reference
+      QCaDateTime streamPrevious;
+      int streamFirst;          // number of rows already in the file when following
+      QCaDateTime followTime;   // following: time up to which data already output
+      int pages;                // number of archiver responses
+      qint64 points;            // number of points retained, i.e. after de-overlap
+      Rad_Reducer* reducer;     // client side reduction, NULL when not reducing
+      Rad_PointStore archiveData;
    };
 
    // The rad program is managaed as a simple state machine.
    //
    enum States { setup,
-                 initialWait,
                  waitArchiverReady,
+                 setupPVs,
                  initialiseRequest,
                  sendRequest,
                  waitResponse,
                  printAll,
+                 waitPoll,
                  allDone,
-                 errorExit };
+                 errorExit,
+                 terminated };
 
-   PVData pvDataList [MaximumPVNames];
+   QStringList pvNameInput;          // as specified, may include wild cards
+   QVector<PVData> pvDataList;       // sized as per number of PV names
    int numberPVNames;
+   QVector<Segment> segmentList;     // all segments of all PVs
+   QHash<const QObject*, int> requestTagMap;   // request tag to segment index
+
+   // Concurrent request management.
+   //
+   QList<int> pendingList;      // indices of segments awaiting a (further) request
+   int maxInFlight;             // maximum number of concurrent requests
+   int numberShards;            // number of segments per PV time range
+   int maxPoints;               // maximum number of points per request
+   int numberInFlight;
+   int numberComplete;
+
+   // Failed request management.
+   //
+   double requestTimeout;       // seconds
+   int maxRetries;
+   double retryDelay;           // seconds, doubled for each subsequent retry
+   bool isPartial;              // output what we have when a PV fails
+   QSet<const QObject*> staleTags;           // tags of timed out requests
+   QSet<const QObject*> previousStaleTags;   // as above, of the previous cycle
+   QElapsedTimer reminderTimer;
 
    Qt::TimeSpec timeZoneSpec;
    QEArchiveInterface::How how;
    bool useFixedTime;
    double fixedTime;
+   Rad_Aligner::Grids alignGrid;     // multiple PV alignment
+   Rad_Aligner::Fills alignFill;
+
+   bool isReducing;             // statistics/decimation mode selected
+   Rad_Reducer::Modes reduceMode;
+   int binWidth;                // seconds
+   bool useServerReduction;     // use the archiver's operators where available
+
+   enum OutputFormats { textFormat,      // fixed width text table
+                        binaryFormat,    // columnar, see rad_binary_writer.h
+                        csvFormat,       // comma separated, see rad_export.h
+                        tsvFormat,       // tab separated
+                        columnarFormat };  // compressed columnar, see rad_export.cpp
+
+   // Export (csv, tsv, columnar) column selection flags.
+   //
+   enum ExportColumns { timeColumn     = 0x01,
+                        relativeColumn = 0x02,
+                        valueColumn    = 0x04,
+                        severityColumn = 0x08,
+                        statusColumn   = 0x10 };
 
    QString outputFile;
+   OutputFormats outputFormat;
+   int exportColumns;           // ExportColumns flags
+   bool useLongLayout;          // export one row per PV per time
+   bool useStreaming;           // write each page as it arrives
+   bool isFollowing;            // append newer data to the existing output file
+   bool isAppending;            // following, and the output file has data
+   qint64 followOffset;         // text only: file offset at which to append
+   double pollPeriod;           // seconds, 0.0 for a single follow
+   bool isEndNow;               // end time specified as "now"
+   bool useCompression;         // gzip compressed text, csv or tsv output
+   bool isWaveform;             // array PV - one PVData per element requested
+   int firstElement;
+   int numberElements;
+   Rad_Waveform waveform;
+   QIODevice* streamFile;
+   QTextStream* streamTarget;
+   Rad_TextFormatter* streamFormatter;   // single PV text rows
+   bool isStreamFailed;                  // a streamed write failed
+   Rad_BinaryWriter* streamWriter;
+   Rad_Cache* cache;                 // NULL when cache not in use
    QCaDateTime startTime;
-   QCaDateTime nextTime;
    QCaDateTime endTime;
+   QCaDateTime originTime;      // relative time reference for export
 
    States state;
-   int pvIndex;
-   int timeout;
+   bool isProcessing;
+   double timeoutRemaining;     // seconds
 
    QEOptions *options;
-   QTimer* tickTimer;
-   QEArchiveAccess * archiveAccess;
+   QTimer* timeoutTimer;
+   QTimer* readyTimer;
+   QTimer* pollTimer;
+   QTimer* watchdogTimer;       // checks for request timeouts
+   Rad_ArchiveSource* archiveSource;
+   bool isOwnSource;
+   bool isEmbedded;             // a batch job, i.e. constructed with arguments
+   Rad_Statistics statistics;
+   bool isStatsReport;          // report statistics on completion
+   QString statsJsonFile;       // write statistics as JSON, if specified
 
    void usage (const QString & message);
    void help ();
 
    void initialise ();
-   void readArchive ();
+
+   static bool isPattern (const QString& pvName);
+   QStringList expandPVNames (const QStringList& input) const;
+   bool setUpPVData (const QStringList& pvNames);
+   bool readFollowFile ();
+   int setUpSegments ();
+   void addSegment (struct PVData* pvData, const QCaDateTime& start, const QCaDateTime& end);
+   void sendRequests ();
+   int requestPointCount (const struct Segment* segment) const;
+   void readArchive (struct Segment* segment);
+   void ingestData (struct Segment* segment, const QCaDataPointList& archiveDataIn);
+   bool scheduleRetry (struct Segment* segment);
+   void retryRequest (const int index, const QObject* requestTag);
+   void concludeResponse (struct Segment* segment, const bool moreData);
+   int numberFailed () const;
    void postProcess (struct PVData* pvData);
+   void reduce (struct PVData* pvData);
+
+   // Index of first point after time (binary search), else number of points.
+   //
+   static int firstAfter (const QCaDataPointList& points, const QCaDateTime& time);
+
+   void stitchSegments (struct PVData* pvData);
+   void completePV (struct PVData* pvData);
+   QList<TimeRange> planCachedFetch (struct PVData* pvData);
+   void mergeCachedData (struct PVData* pvData);
+
+   // Find the segment associated with a response, or NULL.
+   //
+   struct Segment* findSegment (const QObject* userData, const QString& pvName);
+
+   // A (closed) file or compressed file device, as per useCompression.
+   //
+   QIODevice* createOutput () const;
+
+   // Closes a device created by createOutput. Returns false if any write
+   // failed, including compressed output written in the background.
+   //
+   bool closeOutput (QIODevice* device) const;
+
+   bool openStream ();
+   void streamArchiveData (struct PVData* pvData, const QCaDataPointList& page);
+   void advanceStream (struct PVData* pvData);
+   void closeStream ();
+
+   void buildOutputTable (Rad_Aligner::Table& table) const;
+   QStringList pvNameList () const;
 
-   void putDatumSet (QTextStream& target, QCaDataPoint p [], const int j, const QCaDateTime & firstTime);
    void putArchiveData ();
+   void putBinaryArchiveData ();
+   void putWaveformData ();
+   void buildExportTable (Rad_ExportTable& table);
+   static void appendAlarms (Rad_Aligner::Column& column, const Rad_PointStore& points);
+   void putExportData ();
+   void putStatistics ();
 
    QDateTime value (const QString& s, bool& okay);
 
    void setTimeout (const double delay);
+   void terminate (const int status);
 
    // Convert time to timeZoneSpec zone.
    //
@@ -108,11 +313,18 @@ private slots:
    static void printFile (const QString&  filename,
                           std::ostream& stream);         // Print file to stream
 
-   void tickTimeout ();
+   void processState ();
+   void timeoutExpired ();
+   void pollExpired ();
+   void checkRequests ();
+   void archiveStatus ();
    void setArchiveData (const QObject* userData, const bool okay,
                         const QCaDataPointList& archiveData,
                         const QString& pvName, const QString& supplementary);
-
+   void setPartialArchiveData (const QObject* userData,
+                               const QCaDataPointList& archiveData,
+                               const QString& pvName);
+   void archiveBytesReceived (const QObject* userData, const qint64 bytes);
 };
 
 #endif  // RAD_CONTROL_H 
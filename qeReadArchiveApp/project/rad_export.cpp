@@ -0,0 +1,332 @@
+/*  rad_export.cpp
+ *
+ *  Copyright (c) 2025 Australian Synchrotron
+ *
+ *  The EPICS QT Framework is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The EPICS QT Framework is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Author:
+ *    Andrew Starritt
+ *  Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#include "rad_export.h"
+
+#include <iostream>
+#include <QByteArray>
+#include <QDataStream>
+#include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+#include <QtNumeric>
+#include <QECommon.h>
+#include "rad_text_formatter.h"
+
+#define DEBUG qDebug () << "rad_export" << __LINE__ << __FUNCTION__ << "  "
+
+// Columnar file layout. All values little endian.
+//
+//   offset  size  content
+//        0     8  magic "QERADCOL"
+//        8     4  uint32  format version (2)
+//       12     4  uint32  number of columns, C
+//       16     8  uint64  number of rows, N
+//       24   ...  C column descriptors:
+//                   uint32 name byte count, UTF-8 name
+//                   uint8  type: 1 int64 time (epoch ns), 2 float64, 3 uint16, 4 int32 category
+//                   uint32 number of dictionary entries, each uint32 byte count + UTF-8
+//                   uint64 file offset of column data
+//                   uint64 column data size in bytes (compressed)
+//
+// Column data is a sequence of blocks, each of up to blockRows values:
+//
+//   uint32  compressed block byte count, B
+//   B bytes as per qCompress, i.e. uint32 big endian uncompressed byte count
+//           followed by a zlib stream - e.g. Python: zlib.decompress (block [4:])
+//
+// Invalid float64 values are written as NaN. Version 1 type 3 was uint8.
+//
+static const char magic [8] = { 'Q', 'E', 'R', 'A', 'D', 'C', 'O', 'L' };
+static const quint32 formatVersion = 2;
+static const int blockRows = 65536;
+static const int compressionLevel = 6;
+
+//------------------------------------------------------------------------------
+//
+Rad_ExportTable::Rad_ExportTable () { }
+
+//------------------------------------------------------------------------------
+//
+Rad_ExportTable::~Rad_ExportTable () { }
+
+//------------------------------------------------------------------------------
+//
+Rad_ExportTable::Column& Rad_ExportTable::addColumn (const QString& name, const Types type)
+{
+   Column column;
+   column.name = name;
+   column.type = type;
+   this->columns.append (column);
+   return this->columns.last ();
+}
+
+//------------------------------------------------------------------------------
+//
+int Rad_ExportTable::numberColumns () const
+{
+   return this->columns.count ();
+}
+
+//------------------------------------------------------------------------------
+//
+int Rad_ExportTable::numberRows () const
+{
+   if (this->columns.isEmpty ()) return 0;
+
+   const Column& first = this->columns.first ();
+   switch (first.type) {
+      case timeType:     return first.times.count ();
+      case doubleType:   return first.doubles.count ();
+      case shortType:    return first.shorts.count ();
+      case categoryType: return first.categories.count ();
+   }
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+//
+const Rad_ExportTable::Column& Rad_ExportTable::column (const int index) const
+{
+   return this->columns.at (index);
+}
+
+//------------------------------------------------------------------------------
+// Quote names that contain the separator or quotes.
+//
+static QByteArray quoted (const QString& text, const char separator)
+{
+   QByteArray result = text.toUtf8 ();
+   if (result.contains (separator) || result.contains ('"') || result.contains ('\n')) {
+      result.replace ("\"", "\"\"");
+      result.prepend ('"');
+      result.append ('"');
+   }
+   return result;
+}
+
+//------------------------------------------------------------------------------
+//
+QByteArray Rad_ExportTable::header (const char separator) const
+{
+   QByteArray result;
+   for (int c = 0; c < this->columns.count (); c++) {
+      if (c > 0) result.append (separator);
+      result.append (quoted (this->columns.at (c).name, separator));
+   }
+   return result;
+}
+
+//------------------------------------------------------------------------------
+//
+bool Rad_ExportTable::writeDelimited (QIODevice& device, const char separator,
+                                      const Qt::TimeSpec timeSpec, const bool withHeader) const
+{
+   const int numberCols = this->columns.count ();
+   const int number = this->numberRows ();
+   QByteArray buffer;
+   buffer.reserve (1 << 20);
+
+   if (withHeader) {
+      buffer.append (this->header (separator));
+      buffer.append ('\n');
+   }
+
+   // Category entries are quoted once up front.
+   //
+   QList<QList<QByteArray> > dictionaries;
+   for (int c = 0; c < numberCols; c++) {
+      QList<QByteArray> entries;
+      const QStringList& dictionary = this->columns.at (c).dictionary;
+      for (int k = 0; k < dictionary.count (); k++) {
+         entries.append (quoted (dictionary.value (k), separator));
+      }
+      dictionaries.append (entries);
+   }
+
+   // Times are formatted via the zone and date caches of a text formatter.
+   //
+   Rad_TextFormatter formatter (timeSpec);
+
+   for (int j = 0; j < number; j++) {
+      for (int c = 0; c < numberCols; c++) {
+         const Column& column = this->columns.at (c);
+         if (c > 0) buffer.append (separator);
+
+         switch (column.type) {
+            case timeType:
+               formatter.appendIsoTime (buffer, column.times [j]);
+               break;
+
+            case doubleType:
+               // 17 significant digits round trip exactly. Empty when not valid.
+               //
+               if (column.isValid [j]) {
+                  buffer.append (QByteArray::number (column.doubles [j], 'g', 17));
+               }
+               break;
+
+            case shortType:
+               buffer.append (QByteArray::number (column.shorts [j]));
+               break;
+
+            case categoryType:
+               buffer.append (dictionaries.at (c).value (column.categories [j]));
+               break;
+         }
+      }
+      buffer.append ('\n');
+
+      // Stop at the first failed write.
+      //
+      if (buffer.size () >= (1 << 20)) {
+         if (device.write (buffer) != buffer.size ()) {
+            std::cerr << "write file failed" << std::endl;
+            return false;
+         }
+         buffer.resize (0);
+      }
+   }
+
+   if (device.write (buffer) != buffer.size ()) {
+      std::cerr << "write file failed" << std::endl;
+      return false;
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+// Encodes rows [first, first + count) of the column as little endian bytes.
+//
+static QByteArray encodeBlock (const Rad_ExportTable::Column& column,
+                               const int first, const int count)
+{
+   QByteArray result;
+   QDataStream stream (&result, QIODevice::WriteOnly);
+   stream.setByteOrder (QDataStream::LittleEndian);
+   stream.setFloatingPointPrecision (QDataStream::DoublePrecision);
+
+   for (int j = first; j < first + count; j++) {
+      switch (column.type) {
+         case Rad_ExportTable::timeType:
+            stream << column.times [j];
+            break;
+         case Rad_ExportTable::doubleType:
+            stream << (column.isValid [j] ? column.doubles [j] : qQNaN ());
+            break;
+         case Rad_ExportTable::shortType:
+            stream << column.shorts [j];
+            break;
+         case Rad_ExportTable::categoryType:
+            stream << column.categories [j];
+            break;
+      }
+   }
+   return result;
+}
+
+//------------------------------------------------------------------------------
+//
+bool Rad_ExportTable::writeColumnar (const QString& filename) const
+{
+   const int numberCols = this->columns.count ();
+   const int number = this->numberRows ();
+
+   // Compress each column first - the descriptors hold offsets and sizes.
+   //
+   QList<QByteArray> data;
+   for (int c = 0; c < numberCols; c++) {
+      QByteArray columnData;
+      QDataStream stream (&columnData, QIODevice::WriteOnly);
+      stream.setByteOrder (QDataStream::LittleEndian);
+
+      for (int first = 0; first < number; first += blockRows) {
+         const int count = MIN (blockRows, number - first);
+         const QByteArray block = qCompress (encodeBlock (this->columns.at (c), first, count),
+                                             compressionLevel);
+         stream << (quint32) block.size ();
+         stream.writeRawData (block.constData (), block.size ());
+      }
+      data.append (columnData);
+   }
+
+   // Build the header, with placeholder offsets, to determine its size.
+   //
+   QList<QByteArray> descriptors;
+   qint64 headerSize = sizeof (magic) + 4 + 4 + 8;
+   for (int c = 0; c < numberCols; c++) {
+      const Column& column = this->columns.at (c);
+      QByteArray descriptor;
+      QDataStream stream (&descriptor, QIODevice::WriteOnly);
+      stream.setByteOrder (QDataStream::LittleEndian);
+
+      const QByteArray name = column.name.toUtf8 ();
+      stream << (quint32) name.size ();
+      stream.writeRawData (name.constData (), name.size ());
+      stream << (quint8) (column.type + 1);
+      stream << (quint32) column.dictionary.count ();
+      for (int k = 0; k < column.dictionary.count (); k++) {
+         const QByteArray entry = column.dictionary.value (k).toUtf8 ();
+         stream << (quint32) entry.size ();
+         stream.writeRawData (entry.constData (), entry.size ());
+      }
+      descriptors.append (descriptor);
+      headerSize += descriptor.size () + 8 + 8;
+   }
+
+   QSaveFile file (filename);
+   if (!file.open (QIODevice::WriteOnly)) {
+      std::cerr << "open file failed" << std::endl;
+      return false;
+   }
+
+   QDataStream target (&file);
+   target.setByteOrder (QDataStream::LittleEndian);
+
+   target.writeRawData (magic, sizeof (magic));
+   target << (quint32) formatVersion
+          << (quint32) numberCols
+          << (quint64) number;
+
+   qint64 offset = headerSize;
+   for (int c = 0; c < numberCols; c++) {
+      const QByteArray& descriptor = descriptors.at (c);
+      target.writeRawData (descriptor.constData (), descriptor.size ());
+      target << (quint64) offset
+             << (quint64) data.at (c).size ();
+      offset += data.at (c).size ();
+   }
+
+   for (int c = 0; c < numberCols; c++) {
+      const QByteArray& columnData = data.at (c);
+      target.writeRawData (columnData.constData (), columnData.size ());
+   }
+
+   if ((target.status () != QDataStream::Ok) || !file.commit ()) {
+      std::cerr << "write columnar file failed" << std::endl;
+      return false;
+   }
+   return true;
+}
+
+// end
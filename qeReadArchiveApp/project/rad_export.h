@@ -0,0 +1,94 @@
+/* rad_export.h
+ *
+ * This file is part of the EPICS QT Framework, initially developed at the
+ * Australian Synchrotron.
+ *
+ * Copyright (c) 2025 Australian Synchrotron
+ *
+ * The EPICS QT Framework is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The EPICS QT Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author:
+ *    Andrew Starritt
+ * Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#ifndef RAD_EXPORT_H
+#define RAD_EXPORT_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QIODevice>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// A table of named, typed columns for export in a form suitable for
+// analysis tools, i.e. CSV/TSV with a single header line, or a compressed
+// columnar file. Rad_Control builds the table in wide form (one set of
+// columns per PV) or long form (one row per PV per time).
+//
+class Rad_ExportTable {
+public:
+   enum Types {
+      timeType,        // int64 nano seconds since 1970-01-01 00:00:00 UTC
+      doubleType,      // float64, NaN (or empty) when not valid
+      shortType,       // uint16, e.g. severity, status
+      categoryType     // int32 index into dictionary, e.g. PV name
+   };
+
+   struct Column {
+      QString name;
+      Types type;
+      QVector<qint64> times;
+      QVector<double> doubles;
+      QVector<bool> isValid;     // doubleType only
+      QVector<quint16> shorts;
+      QVector<qint32> categories;
+      QStringList dictionary;    // categoryType only
+   };
+
+   explicit Rad_ExportTable ();
+   ~Rad_ExportTable ();
+
+   // Each returns a reference to the new column, to be filled by the caller.
+   //
+   Column& addColumn (const QString& name, const Types type);
+
+   int numberColumns () const;
+   int numberRows () const;       // as per first column
+   const Column& column (const int index) const;
+
+   // CSV/TSV - one header line of column names, then one line per row.
+   // Times are ISO 8601 in the given time zone with nano second resolution.
+   // The device, e.g. a file, must already be open. When appending to an
+   // existing file (with a matching header), no header is written.
+   //
+   bool writeDelimited (QIODevice& device, const char separator,
+                        const Qt::TimeSpec timeSpec, const bool withHeader = true) const;
+
+   // The CSV/TSV header line, excluding the new line.
+   //
+   QByteArray header (const char separator) const;
+
+   // Compressed columnar file - see rad_export.cpp for the layout.
+   //
+   bool writeColumnar (const QString& filename) const;
+
+private:
+   QList<Column> columns;
+};
+
+#endif  // RAD_EXPORT_H
@@ -0,0 +1,372 @@
+/*  rad_follow.cpp
+ *
+ *  Copyright (c) 2025 Australian Synchrotron
+ *
+ *  The EPICS QT Framework is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The EPICS QT Framework is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Author:
+ *    Andrew Starritt
+ *  Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#include "rad_follow.h"
+#include "rad_binary_writer.h"
+#include "rad_cache.h"
+#include <math.h>
+#include <iostream>
+
+#include <QDebug>
+#include <QFile>
+#include <QList>
+#include <QRegularExpression>
+#include <QSet>
+
+#include <QECommon.h>
+
+#define DEBUG qDebug () << "rad_follow" << __LINE__ << __FUNCTION__ << "  "
+
+// Files are only examined at the start (for the first row) and from the end
+// (for the last rows), so the size of the file is largely immaterial.
+//
+static const qint64 blockSize = 65536;
+
+static const qint64 nanoSecsPerSecond = 1000000000;
+
+struct Line {
+   qint64 offset;       // file offset of the start of the line
+   QByteArray text;     // excluding the new line
+};
+
+//------------------------------------------------------------------------------
+// Returns the complete lines in [from, to). When from is not the start of a
+// line, the first (partial) line is discarded.
+//
+static QList<Line> readLines (QFile& file, const qint64 from, const qint64 to)
+{
+   QList<Line> result;
+
+   // Read the preceding byte too, to determine if from is a line start.
+   //
+   const qint64 readFrom = MAX ((qint64) 0, from - 1);
+   file.seek (readFrom);
+   const QByteArray block = file.read (to - readFrom);
+
+   int start = 0;
+   if (from > 0) {
+      start = block.indexOf ('\n') + 1;
+      if (start <= 0) return result;
+   }
+
+   while (start < block.size ()) {
+      int end = block.indexOf ('\n', start);
+      if (end < 0) end = block.size ();    // last line without a new line
+
+      Line line;
+      line.offset = readFrom + start;
+      line.text = block.mid (start, end - start);
+      if (line.text.endsWith ('\r')) line.text.chop (1);
+      result.append (line);
+
+      start = end + 1;
+   }
+
+   return result;
+}
+
+//------------------------------------------------------------------------------
+// Splits a csv/tsv line, removing any quotes as applied by Rad_ExportTable.
+//
+static QList<QByteArray> splitFields (const QByteArray& line, const char separator)
+{
+   QList<QByteArray> result;
+   QByteArray field;
+   bool isQuoted = false;
+
+   for (int j = 0; j < line.size (); j++) {
+      const char c = line.at (j);
+      if (isQuoted) {
+         if (c != '"') {
+            field.append (c);
+         } else if ((j + 1 < line.size ()) && (line.at (j + 1) == '"')) {
+            field.append ('"');
+            j++;
+         } else {
+            isQuoted = false;
+         }
+      } else if (c == '"') {
+         isQuoted = true;
+      } else if (c == separator) {
+         result.append (field);
+         field.clear ();
+      } else {
+         field.append (c);
+      }
+   }
+   result.append (field);
+   return result;
+}
+
+//------------------------------------------------------------------------------
+// Text file times, e.g. "26/05/2020 00:57:39" with an optional fraction.
+// The resolution is as per the number of fraction digits.
+//
+static bool parseTextTime (const QString& image, const QString& fraction,
+                           const Qt::TimeSpec timeSpec,
+                           QCaDateTime& time, qint64& resolution)
+{
+   QDateTime base = QDateTime::fromString (image, "dd/MM/yyyy HH:mm:ss");
+   if (!base.isValid ()) return false;
+   base.setTimeSpec (timeSpec);
+
+   const int digits = MIN (fraction.length (), 9);
+   resolution = nanoSecsPerSecond;
+   for (int j = 0; j < digits; j++) resolution /= 10;
+
+   const qint64 nanoSecs = (digits > 0) ? fraction.left (digits).toLongLong () * resolution : 0;
+   time = Rad_Cache::fromEpochNanoSeconds ((base.toMSecsSinceEpoch () / 1000) * nanoSecsPerSecond + nanoSecs);
+   return true;
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_FollowFile::Rad_FollowFile (const QString& filenameIn) :
+   filename (filenameIn),
+   resolutionNanoSecs (1),
+   endOffset (-1)
+{
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_FollowFile::~Rad_FollowFile () { }
+
+//------------------------------------------------------------------------------
+// The single PV text format, i.e. header lines starting with '#', and rows
+// starting with the row number followed by the date and time.
+//
+bool Rad_FollowFile::readText (const Qt::TimeSpec timeSpec)
+{
+   static const QRegularExpression rowPattern
+         ("^\\s*(\\d+)\\s+(\\d\\d/\\d\\d/\\d{4} \\d\\d:\\d\\d:\\d\\d)(?:\\.(\\d+))?\\s");
+
+   this->positions.clear ();
+   this->originTime = QCaDateTime ();
+   this->endOffset = -1;
+
+   QFile file (this->filename);
+   if (!file.exists ()) return true;
+
+   if (!file.open (QIODevice::ReadOnly)) {
+      std::cerr << "open file failed" << std::endl;
+      return false;
+   }
+
+   const qint64 size = file.size ();
+   qint64 resolution;
+
+   // The first row is the relative time reference.
+   //
+   QList<Line> lines = readLines (file, 0, MIN (size, blockSize));
+   for (int j = 0; j < lines.count (); j++) {
+      const QRegularExpressionMatch match = rowPattern.match (QString::fromLatin1 (lines [j].text));
+      if (match.hasMatch ()) {
+         parseTextTime (match.captured (2), match.captured (3), timeSpec,
+                        this->originTime, resolution);
+         break;
+      }
+   }
+
+   lines = readLines (file, MAX (0, size - blockSize), size);
+   for (int j = lines.count () - 1; j >= 0; j--) {
+      const QByteArray text = lines [j].text.trimmed ();
+      if (text.isEmpty () || text.startsWith ('#')) continue;
+
+      const QRegularExpressionMatch match = rowPattern.match (QString::fromLatin1 (lines [j].text));
+      Position position;
+      if (!match.hasMatch () ||
+          !parseTextTime (match.captured (2), match.captured (3), timeSpec,
+                          position.lastTime, this->resolutionNanoSecs))
+      {
+         std::cerr << colour::red
+                   << "error: " << this->filename.toLatin1 ().data ()
+                   << " is not a qerad single PV text file"
+                   << colour::reset << std::endl;
+         return false;
+      }
+
+      position.lastRow = match.captured (1).toInt ();
+      this->positions.insert ("", position);
+      this->endOffset = MIN (lines [j].offset + lines [j].text.size () + 1, size);
+      break;
+   }
+
+   file.close ();
+   return true;
+}
+
+//------------------------------------------------------------------------------
+// The csv/tsv formats - see Rad_ExportTable::writeDelimited. The header must
+// match exactly, so that appended rows are consistent with existing rows.
+//
+bool Rad_FollowFile::readDelimited (const char separator, const QByteArray& header,
+                                    const QStringList& pvNames)
+{
+   this->positions.clear ();
+   this->originTime = QCaDateTime ();
+   this->resolutionNanoSecs = 1;
+
+   QFile file (this->filename);
+   if (!file.exists ()) return true;
+
+   if (!file.open (QIODevice::ReadOnly)) {
+      std::cerr << "open file failed" << std::endl;
+      return false;
+   }
+
+   const qint64 size = file.size ();
+   if (size == 0) return true;
+
+   QByteArray firstLine = file.readLine ();
+   while (firstLine.endsWith ('\n') || firstLine.endsWith ('\r')) firstLine.chop (1);
+
+   if (firstLine != header) {
+      std::cerr << colour::red
+                << "error: " << this->filename.toLatin1 ().data ()
+                << " columns do not match the selected columns/layout"
+                << colour::reset << std::endl;
+      return false;
+   }
+
+   const QList<QByteArray> names = splitFields (header, separator);
+   const int pvIndex = names.indexOf ("pv");
+   const int timeIndex = names.indexOf ("time");
+   const int relativeIndex = names.indexOf ("relative");
+
+   if (timeIndex < 0) {
+      std::cerr << colour::red
+                << "error: --follow requires the time column"
+                << colour::reset << std::endl;
+      return false;
+   }
+
+   // The file is scanned backwards, a block at a time. For the wide layout
+   // only the last row is of interest. For the long layout, each PV's rows
+   // are in time order, so the first row found for a PV is its last - the
+   // scan stops once all the given PVs have been found (or at the first row).
+   //
+   const qint64 dataStart = file.pos ();
+   const bool isLong = (pvIndex >= 0);
+   QSet<QString> remaining;
+   for (int j = 0; j < pvNames.count (); j++) remaining.insert (pvNames.value (j));
+
+   QList<QByteArray> lastFields;    // of the last row in the file
+   qint64 to = size;
+   qint64 span = blockSize;
+   bool isDone = false;
+
+   while (!isDone && (to > dataStart)) {
+      const qint64 from = MAX (dataStart, to - span);
+      const QList<Line> lines = readLines (file, from, to);
+
+      // A line longer than the block - try again with a larger block.
+      //
+      if (lines.isEmpty () && (from > dataStart)) {
+         span *= 2;
+         continue;
+      }
+
+      for (int j = lines.count () - 1; j >= 0; j--) {
+         if (lines [j].text.isEmpty ()) continue;
+
+         QCaDateTime time;
+         const QList<QByteArray> fields = splitFields (lines [j].text, separator);
+         if ((fields.count () != names.count ()) ||
+             !Rad_FollowFile::parseIsoTime (fields.value (timeIndex), time))
+         {
+            std::cerr << colour::red
+                      << "error: " << this->filename.toLatin1 ().data ()
+                      << " unexpected row: " << lines [j].text.data ()
+                      << colour::reset << std::endl;
+            return false;
+         }
+
+         if (lastFields.isEmpty ()) lastFields = fields;
+
+         const QString key = isLong ? QString::fromUtf8 (fields.value (pvIndex)) : QString ("");
+         if (!this->positions.contains (key)) {
+            Position position;
+            position.lastTime = time;
+            position.lastRow = 0;
+            this->positions.insert (key, position);
+            remaining.remove (key);
+         }
+
+         if (!isLong || (!pvNames.isEmpty () && remaining.isEmpty ())) {
+            isDone = true;
+            break;
+         }
+      }
+
+      to = lines.isEmpty () ? dataStart : lines.first ().offset;
+      span = blockSize;
+   }
+
+   // Relative times are with respect to the start time, which is always a
+   // whole number of seconds.
+   //
+   if ((relativeIndex >= 0) && !this->positions.isEmpty ()) {
+      bool okay;
+      const double relative = lastFields.value (relativeIndex).toDouble (&okay);
+      if (okay) {
+         const double origin = (double) Rad_BinaryWriter::toEpochNanoSeconds (time) * 1.0e-9 - relative;
+         this->originTime = Rad_Cache::fromEpochNanoSeconds ((qint64) floor (origin + 0.5) * nanoSecsPerSecond);
+      }
+   }
+
+   file.close ();
+   return true;
+}
+
+//------------------------------------------------------------------------------
+// static
+//
+bool Rad_FollowFile::parseIsoTime (const QByteArray& image, QCaDateTime& time)
+{
+   static const QRegularExpression isoPattern
+         ("^(\\d{4}-\\d\\d-\\d\\dT\\d\\d:\\d\\d:\\d\\d)(?:\\.(\\d{1,9}))?(Z|([+-])(\\d\\d):(\\d\\d))$");
+
+   const QRegularExpressionMatch match = isoPattern.match (QString::fromLatin1 (image));
+   if (!match.hasMatch ()) return false;
+
+   QDateTime base = QDateTime::fromString (match.captured (1), "yyyy-MM-dd'T'HH:mm:ss");
+   if (!base.isValid ()) return false;
+   base.setTimeSpec (Qt::UTC);
+
+   // The time is local to the given offset - convert to UTC.
+   //
+   qint64 seconds = base.toMSecsSinceEpoch () / 1000;
+   if (match.captured (3) != "Z") {
+      const qint64 offset = match.captured (5).toLongLong () * 3600 + match.captured (6).toLongLong () * 60;
+      seconds += (match.captured (4) == "-") ? offset : -offset;
+   }
+
+   const QString fraction = match.captured (2);
+   const qint64 nanoSecs = fraction.isEmpty () ? 0 : fraction.leftJustified (9, '0').toLongLong ();
+
+   time = Rad_Cache::fromEpochNanoSeconds (seconds * nanoSecsPerSecond + nanoSecs);
+   return true;
+}
+
+// end
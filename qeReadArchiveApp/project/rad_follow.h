@@ -0,0 +1,96 @@
+/* rad_follow.h
+ *
+ * This file is part of the EPICS QT Framework, initially developed at the
+ * Australian Synchrotron.
+ *
+ * Copyright (c) 2025 Australian Synchrotron
+ *
+ * The EPICS QT Framework is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The EPICS QT Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author:
+ *    Andrew Starritt
+ * Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+
+#ifndef RAD_FOLLOW_H
+#define RAD_FOLLOW_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+#include <QCaDateTime.h>
+
+// Determines where a previous qerad run left off, so that --follow may
+// append only newer data to an existing output file. Supports the single PV
+// text format and the csv/tsv formats, wide or long layout.
+//
+class Rad_FollowFile {
+public:
+   // Per PV position. For the wide layout the PV name key is empty.
+   //
+   struct Position {
+      QCaDateTime lastTime;     // time of the last row - as per file resolution
+      int lastRow;              // text only: the last row number
+   };
+
+   explicit Rad_FollowFile (const QString& filename);
+   ~Rad_FollowFile ();
+
+   // Each returns false if the file exists but cannot be followed, e.g. it is
+   // in a different format. A non-existent or empty file is okay, but then
+   // isEmpty returns true, i.e. the output is written afresh.
+   //
+   bool readText (const Qt::TimeSpec timeSpec);
+   // For the long layout, pvNames are the PVs of interest - the scan for each
+   // PV's last row stops once all have been found.
+   //
+   bool readDelimited (const char separator, const QByteArray& header,
+                       const QStringList& pvNames = QStringList ());
+
+   bool isEmpty () const { return this->positions.isEmpty (); }
+   bool contains (const QString& pvName) const { return this->positions.contains (pvName); }
+   Position position (const QString& pvName) const { return this->positions.value (pvName); }
+
+   // The relative time reference of the file, if known (else invalid).
+   //
+   QCaDateTime origin () const { return this->originTime; }
+
+   // Time stamp resolution of the file, i.e. the last row's actual time may
+   // be up to this much (less one nano second) after lastTime.
+   //
+   qint64 resolution () const { return this->resolutionNanoSecs; }
+
+   // Text only: file offset of the trailer, i.e. just after the last row.
+   //
+   qint64 trailerOffset () const { return this->endOffset; }
+
+   // Parses an ISO 8601 time as written by Rad_ExportTable, e.g.
+   // 2025-05-26T17:13:05.123456789+10:00
+   //
+   static bool parseIsoTime (const QByteArray& image, QCaDateTime& time);
+
+private:
+   QString filename;
+   QHash<QString, Position> positions;
+   QCaDateTime originTime;
+   qint64 resolutionNanoSecs;
+   qint64 endOffset;
+};
+
+#endif  // RAD_FOLLOW_H
@@ -0,0 +1,317 @@
+/*  rad_gzip.cpp
+ *
+ *  Copyright (c) 2025 Australian Synchrotron
+ *
+ *  The EPICS QT Framework is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The EPICS QT Framework is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Author:
+ *    Andrew Starritt
+ *  Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#include "rad_gzip.h"
+#include <string.h>
+#include <zlib.h>
+
+#include <QDebug>
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QWaitCondition>
+
+#define DEBUG qDebug () << "rad_gzip" << __LINE__ << __FUNCTION__ << "  "
+
+// Deflate window bits plus 16 => gzip header and trailer.
+//
+static const int gzipWindowBits = 15 + 16;
+
+//------------------------------------------------------------------------------
+// Compresses queued blocks and writes them to the file. All zlib and file
+// access occurs within this thread.
+//
+class Rad_GzipWorker : public QThread {
+public:
+   explicit Rad_GzipWorker (QFile* file, const int level);
+   ~Rad_GzipWorker ();
+
+   // Returns false if the worker has failed.
+   //
+   bool enqueue (const QByteArray& block);
+   void finish ();                // signals end of data - caller then waits
+   bool isOkay () const;
+
+protected:
+   void run ();
+
+private:
+   bool deflateBlock (z_stream& stream, const QByteArray& block, const int flush);
+
+   QFile* file;
+   const int level;
+
+   mutable QMutex mutex;
+   QWaitCondition hasWork;
+   QWaitCondition hasSpace;
+   QList<QByteArray> queue;
+   qint64 queuedBytes;
+   bool isFinishing;
+   bool isFailed;
+};
+
+//------------------------------------------------------------------------------
+//
+Rad_GzipWorker::Rad_GzipWorker (QFile* fileIn, const int levelIn) :
+   QThread (NULL),
+   file (fileIn),
+   level (levelIn),
+   queuedBytes (0),
+   isFinishing (false),
+   isFailed (false)
+{
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_GzipWorker::~Rad_GzipWorker ()
+{
+   delete this->file;
+}
+
+//------------------------------------------------------------------------------
+//
+bool Rad_GzipWorker::enqueue (const QByteArray& block)
+{
+   QMutexLocker locker (&this->mutex);
+
+   // Back pressure - only when the compressor is well behind.
+   //
+   while (!this->isFailed && (this->queuedBytes + block.size () > Rad_GzipFile::maxQueued) &&
+          !this->queue.isEmpty ()) {
+      this->hasSpace.wait (&this->mutex);
+   }
+   if (this->isFailed) return false;
+
+   this->queue.append (block);
+   this->queuedBytes += block.size ();
+   this->hasWork.wakeOne ();
+   return true;
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_GzipWorker::finish ()
+{
+   QMutexLocker locker (&this->mutex);
+   this->isFinishing = true;
+   this->hasWork.wakeOne ();
+}
+
+//------------------------------------------------------------------------------
+//
+bool Rad_GzipWorker::isOkay () const
+{
+   QMutexLocker locker (&this->mutex);
+   return !this->isFailed;
+}
+
+//------------------------------------------------------------------------------
+//
+bool Rad_GzipWorker::deflateBlock (z_stream& stream, const QByteArray& block, const int flush)
+{
+   char output [1 << 16];
+
+   stream.next_in = (Bytef*) block.constData ();
+   stream.avail_in = (uInt) block.size ();
+
+   int status;
+   do {
+      stream.next_out = (Bytef*) output;
+      stream.avail_out = sizeof (output);
+      status = deflate (&stream, flush);
+      if (status == Z_STREAM_ERROR) return false;
+
+      const qint64 produced = (qint64) sizeof (output) - stream.avail_out;
+      if ((produced > 0) && (this->file->write (output, produced) != produced)) return false;
+   } while ((stream.avail_out == 0) || ((flush == Z_FINISH) && (status != Z_STREAM_END)));
+
+   return true;
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_GzipWorker::run ()
+{
+   z_stream stream;
+   memset (&stream, 0, sizeof (stream));
+
+   bool okay = (deflateInit2 (&stream, this->level, Z_DEFLATED, gzipWindowBits,
+                              8, Z_DEFAULT_STRATEGY) == Z_OK);
+
+   while (okay) {
+      QByteArray block;
+      bool isLast;
+      {
+         QMutexLocker locker (&this->mutex);
+         while (this->queue.isEmpty () && !this->isFinishing) {
+            this->hasWork.wait (&this->mutex);
+         }
+         if (!this->queue.isEmpty ()) {
+            block = this->queue.takeFirst ();
+            this->queuedBytes -= block.size ();
+            this->hasSpace.wakeAll ();
+         }
+         isLast = this->queue.isEmpty () && this->isFinishing;
+      }
+
+      okay = this->deflateBlock (stream, block, isLast ? Z_FINISH : Z_NO_FLUSH);
+      if (isLast) break;
+   }
+
+   deflateEnd (&stream);
+   okay = okay && this->file->flush ();
+   this->file->close ();
+
+   if (!okay) {
+      QMutexLocker locker (&this->mutex);
+      this->isFailed = true;
+      this->queue.clear ();
+      this->queuedBytes = 0;
+      this->hasSpace.wakeAll ();
+   }
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_GzipFile::Rad_GzipFile (const QString& filenameIn, const int levelIn) :
+   QIODevice (),
+   filename (filenameIn),
+   level (levelIn),
+   worker (NULL),
+   isFailed (false)
+{
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_GzipFile::~Rad_GzipFile ()
+{
+   this->close ();
+}
+
+//------------------------------------------------------------------------------
+// static
+bool Rad_GzipFile::isGzipName (const QString& filename)
+{
+   return filename.endsWith (".gz", Qt::CaseInsensitive);
+}
+
+//------------------------------------------------------------------------------
+//
+bool Rad_GzipFile::isSequential () const
+{
+   return true;
+}
+
+//------------------------------------------------------------------------------
+// Write only. Text mode is not applicable - the data is written as is.
+//
+bool Rad_GzipFile::open (OpenMode mode)
+{
+   if (this->isOpen () || !(mode & QIODevice::WriteOnly) || (mode & QIODevice::ReadOnly)) {
+      return false;
+   }
+
+   QFile* file = new QFile (this->filename);
+   const OpenMode fileMode = (mode & QIODevice::Append) ? (QIODevice::WriteOnly | QIODevice::Append)
+                                                        : QIODevice::WriteOnly;
+   if (!file->open (fileMode)) {
+      this->setErrorString (file->errorString ());
+      delete file;
+      return false;
+   }
+
+   this->pending.clear ();
+   this->pending.reserve (blockSize);
+   this->isFailed = false;
+   this->worker = new Rad_GzipWorker (file, this->level);
+   this->worker->start ();
+
+   return QIODevice::open (mode & ~QIODevice::Text);
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_GzipFile::close ()
+{
+   if (!this->worker) return;
+
+   this->flushPending ();
+   this->worker->finish ();
+   this->worker->wait ();
+
+   this->isFailed = !this->worker->isOkay ();
+   if (this->isFailed) {
+      this->setErrorString ("gzip compress/write failed");
+   }
+
+   delete this->worker;
+   this->worker = NULL;
+   QIODevice::close ();
+}
+
+//------------------------------------------------------------------------------
+//
+bool Rad_GzipFile::isOkay () const
+{
+   if (this->worker) return this->worker->isOkay ();
+   return !this->isFailed;
+}
+
+//------------------------------------------------------------------------------
+//
+qint64 Rad_GzipFile::readData (char*, qint64)
+{
+   return -1;
+}
+
+//------------------------------------------------------------------------------
+//
+qint64 Rad_GzipFile::writeData (const char* data, qint64 size)
+{
+   if (!this->worker) return -1;
+
+   this->pending.append (data, (int) size);
+   if (this->pending.size () >= blockSize) {
+      this->flushPending ();
+   }
+
+   return this->worker->isOkay () ? size : -1;
+}
+
+//------------------------------------------------------------------------------
+// Hand the gathered block to the background thread.
+//
+void Rad_GzipFile::flushPending ()
+{
+   if (this->pending.isEmpty ()) return;
+
+   this->worker->enqueue (this->pending);
+   this->pending = QByteArray ();
+   this->pending.reserve (blockSize);
+}
+
+// end
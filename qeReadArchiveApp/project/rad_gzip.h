@@ -0,0 +1,80 @@
+/* rad_gzip.h
+ *
+ * This file is part of the EPICS QT Framework, initially developed at the
+ * Australian Synchrotron.
+ *
+ * Copyright (c) 2025 Australian Synchrotron
+ *
+ * The EPICS QT Framework is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The EPICS QT Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author:
+ *    Andrew Starritt
+ * Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+
+#ifndef RAD_GZIP_H
+#define RAD_GZIP_H
+
+#include <QIODevice>
+#include <QString>
+
+class Rad_GzipWorker;
+
+// Write only device that writes gzip (RFC 1952) compressed output, i.e. it is
+// readable with gunzip, zcat, zless etc. Data written is gathered into blocks
+// which are compressed and written to the file by a background thread, so
+// that formatting and compression are pipelined. The writer only waits when
+// the compressor is more than maxQueued bytes behind.
+//
+// Opening with Append adds a new gzip member to an existing file, which gzip
+// tools treat as a continuation of the data.
+//
+class Rad_GzipFile : public QIODevice {
+public:
+   explicit Rad_GzipFile (const QString& filename, const int level = 6);
+   ~Rad_GzipFile ();
+
+   bool open (OpenMode mode);
+   void close ();                 // waits for the background thread
+   bool isSequential () const;
+
+   // False if compression or writing the file has failed. Only conclusive
+   // after close, as the data is written by the background thread.
+   //
+   bool isOkay () const;
+
+   // True if the file name ends with .gz
+   //
+   static bool isGzipName (const QString& filename);
+
+   static const int blockSize = 1 << 20;
+   static const int maxQueued = 32 << 20;
+
+protected:
+   qint64 readData (char* data, qint64 maxSize);
+   qint64 writeData (const char* data, qint64 size);
+
+private:
+   void flushPending ();
+
+   const QString filename;
+   const int level;
+   QByteArray pending;            // block being gathered
+   Rad_GzipWorker* worker;        // only exists while open
+   bool isFailed;                 // as at the last close
+};
+
+#endif  // RAD_GZIP_H
@@ -0,0 +1,294 @@
+/*  rad_jobs.cpp
+ *
+ *  Copyright (c) 2025 Australian Synchrotron
+ *
+ *  The EPICS QT Framework is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The EPICS QT Framework is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Author:
+ *    Andrew Starritt
+ *  Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#include "rad_jobs.h"
+#include "rad_archive_source.h"
+#include "rad_control.h"
+#include "rad_statistics.h"
+#include <iostream>
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QTimer>
+
+#include <QECommon.h>
+
+#define DEBUG qDebug () << "rad_jobs" << __LINE__ << __FUNCTION__ << "  "
+
+//------------------------------------------------------------------------------
+//
+Rad_JobRunner::Rad_JobRunner (Rad_ArchiveSource* source) : QObject (NULL)
+{
+   this->options = new QEOptions ();
+   this->archiveSource = source;
+   this->isOwnSource = (source == NULL);
+   this->maxConcurrent = 1;
+   this->numberRunning = 0;
+   this->numberComplete = 0;
+   this->nextJob = 0;
+
+   // Start once the event loop is running.
+   //
+   QTimer::singleShot (0, this, SLOT (start ()));
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_JobRunner::~Rad_JobRunner ()
+{
+   for (int j = 0; j < this->jobs.count (); j++) {
+      delete this->jobs [j].control;
+   }
+   delete this->options;
+   if (this->isOwnSource) delete this->archiveSource;
+}
+
+//------------------------------------------------------------------------------
+// Each job's arguments are the program name, the common options, the job's
+// own options and then the job's parameters.
+//
+bool Rad_JobRunner::readJobs (const QString& filename)
+{
+   QFile file (filename);
+   if (!file.open (QIODevice::ReadOnly | QIODevice::Text)) {
+      std::cerr << colour::red
+                << "error: cannot open jobs file " << filename.toLatin1 ().data ()
+                << colour::reset << std::endl;
+      return false;
+   }
+
+   QJsonParseError parseError;
+   const QJsonDocument document = QJsonDocument::fromJson (file.readAll (), &parseError);
+   file.close ();
+
+   if (!document.isArray ()) {
+      std::cerr << colour::red
+                << "error: jobs file " << filename.toLatin1 ().data ()
+                << " is not a JSON array: " << parseError.errorString ().toLatin1 ().data ()
+                << colour::reset << std::endl;
+      return false;
+   }
+
+   // Common options, i.e. command line options less the batch options.
+   //
+   const QStringList arguments = QCoreApplication::arguments ();
+   QStringList common;
+   for (int j = 1; j < arguments.count (); j++) {
+      const QString argument = arguments.value (j);
+      if (!argument.startsWith ("-")) continue;
+      if (argument.startsWith ("--jobs") || argument.startsWith ("--concurrent-jobs")) continue;
+      common << argument;
+   }
+
+   const QJsonArray array = document.array ();
+   for (int j = 0; j < array.count (); j++) {
+      const QJsonObject item = array.at (j).toObject ();
+
+      Job job;
+      job.output = item.value ("output").toString ();
+      job.control = NULL;
+      job.duration = 0.0;
+      job.pointsWritten = 0;
+      job.status = -1;
+
+      const QString start = item.value ("start").toString ();
+      const QString end = item.value ("end").toString ();
+      const QJsonArray pvs = item.value ("pvs").toArray ();
+
+      if (job.output.isEmpty () || start.isEmpty () || end.isEmpty () || pvs.isEmpty ()) {
+         std::cerr << colour::red
+                   << "error: job " << j + 1
+                   << " requires output, start, end and pvs"
+                   << colour::reset << std::endl;
+         return false;
+      }
+
+      job.arguments << arguments.value (0) << common;
+
+      const QString mode = item.value ("mode").toString ();
+      if (mode == "raw") {
+         job.arguments << "--raw";
+      } else if (!mode.isEmpty () && (mode != "linear")) {
+         job.arguments << QString ("--mode=%1").arg (mode);
+      }
+
+      if (item.contains ("fixed")) {
+         job.arguments << QString ("--fixed=%1").arg (item.value ("fixed").toDouble ());
+      }
+
+      const QJsonArray extra = item.value ("options").toArray ();
+      for (int k = 0; k < extra.count (); k++) {
+         job.arguments << extra.at (k).toString ();
+      }
+
+      job.arguments << job.output << start << end;
+      for (int k = 0; k < pvs.count (); k++) {
+         job.arguments << pvs.at (k).toString ();
+      }
+
+      this->jobs.append (job);
+   }
+
+   return true;
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_JobRunner::start ()
+{
+   this->overall.start ();
+
+   const QString filename = this->options->getString ("jobs", "");
+   if (!this->readJobs (filename)) {
+      emit this->finished (1);
+      QCoreApplication::exit (1);
+      return;
+   }
+
+   if (this->options->isSpecified ("concurrent-jobs")) {
+      this->maxConcurrent = this->options->getInt ("concurrent-jobs", 0);
+      if (this->maxConcurrent < 1) {
+         std::cerr << colour::red
+                   << "error: concurrent jobs must be at least 1."
+                   << colour::reset << std::endl;
+         emit this->finished (1);
+         QCoreApplication::exit (1);
+         return;
+      }
+   }
+
+   std::cout << "number of jobs: " << this->jobs.count ()
+             << ", concurrent jobs: " << this->maxConcurrent << std::endl;
+
+   // The one archive source for all jobs.
+   //
+   if (!this->archiveSource) {
+      this->archiveSource = Rad_ArchiveSource::create (this->options);
+   }
+
+   this->startJobs ();
+}
+
+//------------------------------------------------------------------------------
+// Start jobs, in order, up to the concurrent job limit. Once all jobs are
+// complete, output the summary and exit.
+//
+void Rad_JobRunner::startJobs ()
+{
+   while ((this->numberRunning < this->maxConcurrent) &&
+          (this->nextJob < this->jobs.count ())) {
+      Job& job = this->jobs [this->nextJob++];
+
+      std::cout << "\nstarting job " << this->nextJob << ": "
+                << job.output.toLatin1 ().data () << std::endl;
+
+      job.timer.start ();
+      job.control = new Rad_Control (this->archiveSource, job.arguments);
+      QObject::connect (job.control, SIGNAL (finished (const int)),
+                        this,        SLOT   (jobFinished (const int)));
+      this->numberRunning++;
+   }
+
+   if (this->numberComplete < this->jobs.count ()) return;
+
+   this->putSummary ();
+
+   // Any job error takes precedence over a partial result.
+   //
+   int status = 0;
+   for (int j = 0; j < this->jobs.count (); j++) {
+      const int jobStatus = this->jobs.value (j).status;
+      if (jobStatus == 2) {
+         if (status == 0) status = 2;
+      } else if (jobStatus != 0) {
+         status = 1;
+      }
+   }
+
+   emit this->finished (status);
+   QCoreApplication::exit (status);
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_JobRunner::jobFinished (const int status)
+{
+   const Rad_Control* control = qobject_cast<const Rad_Control*> (this->sender ());
+
+   for (int j = 0; j < this->jobs.count (); j++) {
+      Job& job = this->jobs [j];
+      if (!control || (job.control != control)) continue;
+
+      job.status = status;
+      job.duration = job.timer.nsecsElapsed () * 1.0e-9;
+      job.pointsWritten = job.control->getStatistics ()->count (Rad_Statistics::PointsWritten);
+
+      // The job is still in the midst of emitting finished.
+      //
+      job.control->deleteLater ();
+      job.control = NULL;
+
+      this->numberRunning--;
+      this->numberComplete++;
+      break;
+   }
+
+   this->startJobs ();
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_JobRunner::putSummary () const
+{
+   std::cout << "\nJob summary\n"
+             << "#   No  Status          Time        Points  Output\n";
+
+   int numberOkay = 0;
+   for (int j = 0; j < this->jobs.count (); j++) {
+      const Job& job = this->jobs.at (j);
+      QString status;
+      switch (job.status) {
+         case 0:  status = "okay";    numberOkay++; break;
+         case 2:  status = "partial"; break;
+         default: status = "failed";  break;
+      }
+
+      std::cout << QString ("%1  %2  %3 s  %4  %5")
+                   .arg (j + 1, 6)
+                   .arg (status, -8)
+                   .arg (job.duration, 12, 'f', 3)
+                   .arg (job.pointsWritten, 12)
+                   .arg (job.output).toLatin1 ().data () << std::endl;
+   }
+
+   std::cout << numberOkay << " of " << this->jobs.count () << " jobs okay, total time "
+             << QString::number (this->overall.nsecsElapsed () * 1.0e-9, 'f', 3).toLatin1 ().data ()
+             << " s" << std::endl;
+}
+
+// end
@@ -0,0 +1,102 @@
+/* rad_jobs.h
+ *
+ * This file is part of the EPICS QT Framework, initially developed at the
+ * Australian Synchrotron.
+ *
+ * Copyright (c) 2025 Australian Synchrotron
+ *
+ * The EPICS QT Framework is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The EPICS QT Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author:
+ *    Andrew Starritt
+ * Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+
+#ifndef RAD_JOBS_H
+#define RAD_JOBS_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include <QEOptions.h>
+
+class Rad_ArchiveSource;
+class Rad_Control;
+
+// Batch mode, i.e. --jobs=<file>. Runs many extraction jobs in the one
+// process, all sharing the one archive source, so that the archiver
+// interface is only initialised once. Each job is a Rad_Control configured
+// by its own argument list. The jobs file is a JSON array of objects, e.g.
+//
+//    [ { "output" : "current.csv",
+//        "start"  : "16/06/2020 00:00:00",
+//        "end"    : "17/06/2020 00:00:00",
+//        "pvs"    : [ "SR11BCM01:CURRENT_MONITOR" ],
+//        "mode"   : "raw",
+//        "fixed"  : 60,
+//        "options": [ "--format=csv" ] } ]
+//
+// where mode is raw, linear or any --mode reduction mode. Options on the
+// command line (other than --jobs and --concurrent-jobs) apply to all jobs.
+//
+class Rad_JobRunner : public QObject {
+Q_OBJECT
+public:
+   // When source is NULL, the QE framework archive access is used.
+   //
+   explicit Rad_JobRunner (Rad_ArchiveSource* source = NULL);
+   ~Rad_JobRunner ();
+
+signals:
+   // Emitted once all jobs are complete, just prior to requesting the
+   // application event loop to exit.
+   //
+   void finished (const int status);
+
+private:
+   struct Job {
+      QString output;
+      QStringList arguments;    // as per a qerad command line
+      Rad_Control* control;     // NULL unless running
+      QElapsedTimer timer;
+      double duration;          // seconds
+      qint64 pointsWritten;
+      int status;               // -1 until complete
+   };
+
+   bool readJobs (const QString& filename);
+   void startJobs ();
+   void putSummary () const;
+
+   QEOptions* options;
+   Rad_ArchiveSource* archiveSource;
+   bool isOwnSource;
+   QList<Job> jobs;
+   int maxConcurrent;
+   int numberRunning;
+   int numberComplete;
+   int nextJob;
+   QElapsedTimer overall;
+
+private slots:
+   void start ();
+   void jobFinished (const int status);
+};
+
+#endif  // RAD_JOBS_H
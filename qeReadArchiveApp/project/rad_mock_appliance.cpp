@@ -0,0 +1,843 @@
+/*  rad_mock_appliance.cpp
+ *
+ *  Copyright (c) 2025 Australian Synchrotron
+ *
+ *  The EPICS QT Framework is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The EPICS QT Framework is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Author:
+ *    Andrew Starritt
+ *  Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#include "rad_mock_appliance.h"
+
+#include <iostream>
+#include <math.h>
+#include <QtNumeric>
+#include <string.h>
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QList>
+#include <QRegularExpression>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUrl>
+#include <QUrlQuery>
+#include <QVector>
+#include <QtEndian>
+
+#include <QECommon.h>
+#include <QCaAlarmInfo.h>
+#include <QCaDataPoint.h>
+#include "rad_appliance_source.h"
+#include "rad_binary_writer.h"
+#include "rad_mock_archive.h"
+
+#define DEBUG qDebug () << "rad_mock_appliance" << __LINE__ << __FUNCTION__ << "  "
+
+static const char escapeChar = 0x1B;
+static const qint64 nanoSecsPerSec = 1000000000;
+static const char* const isoFormat = "yyyy-MM-ddTHH:mm:ss.zzzZ";
+
+//------------------------------------------------------------------------------
+//
+static qint64 startOfYear (const int year)   // epoch mSec
+{
+   return QDateTime (QDate (year, 1, 1), QTime (0, 0), Qt::UTC).toMSecsSinceEpoch ();
+}
+
+//==============================================================================
+// Rad_ApplianceEncoder
+//==============================================================================
+//
+void Rad_ApplianceEncoder::putVarint (QByteArray& message, const quint64 value)
+{
+   quint64 work = value;
+   while (work >= 0x80) {
+      message.append ((char) ((work & 0x7F) | 0x80));
+      work >>= 7;
+   }
+   message.append ((char) work);
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_ApplianceEncoder::putKey (QByteArray& message, const int field, const int wireType)
+{
+   Rad_ApplianceEncoder::putVarint (message, ((quint64) field << 3) | (quint64) wireType);
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_ApplianceEncoder::putFixed32 (QByteArray& message, const quint32 value)
+{
+   uchar bytes [4];
+   qToLittleEndian<quint32> (value, bytes);
+   message.append ((const char*) bytes, 4);
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_ApplianceEncoder::putFixed64 (QByteArray& message, const quint64 value)
+{
+   uchar bytes [8];
+   qToLittleEndian<quint64> (value, bytes);
+   message.append ((const char*) bytes, 8);
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_ApplianceEncoder::putBytes (QByteArray& message, const int field, const QByteArray& bytes)
+{
+   Rad_ApplianceEncoder::putKey (message, field, 2);
+   Rad_ApplianceEncoder::putVarint (message, (quint64) bytes.size ());
+   message.append (bytes);
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_ApplianceEncoder::putFloat (QByteArray& message, const float value)
+{
+   quint32 bits;
+   memcpy (&bits, &value, sizeof (bits));
+   Rad_ApplianceEncoder::putFixed32 (message, bits);
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_ApplianceEncoder::putDouble (QByteArray& message, const double value)
+{
+   quint64 bits;
+   memcpy (&bits, &value, sizeof (bits));
+   Rad_ApplianceEncoder::putFixed64 (message, bits);
+}
+
+//------------------------------------------------------------------------------
+//
+QByteArray Rad_ApplianceEncoder::header (const int type, const QString& pvName, const int year)
+{
+   QByteArray message;
+   Rad_ApplianceEncoder::putKey (message, 1, 0);
+   Rad_ApplianceEncoder::putVarint (message, (quint64) type);
+   Rad_ApplianceEncoder::putBytes (message, 2, pvName.toUtf8 ());
+   Rad_ApplianceEncoder::putKey (message, 3, 0);
+   Rad_ApplianceEncoder::putVarint (message, (quint64) year);
+   return message;
+}
+
+//------------------------------------------------------------------------------
+// Severity and status are omitted when zero, as per protocol buffer defaults.
+//
+QByteArray Rad_ApplianceEncoder::sample (const quint32 secondsIntoYear, const quint32 nanoSecs,
+                                         const int severity, const int status)
+{
+   QByteArray message;
+   Rad_ApplianceEncoder::putKey (message, 1, 0);
+   Rad_ApplianceEncoder::putVarint (message, secondsIntoYear);
+   Rad_ApplianceEncoder::putKey (message, 2, 0);
+   Rad_ApplianceEncoder::putVarint (message, nanoSecs);
+   if (severity) {
+      Rad_ApplianceEncoder::putKey (message, 4, 0);
+      Rad_ApplianceEncoder::putVarint (message, (quint64) severity);
+   }
+   if (status) {
+      Rad_ApplianceEncoder::putKey (message, 5, 0);
+      Rad_ApplianceEncoder::putVarint (message, (quint64) status);
+   }
+   return message;
+}
+
+//------------------------------------------------------------------------------
+//
+QByteArray Rad_ApplianceEncoder::line (const QByteArray& message)
+{
+   QByteArray result;
+   result.reserve (message.size () + 8);
+   for (int j = 0; j < message.size (); j++) {
+      const char c = message.at (j);
+      switch (c) {
+         case escapeChar: result.append (escapeChar).append ((char) 1);  break;
+         case '\n':       result.append (escapeChar).append ((char) 2);  break;
+         case '\r':       result.append (escapeChar).append ((char) 3);  break;
+         default:         result.append (c);                             break;
+      }
+   }
+   result.append ('\n');
+   return result;
+}
+
+
+//==============================================================================
+// Rad_MockApplianceServer
+//==============================================================================
+//
+Rad_MockApplianceServer::Rad_MockApplianceServer (const int numberPVsIn,
+                                                  const double samplePeriod,
+                                                  const int numberElementsIn,
+                                                  const int pieceSizeIn,
+                                                  const int pieceInterval,
+                                                  const QString& savedResponseIn,
+                                                  QObject* parent) :
+   QObject (parent),
+   numberPVs (numberPVsIn),
+   periodMSecs (MAX ((qint64) 1, (qint64) (samplePeriod * 1000.0 + 0.5))),
+   numberElements (MAX (1, numberElementsIn)),
+   pieceSize (MAX (1, pieceSizeIn)),
+   savedResponse (savedResponseIn)
+{
+   this->server = new QTcpServer (this);
+   QObject::connect (this->server, SIGNAL (newConnection ()),
+                     this,         SLOT   (newConnection ()));
+
+   this->pieceTimer.setInterval (MAX (0, pieceInterval));
+   QObject::connect (&this->pieceTimer, SIGNAL (timeout ()),
+                     this,              SLOT   (sendPieces ()));
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_MockApplianceServer::~Rad_MockApplianceServer () { }
+
+//------------------------------------------------------------------------------
+//
+bool Rad_MockApplianceServer::listen ()
+{
+   if (!this->server->listen (QHostAddress::LocalHost, 0)) {
+      std::cerr << colour::red
+                << "mock appliance: cannot listen: "
+                << this->server->errorString ().toLatin1 ().data ()
+                << colour::reset << std::endl;
+      return false;
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+//
+QString Rad_MockApplianceServer::url () const
+{
+   return QString ("http://127.0.0.1:%1/retrieval").arg (this->server->serverPort ());
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_MockApplianceServer::newConnection ()
+{
+   while (this->server->hasPendingConnections ()) {
+      QTcpSocket* socket = this->server->nextPendingConnection ();
+
+      Connection item;
+      item.sent = 0;
+      this->connections.insert (socket, item);
+
+      QObject::connect (socket, SIGNAL (readyRead ()),
+                        this,   SLOT   (readyRead ()));
+      QObject::connect (socket, &QTcpSocket::disconnected, this, [=] () {
+         this->connections.remove (socket);
+         socket->deleteLater ();
+      });
+   }
+}
+
+//------------------------------------------------------------------------------
+// One request per connection - the response is queued once the request header
+// is complete, and is then sent in pieces.
+//
+void Rad_MockApplianceServer::readyRead ()
+{
+   QTcpSocket* socket = qobject_cast<QTcpSocket*> (this->sender ());
+   if (!socket || !this->connections.contains (socket)) return;
+
+   Connection& item = this->connections [socket];
+   item.request.append (socket->readAll ());
+   if (!item.output.isEmpty ()) return;
+   if (item.request.indexOf ("\r\n\r\n") < 0) return;
+
+   item.output = this->respond (item.request.left (item.request.indexOf ("\r\n")));
+   item.sent = 0;
+   if (!this->pieceTimer.isActive ()) this->pieceTimer.start ();
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_MockApplianceServer::sendPieces ()
+{
+   QList<QTcpSocket*> finished;
+   bool isBusy = false;
+
+   QHash<QTcpSocket*, Connection>::iterator it;
+   for (it = this->connections.begin (); it != this->connections.end (); ++it) {
+      Connection& item = it.value ();
+      if (item.output.isEmpty () || (item.sent >= item.output.size ())) continue;
+
+      const int size = MIN (this->pieceSize, item.output.size () - item.sent);
+      it.key ()->write (item.output.constData () + item.sent, size);
+      item.sent += size;
+
+      if (item.sent >= item.output.size ()) {
+         finished.append (it.key ());
+      } else {
+         isBusy = true;
+      }
+   }
+
+   // Disconnecting may remove the connection, so not done within the loop.
+   //
+   for (int j = 0; j < finished.count (); j++) {
+      finished.at (j)->disconnectFromHost ();
+   }
+
+   if (!isBusy) this->pieceTimer.stop ();
+}
+
+//------------------------------------------------------------------------------
+//
+static QByteArray httpResponse (const QByteArray& status, const QByteArray& contentType,
+                                const QByteArray& body)
+{
+   return "HTTP/1.1 " + status + "\r\n" +
+          "Content-Type: " + contentType + "\r\n" +
+          "Content-Length: " + QByteArray::number (body.size ()) + "\r\n" +
+          "Connection: close\r\n\r\n" + body;
+}
+
+//------------------------------------------------------------------------------
+//
+QByteArray Rad_MockApplianceServer::respond (const QByteArray& requestLine) const
+{
+   const QList<QByteArray> parts = requestLine.split (' ');
+   if ((parts.count () < 2) || (parts.at (0) != "GET")) {
+      return httpResponse ("400 Bad Request", "text/plain", "GET only\n");
+   }
+
+   const QUrl target (QString ("http://127.0.0.1") + QString::fromLatin1 (parts.at (1)));
+   const QUrlQuery query (target);
+   const QString path = target.path ();
+
+   if (path == "/retrieval/bpl/getMatchingPVs") {
+      QJsonArray names;
+      for (int j = 1; j <= this->numberPVs; j++) {
+         names.append (Rad_MockArchiveSource::mockPvName (j));
+      }
+      return httpResponse ("200 OK", "application/json", QJsonDocument (names).toJson ());
+   }
+
+   if (path == "/retrieval/data/getData.raw") {
+      if (!this->savedResponse.isEmpty ()) {
+         QFile file (this->savedResponse);
+         if (!file.open (QIODevice::ReadOnly)) {
+            return httpResponse ("500 Internal Server Error", "text/plain", "cannot read saved response\n");
+         }
+         return httpResponse ("200 OK", "application/x-protobuf", file.readAll ());
+      }
+
+      const QString pvName = query.queryItemValue ("pv", QUrl::FullyDecoded);
+      const QString from = query.queryItemValue ("from", QUrl::FullyDecoded);
+      const QString to = query.queryItemValue ("to", QUrl::FullyDecoded);
+      return this->getData (pvName, from, to);
+   }
+
+   return httpResponse ("404 Not Found", "text/plain", "no such resource\n");
+}
+
+//------------------------------------------------------------------------------
+// Samples are on the period grid for raw requests, or on the bin grid for
+// operator requests, e.g. linear_60(MOCK:PV0001).
+//
+QByteArray Rad_MockApplianceServer::getData (const QString& requestName,
+                                             const QString& from, const QString& to) const
+{
+   static const QRegularExpression operatorPattern ("^[a-zA-Z]+_([0-9]+)\\((.*)\\)$");
+
+   QString pvName = requestName;
+   qint64 step = this->periodMSecs;
+   const QRegularExpressionMatch match = operatorPattern.match (requestName);
+   if (match.hasMatch ()) {
+      step = MAX ((qint64) 1, match.captured (1).toLongLong () * 1000);
+      pvName = match.captured (2);
+   }
+
+   bool okay = false;
+   for (int j = 1; j <= this->numberPVs; j++) {
+      if (Rad_MockArchiveSource::mockPvName (j) == pvName) okay = true;
+   }
+   if (!okay) {
+      return httpResponse ("404 Not Found", "text/plain", "no such PV\n");
+   }
+
+   QDateTime startTime = QDateTime::fromString (from, isoFormat);
+   QDateTime endTime = QDateTime::fromString (to, isoFormat);
+   startTime.setTimeSpec (Qt::UTC);
+   endTime.setTimeSpec (Qt::UTC);
+   if (!startTime.isValid () || !endTime.isValid ()) {
+      return httpResponse ("400 Bad Request", "text/plain", "invalid from/to time\n");
+   }
+
+   const int type = (this->numberElements > 1) ? Rad_ApplianceDecoder::waveformDouble
+                                                : Rad_ApplianceDecoder::scalarDouble;
+
+   // Distinct values per array element, as per the mock archiver.
+   //
+   QVector<int> pvHash (this->numberElements);
+   for (int e = 0; e < this->numberElements; e++) {
+      pvHash [e] = (int) ((qHash (pvName) + 31 * e) & 0x7fffffff);
+   }
+
+   const qint64 t0 = startTime.toMSecsSinceEpoch ();
+   const qint64 t1 = endTime.toMSecsSinceEpoch ();
+
+   QByteArray body;
+   QDate chunkDate;
+   qint64 yearStart = 0;
+
+   // Grid aligned - start with last sample at or before start time.
+   //
+   for (qint64 t = (t0 / step) * step; t <= t1; t += step) {
+      const QDate date = QDateTime::fromMSecsSinceEpoch (t, Qt::UTC).date ();
+      if (date != chunkDate) {
+         if (!body.isEmpty ()) body.append ('\n');
+         body.append (Rad_ApplianceEncoder::line (Rad_ApplianceEncoder::header (type, requestName, date.year ())));
+         chunkDate = date;
+         yearStart = startOfYear (date.year ());
+      }
+
+      const qint64 offset = t - yearStart;
+      QByteArray message = Rad_ApplianceEncoder::sample ((quint32) (offset / 1000),
+                                                         (quint32) ((offset % 1000) * 1000000));
+      if (type == Rad_ApplianceDecoder::scalarDouble) {
+         Rad_ApplianceEncoder::putKey (message, 3, 1);
+         Rad_ApplianceEncoder::putDouble (message, Rad_MockArchiveSource::mockValue (pvHash [0], t));
+      } else {
+         QByteArray packed;
+         for (int e = 0; e < this->numberElements; e++) {
+            Rad_ApplianceEncoder::putDouble (packed, Rad_MockArchiveSource::mockValue (pvHash [e], t));
+         }
+         Rad_ApplianceEncoder::putBytes (message, 3, packed);
+      }
+      body.append (Rad_ApplianceEncoder::line (message));
+   }
+
+   return httpResponse ("200 OK", "application/x-protobuf", body);
+}
+
+
+//==============================================================================
+// Rad_ApplianceDecoderCheck
+//==============================================================================
+//
+struct Expected {
+   qint64 time;      // epoch nano seconds
+   double value;
+   int severity;
+   int status;
+};
+
+typedef QList<Expected> ExpectedList;
+
+static int failures = 0;
+
+//------------------------------------------------------------------------------
+//
+static void fail (const QString& description)
+{
+   failures++;
+   std::cerr << colour::red << "decoder check failed: "
+             << description.toLatin1 ().data ()
+             << colour::reset << std::endl;
+}
+
+//------------------------------------------------------------------------------
+//
+static Expected expected (const int year, const qint64 secondsIntoYear, const qint64 nanoSecs,
+                          const double value, const int severity = 0, const int status = 0)
+{
+   Expected result;
+   result.time = startOfYear (year) * 1000000 + secondsIntoYear * nanoSecsPerSec + nanoSecs;
+   result.value = value;
+   result.severity = severity;
+   result.status = status;
+   return result;
+}
+
+//------------------------------------------------------------------------------
+// Values must match exactly, or both be NaN.
+//
+static bool isSameValue (const double a, const double b)
+{
+   if (qIsNaN (a) || qIsNaN (b)) return qIsNaN (a) && qIsNaN (b);
+   return memcmp (&a, &b, sizeof (a)) == 0;
+}
+
+//------------------------------------------------------------------------------
+// The stream is decoded whole, and then in pieces of every smaller size, so
+// that each line, escape sequence and varint is split across reads.
+//
+static void checkStream (const QString& description, const QByteArray& stream,
+                         const unsigned int element, const ExpectedList& expect)
+{
+   for (int piece = stream.size (); piece >= 1; piece--) {
+      const QString what = QString ("%1, %2 byte pieces").arg (description).arg (piece);
+
+      Rad_ApplianceDecoder decoder (element);
+      QCaDataPointList points;
+      bool okay = true;
+      for (int pos = 0; pos < stream.size (); pos += piece) {
+         okay = decoder.decode (stream.mid (pos, piece), points) && okay;
+      }
+
+      if (!okay || !decoder.isComplete ()) {
+         fail (what + ": stream rejected");
+         return;
+      }
+
+      if (points.count () != expect.count ()) {
+         fail (QString ("%1: %2 points, expected %3").arg (what)
+               .arg (points.count ()).arg (expect.count ()));
+         return;
+      }
+
+      for (int j = 0; j < expect.count (); j++) {
+         const QCaDataPoint point = points.value (j);
+         const Expected& e = expect.at (j);
+         const qint64 time = Rad_BinaryWriter::toEpochNanoSeconds (point.datetime);
+
+         if ((time != e.time) || !isSameValue (point.value, e.value) ||
+             ((int) point.alarm.getSeverity () != e.severity) ||
+             ((int) point.alarm.getStatus () != e.status)) {
+            fail (QString ("%1: point %2 is %3 %4 %5/%6, expected %7 %8 %9/%10")
+                  .arg (what).arg (j)
+                  .arg (time).arg (point.value, 0, 'g', 17)
+                  .arg (point.alarm.getSeverity ()).arg (point.alarm.getStatus ())
+                  .arg (e.time).arg (e.value, 0, 'g', 17)
+                  .arg (e.severity).arg (e.status));
+            return;
+         }
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+// Multi-element mode must agree, element by element, with single element mode.
+// As per checkStream, the stream is also decoded in pieces.
+//
+static void checkElements (const QString& description, const QByteArray& stream,
+                           const unsigned int first, const int number)
+{
+   for (int piece = stream.size (); piece >= 1; piece--) {
+      const QString what = QString ("%1, elements %2 to %3, %4 byte pieces")
+            .arg (description).arg (first).arg (first + number - 1).arg (piece);
+
+      Rad_ApplianceDecoder decoder (first, number);
+      Rad_Waveform waveform (number);
+      bool okay = true;
+      for (int pos = 0; pos < stream.size (); pos += piece) {
+         okay = decoder.decode (stream.mid (pos, piece), waveform) && okay;
+      }
+
+      if (!okay || !decoder.isComplete ()) {
+         fail (what + ": stream rejected");
+         return;
+      }
+
+      for (int e = 0; e < number; e++) {
+         Rad_ApplianceDecoder single (first + e);
+         QCaDataPointList points;
+         single.decode (stream, points);
+
+         const Rad_PointStore decoded = waveform.elementPoints (e);
+         if (decoded.count () != points.count ()) {
+            fail (QString ("%1: element %2 has %3 points, expected %4").arg (what)
+                  .arg (first + e).arg (decoded.count ()).arg (points.count ()));
+            return;
+         }
+
+         for (int j = 0; j < points.count (); j++) {
+            const QCaDataPoint point = points.value (j);
+            if ((decoded.time [j] != Rad_BinaryWriter::toEpochNanoSeconds (point.datetime)) ||
+                !isSameValue (decoded.value [j], point.value) ||
+                (decoded.severity [j] != point.alarm.getSeverity ()) ||
+                (decoded.status [j] != point.alarm.getStatus ())) {
+               fail (QString ("%1: element %2 point %3 is %4, expected %5")
+                     .arg (what).arg (first + e).arg (j)
+                     .arg (decoded.value [j], 0, 'g', 17).arg (point.value, 0, 'g', 17));
+               return;
+            }
+         }
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+// The stream must be rejected, or (isTruncated) accepted but left incomplete.
+//
+static void checkMalformed (const QString& description, const QByteArray& stream,
+                            const bool isTruncated = false)
+{
+   Rad_ApplianceDecoder decoder;
+   QCaDataPointList points;
+   const bool okay = decoder.decode (stream, points);
+
+   if (isTruncated) {
+      if (!okay || decoder.isComplete ()) fail (description + ": truncation not detected");
+   } else {
+      if (okay) fail (description + ": not rejected");
+   }
+}
+
+//------------------------------------------------------------------------------
+//
+static quint64 zigZag (const qint32 value)
+{
+   return (quint64) (((quint32) value << 1) ^ (quint32) (value >> 31));
+}
+
+//------------------------------------------------------------------------------
+//
+static QByteArray scalarDoubleSample (const quint32 seconds, const double value)
+{
+   QByteArray message = Rad_ApplianceEncoder::sample (seconds, 0);
+   Rad_ApplianceEncoder::putKey (message, 3, 1);
+   Rad_ApplianceEncoder::putDouble (message, value);
+   return message;
+}
+
+//------------------------------------------------------------------------------
+//
+bool Rad_ApplianceDecoderCheck::run ()
+{
+   typedef Rad_ApplianceEncoder E;
+   typedef Rad_ApplianceDecoder D;
+
+   failures = 0;
+
+   // Escapes: seconds 10 and nano seconds 13 encode as newline and carriage
+   // return, severity 27 as the escape character itself, and the value bits
+   // include all three.
+   //
+   {
+      const quint64 bits = Q_UINT64_C (0x3FF01B0A0D1B0A0D);
+      double escaped;
+      memcpy (&escaped, &bits, sizeof (escaped));
+
+      QByteArray first = E::sample (10, 13, 27, 0);
+      E::putKey (first, 3, 1);
+      E::putFixed64 (first, bits);
+
+      QByteArray second = E::sample (3600, 500000000, 2, 7);
+      E::putKey (second, 3, 1);
+      E::putDouble (second, 2.5);
+
+      const QByteArray stream = E::line (E::header (D::scalarDouble, "CHECK:ESCAPE", 2024)) +
+                                E::line (first) + E::line (second);
+
+      ExpectedList expect;
+      expect << expected (2024, 10, 13, escaped, 27, 0)
+             << expected (2024, 3600, 500000000, 2.5, 2, 7);
+      checkStream ("escapes", stream, 0, expect);
+      checkElements ("escapes (scalar)", stream, 0, 3);
+   }
+
+   // Chunks, and a year change - 2024 is a leap year.
+   //
+   {
+      const quint32 lastSecond = 366 * 86400 - 1;
+      const QByteArray stream =
+         E::line (E::header (D::scalarDouble, "CHECK:YEAR", 2024)) +
+         E::line (scalarDoubleSample (lastSecond - 1, 1.0)) +
+         E::line (scalarDoubleSample (lastSecond, 2.0)) +
+         "\n" +
+         E::line (E::header (D::scalarDouble, "CHECK:YEAR", 2025)) +
+         E::line (scalarDoubleSample (1, 3.0)) +
+         "\n" +
+         E::line (E::header (D::scalarDouble, "CHECK:YEAR", 2025)) +
+         E::line (scalarDoubleSample (86400, 4.0));
+
+      ExpectedList expect;
+      expect << expected (2024, lastSecond - 1, 0, 1.0)
+             << expected (2024, lastSecond, 0, 2.0)
+             << expected (2025, 1, 0, 3.0)
+             << expected (2025, 86400, 0, 4.0);
+      checkStream ("year change", stream, 0, expect);
+
+      const qint64 endOf2024 = QDateTime (QDate (2024, 12, 31), QTime (23, 59, 59), Qt::UTC)
+                                 .toMSecsSinceEpoch () * 1000000;
+      if (expect.at (1).time != endOf2024) fail ("year change: 2024 seconds into year");
+   }
+
+   // Scalar types.
+   //
+   {
+      const QByteArray header = E::line (E::header (D::scalarShort, "CHECK:SHORT", 2025));
+      QByteArray message = E::sample (100, 0);
+      E::putKey (message, 3, 0);
+      E::putVarint (message, zigZag (-12));
+      checkStream ("scalar short", header + E::line (message), 0,
+                   ExpectedList () << expected (2025, 100, 0, -12.0));
+   }
+   {
+      const QByteArray header = E::line (E::header (D::scalarEnum, "CHECK:ENUM", 2025));
+      QByteArray message = E::sample (100, 0);
+      E::putKey (message, 3, 0);
+      E::putVarint (message, zigZag (3));
+      checkStream ("scalar enum", header + E::line (message), 0,
+                   ExpectedList () << expected (2025, 100, 0, 3.0));
+   }
+   {
+      const QByteArray header = E::line (E::header (D::scalarInt, "CHECK:INT", 2025));
+      QByteArray message = E::sample (100, 0);
+      E::putKey (message, 3, 5);
+      E::putFixed32 (message, (quint32) -42);
+      checkStream ("scalar int", header + E::line (message), 0,
+                   ExpectedList () << expected (2025, 100, 0, -42.0));
+   }
+   {
+      const QByteArray header = E::line (E::header (D::scalarFloat, "CHECK:FLOAT", 2025));
+      QByteArray message = E::sample (100, 0);
+      E::putKey (message, 3, 5);
+      E::putFloat (message, 0.15625f);
+      checkStream ("scalar float", header + E::line (message), 0,
+                   ExpectedList () << expected (2025, 100, 0, 0.15625));
+   }
+   {
+      const QByteArray header = E::line (E::header (D::scalarByte, "CHECK:BYTE", 2025));
+      QByteArray message = E::sample (100, 0);
+      E::putBytes (message, 3, QByteArray (1, (char) -10));
+      checkStream ("scalar byte", header + E::line (message), 0,
+                   ExpectedList () << expected (2025, 100, 0, -10.0));
+   }
+   {
+      const QByteArray header = E::line (E::header (D::scalarString, "CHECK:STRING", 2025));
+      QByteArray valid = E::sample (100, 0);
+      E::putBytes (valid, 3, "12.5");
+      QByteArray invalid = E::sample (101, 0);
+      E::putBytes (invalid, 3, "twelve");
+      checkStream ("scalar string", header + E::line (valid) + E::line (invalid), 0,
+                   ExpectedList () << expected (2025, 100, 0, 12.5)
+                                   << expected (2025, 101, 0, NAN));
+   }
+
+   // Waveforms - packed values, split over more than one field 3 record so
+   // that the element index carries over, and non-packed (repeated) values.
+   //
+   {
+      const QByteArray header = E::line (E::header (D::waveformDouble, "CHECK:WFDOUBLE", 2025));
+      QByteArray message = E::sample (200, 0);
+      QByteArray packed;
+      E::putDouble (packed, 1.5);
+      E::putDouble (packed, 2.5);
+      E::putBytes (message, 3, packed);
+      packed.clear ();
+      E::putDouble (packed, 3.5);
+      E::putDouble (packed, 4.5);
+      E::putBytes (message, 3, packed);
+      const QByteArray stream = header + E::line (message);
+
+      const double values [] = { 1.5, 2.5, 3.5, 4.5, NAN };
+      for (unsigned int element = 0; element < 5; element++) {
+         checkStream (QString ("packed double waveform, element %1").arg (element), stream, element,
+                      ExpectedList () << expected (2025, 200, 0, values [element]));
+      }
+      checkElements ("packed double waveform", stream, 0, 5);
+      checkElements ("packed double waveform", stream, 1, 2);
+   }
+   {
+      const QByteArray header = E::line (E::header (D::waveformDouble, "CHECK:WFDOUBLE", 2025));
+      QByteArray message = E::sample (200, 0);
+      E::putKey (message, 3, 1);
+      E::putDouble (message, -1.25);
+      E::putKey (message, 3, 1);
+      E::putDouble (message, 8.0);
+      checkStream ("non-packed double waveform", header + E::line (message), 1,
+                   ExpectedList () << expected (2025, 200, 0, 8.0));
+   }
+   {
+      const QByteArray header = E::line (E::header (D::waveformShort, "CHECK:WFSHORT", 2025));
+      const qint32 values [] = { 5, -7, 9 };
+
+      QByteArray packedMessage = E::sample (300, 0);
+      QByteArray packed;
+      for (int j = 0; j < 3; j++) E::putVarint (packed, zigZag (values [j]));
+      E::putBytes (packedMessage, 3, packed);
+
+      QByteArray repeatedMessage = E::sample (301, 0);
+      for (int j = 0; j < 3; j++) {
+         E::putKey (repeatedMessage, 3, 0);
+         E::putVarint (repeatedMessage, zigZag (values [j]));
+      }
+
+      const QByteArray stream = header + E::line (packedMessage) + E::line (repeatedMessage);
+      for (unsigned int element = 0; element < 3; element++) {
+         checkStream (QString ("short waveform, element %1").arg (element), stream, element,
+                      ExpectedList () << expected (2025, 300, 0, values [element])
+                                      << expected (2025, 301, 0, values [element]));
+      }
+      checkElements ("short waveform", stream, 0, 4);
+   }
+   {
+      const QByteArray header = E::line (E::header (D::waveformInt, "CHECK:WFINT", 2025));
+      QByteArray message = E::sample (400, 0);
+      QByteArray packed;
+      E::putFixed32 (packed, (quint32) -100);
+      E::putFixed32 (packed, 200);
+      E::putBytes (message, 3, packed);
+      checkStream ("packed int waveform", header + E::line (message), 0,
+                   ExpectedList () << expected (2025, 400, 0, -100.0));
+   }
+   {
+      const QByteArray header = E::line (E::header (D::waveformFloat, "CHECK:WFFLOAT", 2025));
+      QByteArray message = E::sample (500, 0);
+      E::putKey (message, 3, 5);
+      E::putFloat (message, 0.25f);
+      E::putKey (message, 3, 5);
+      E::putFloat (message, 0.75f);
+      checkStream ("non-packed float waveform", header + E::line (message), 1,
+                   ExpectedList () << expected (2025, 500, 0, 0.75));
+      checkElements ("non-packed float waveform", header + E::line (message), 0, 2);
+   }
+   {
+      const QByteArray header = E::line (E::header (D::waveformByte, "CHECK:WFBYTE", 2025));
+      QByteArray message = E::sample (600, 0);
+      E::putBytes (message, 3, QByteArray ("\x01\xFE", 2));
+      E::putBytes (message, 3, QByteArray ("\x03", 1));
+      const QByteArray stream = header + E::line (message);
+      checkStream ("byte waveform, element 1", stream, 1,
+                   ExpectedList () << expected (2025, 600, 0, -2.0));
+      checkStream ("byte waveform, element 2", stream, 2,
+                   ExpectedList () << expected (2025, 600, 0, 3.0));
+      checkElements ("byte waveform", stream, 1, 3);
+   }
+
+   // Malformed streams.
+   //
+   {
+      const QByteArray header = E::line (E::header (D::scalarDouble, "CHECK:BAD", 2025));
+      const QByteArray valid = E::line (scalarDoubleSample (1, 1.0));
+
+      checkMalformed ("invalid escape", header + QByteArray ("\x08\x1B\x05\n", 4));
+      checkMalformed ("truncated varint", header + QByteArray ("\x08\x80\n", 3));
+      checkMalformed ("truncated double", header + QByteArray ("\x08\x01\x19\x00\x00\n", 6));
+      checkMalformed ("overlong length", header + QByteArray ("\x1A\x7F\x01\n", 4));
+      checkMalformed ("unsupported type", E::line (E::header (14, "CHECK:BAD", 2025)) + valid);
+      checkMalformed ("missing year", E::line (QByteArray ("\x08\x06", 2)) + valid);
+      checkMalformed ("incomplete last line", header + valid + valid.left (valid.size () - 1), true);
+   }
+
+   return failures == 0;
+}
+
+// end
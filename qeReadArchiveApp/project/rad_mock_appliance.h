@@ -0,0 +1,140 @@
+/* rad_mock_appliance.h
+ *
+ * This file is part of the EPICS QT Framework, initially developed at the
+ * Australian Synchrotron.
+ *
+ * Copyright (c) 2025 Australian Synchrotron
+ *
+ * The EPICS QT Framework is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The EPICS QT Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author:
+ *    Andrew Starritt
+ * Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#ifndef RAD_MOCK_APPLIANCE_H
+#define RAD_MOCK_APPLIANCE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+class QTcpServer;
+class QTcpSocket;
+
+// Encoder of the Archive Appliance raw (protocol buffer) format - the inverse
+// of Rad_ApplianceDecoder, used by the stand-in appliance and decoder checks.
+//
+class Rad_ApplianceEncoder {
+public:
+   static void putVarint (QByteArray& message, const quint64 value);
+   static void putKey (QByteArray& message, const int field, const int wireType);
+   static void putFixed32 (QByteArray& message, const quint32 value);
+   static void putFixed64 (QByteArray& message, const quint64 value);
+   static void putBytes (QByteArray& message, const int field, const QByteArray& bytes);
+   static void putFloat (QByteArray& message, const float value);
+   static void putDouble (QByteArray& message, const double value);
+
+   // PayloadInfo message, i.e. a chunk header.
+   //
+   static QByteArray header (const int type, const QString& pvName, const int year);
+
+   // Sample message time and alarm fields - the caller appends the value
+   // field(s), i.e. field 3.
+   //
+   static QByteArray sample (const quint32 secondsIntoYear, const quint32 nanoSecs,
+                             const int severity = 0, const int status = 0);
+
+   // Escapes a message, and adds the line terminator.
+   //
+   static QByteArray line (const QByteArray& message);
+};
+
+
+// A local, in-process, stand-in Archive Appliance for the qerad benchmark.
+// Serves the retrieval URLs used by Rad_ApplianceArchiveSource over HTTP on
+// the loopback interface:
+//
+//    /retrieval/bpl/getMatchingPVs    MOCK:PV0001 to MOCK:PVnnnn
+//    /retrieval/data/getData.raw      raw (protocol buffer) data
+//
+// Data is as per Rad_MockArchiveSource, i.e. samples on a fixed period grid,
+// starting from the last sample at or before the start time, in chunks of one
+// UTC day. PVs are scalar doubles or, with more than one element, waveform
+// doubles whose element values are as per the mock archiver elements. Operator requests, e.g. linear_60(MOCK:PV0001), return one sample
+// per bin. Alternatively, a saved getData.raw response may be served for all
+// data requests.
+//
+// Responses are written in small pieces, at intervals, so that lines are
+// split across reads by the client, as per a real transfer.
+//
+class Rad_MockApplianceServer : public QObject {
+Q_OBJECT
+public:
+   explicit Rad_MockApplianceServer (const int numberPVs,
+                                     const double samplePeriod,   // seconds
+                                     const int numberElements,    // 1 for scalar
+                                     const int pieceSize,         // bytes
+                                     const int pieceInterval,     // mSec
+                                     const QString& savedResponse = QString (),
+                                     QObject* parent = NULL);
+   ~Rad_MockApplianceServer ();
+
+   bool listen ();
+
+   // The retrieval URL, e.g. http://127.0.0.1:40123/retrieval
+   //
+   QString url () const;
+
+private:
+   QByteArray respond (const QByteArray& requestLine) const;
+   QByteArray getData (const QString& requestName, const QString& from, const QString& to) const;
+
+   const int numberPVs;
+   const qint64 periodMSecs;
+   const int numberElements;
+   const int pieceSize;
+   const QString savedResponse;
+   QTcpServer* server;
+   QTimer pieceTimer;
+
+   struct Connection {
+      QByteArray request;
+      QByteArray output;
+      int sent;
+   };
+   QHash<QTcpSocket*, Connection> connections;
+
+private slots:
+   void newConnection ();
+   void readyRead ();
+   void sendPieces ();
+};
+
+
+// Checks of Rad_ApplianceDecoder against streams of known content, i.e.
+// escapes, lines split across reads, chunks and year changes, scalar and
+// waveform (packed and non-packed) values, and malformed streams.
+//
+class Rad_ApplianceDecoderCheck {
+public:
+   // Returns true if all checks pass - failures are reported to stderr.
+   //
+   static bool run ();
+};
+
+#endif  // RAD_MOCK_APPLIANCE_H
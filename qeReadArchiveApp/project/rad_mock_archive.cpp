@@ -0,0 +1,143 @@
+/*  rad_mock_archive.cpp
+ *
+ *  Copyright (c) 2025 Australian Synchrotron
+ *
+ *  The EPICS QT Framework is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The EPICS QT Framework is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Author:
+ *    Andrew Starritt
+ *  Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#include "rad_mock_archive.h"
+
+#include <math.h>
+#include <QDateTime>
+#include <QDebug>
+#include <QTimer>
+#include <QECommon.h>
+
+#define DEBUG qDebug () << "rad_mock_archive" << __LINE__ << __FUNCTION__ << "  "
+
+//------------------------------------------------------------------------------
+//
+Rad_MockArchiveSource::Rad_MockArchiveSource (const int numberPVsIn,
+                                              const double samplePeriod,
+                                              const int latencyIn,
+                                              const int readyDelayIn,
+                                              QObject* parent) :
+   Rad_ArchiveSource (parent),
+   numberPVs (numberPVsIn),
+   periodMSecs (MAX ((qint64) 1, (qint64) (samplePeriod * 1000.0 + 0.5))),
+   latency (MAX (0, latencyIn)),
+   readyDelay (MAX (0, readyDelayIn))
+{
+   this->sinceCreated.start ();
+
+   // Emulate the archiver interface becoming ready.
+   //
+   QTimer::singleShot (this->readyDelay, this, SIGNAL (statusChanged ()));
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_MockArchiveSource::~Rad_MockArchiveSource () { }
+
+//------------------------------------------------------------------------------
+// static
+QString Rad_MockArchiveSource::mockPvName (const int index)
+{
+   return QString ("MOCK:PV%1").arg (index, 4, 10, QChar ('0'));
+}
+
+//------------------------------------------------------------------------------
+// static
+double Rad_MockArchiveSource::mockValue (const int pvHash, const qint64 msecs)
+{
+   const double t = (double) msecs / 1000.0;
+   const double phase = (double) (pvHash % 360) * M_PI / 180.0;
+   return 100.0 * sin (t / 600.0 + phase) + (double) (msecs % 997) / 997.0;
+}
+
+//------------------------------------------------------------------------------
+//
+bool Rad_MockArchiveSource::isReady () const
+{
+   return this->sinceCreated.elapsed () >= this->readyDelay;
+}
+
+//------------------------------------------------------------------------------
+//
+QStringList Rad_MockArchiveSource::getAllPVs () const
+{
+   QStringList result;
+   for (int j = 1; j <= this->numberPVs; j++) {
+      result.append (Rad_MockArchiveSource::mockPvName (j));
+   }
+   return result;
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_MockArchiveSource::readArchive (QObject* userData, const QString& pvName,
+                                         const QCaDateTime& startTime, const QCaDateTime& endTime,
+                                         const int count, const QEArchiveInterface::How how,
+                                         const unsigned int element)
+{
+   QCaDataPointList data;
+   const bool okay = this->getAllPVs ().contains (pvName);
+
+   // Distinct values per array element, at the same times.
+   //
+   const int pvHash = (int) ((qHash (pvName) + 31 * element) & 0x7fffffff);
+
+   const qint64 t0 = startTime.toMSecsSinceEpoch ();
+   const qint64 t1 = endTime.toMSecsSinceEpoch ();
+
+   if (okay && (count > 0) && (t1 >= t0)) {
+      QCaDataPoint point;
+      point.alarm = QCaAlarmInfo (0, 0);
+
+      if (how == QEArchiveInterface::Raw) {
+         // Grid aligned - start with last sample at or before start time.
+         //
+         qint64 t = (t0 / this->periodMSecs) * this->periodMSecs;
+         while ((t <= t1) && (data.count () < count)) {
+            point.datetime = QDateTime::fromMSecsSinceEpoch (t, Qt::UTC);
+            point.value = Rad_MockArchiveSource::mockValue (pvHash, t);
+            data.append (point);
+            t += this->periodMSecs;
+         }
+      } else {
+         const double step = (count > 1) ? (double) (t1 - t0) / (double) (count - 1) : 0.0;
+         for (int j = 0; j < count; j++) {
+            const qint64 t = t0 + (qint64) (j * step);
+            point.datetime = QDateTime::fromMSecsSinceEpoch (t, Qt::UTC);
+            point.value = Rad_MockArchiveSource::mockValue (pvHash, t);
+            data.append (point);
+         }
+      }
+   }
+
+   const QString supplementary = okay ? QString ("") : QString ("mock: no such PV");
+
+   // Always deliver asynchronously, as per a real archiver.
+   //
+   QTimer::singleShot (this->latency, this, [=] () {
+      emit this->setArchiveData (userData, okay, data, pvName, supplementary);
+   });
+}
+
+// end
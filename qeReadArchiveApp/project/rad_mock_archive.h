@@ -0,0 +1,72 @@
+/* rad_mock_archive.h
+ *
+ * This file is part of the EPICS QT Framework, initially developed at the
+ * Australian Synchrotron.
+ *
+ * Copyright (c) 2025 Australian Synchrotron
+ *
+ * The EPICS QT Framework is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The EPICS QT Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author:
+ *    Andrew Starritt
+ * Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#ifndef RAD_MOCK_ARCHIVE_H
+#define RAD_MOCK_ARCHIVE_H
+
+#include <QElapsedTimer>
+#include "rad_archive_source.h"
+
+// A local, in-process, stand-in archiver used by the qerad benchmark.
+// It serves deterministic synthetic data for PVs named MOCK:PV0001 etc.
+//
+// Raw requests return samples on a fixed period grid, starting from the
+// last sample at or before the request start time, limited by the request
+// count - so qerad pages through the time range as per a real archiver.
+// Other requests return count points evenly spread over the time range.
+//
+class Rad_MockArchiveSource : public Rad_ArchiveSource {
+Q_OBJECT
+public:
+   explicit Rad_MockArchiveSource (const int numberPVs,
+                                   const double samplePeriod,   // seconds
+                                   const int latency,           // mSec
+                                   const int readyDelay,        // mSec
+                                   QObject* parent = NULL);
+   ~Rad_MockArchiveSource ();
+
+   bool isReady () const;
+   QStringList getAllPVs () const;
+   void readArchive (QObject* userData, const QString& pvName,
+                     const QCaDateTime& startTime, const QCaDateTime& endTime,
+                     const int count, const QEArchiveInterface::How how,
+                     const unsigned int element);
+
+   static QString mockPvName (const int index);   // 1 to N
+
+   // Deterministic synthetic value for given PV and time.
+   //
+   static double mockValue (const int pvHash, const qint64 msecs);
+
+private:
+   const int numberPVs;
+   const qint64 periodMSecs;
+   const int latency;
+   const int readyDelay;
+   QElapsedTimer sinceCreated;
+};
+
+#endif  // RAD_MOCK_ARCHIVE_H
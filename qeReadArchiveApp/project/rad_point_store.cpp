@@ -0,0 +1,199 @@
+/*  rad_point_store.cpp
+ *
+ *  Copyright (c) 2025 Australian Synchrotron
+ *
+ *  The EPICS QT Framework is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The EPICS QT Framework is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Author:
+ *    Andrew Starritt
+ *  Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#include "rad_point_store.h"
+#include "rad_binary_writer.h"
+#include "rad_cache.h"
+
+#include <QDebug>
+#include <QCaAlarmInfo.h>
+
+#define DEBUG qDebug () << "rad_point_store" << __LINE__ << __FUNCTION__ << "  "
+
+//------------------------------------------------------------------------------
+//
+void Rad_PointStore::clear ()
+{
+   this->time.clear ();
+   this->value.clear ();
+   this->severity.clear ();
+   this->status.clear ();
+   this->isDisplayable.clear ();
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_PointStore::reserve (const int size)
+{
+   this->time.reserve (size);
+   this->value.reserve (size);
+   this->severity.reserve (size);
+   this->status.reserve (size);
+   this->isDisplayable.reserve (size);
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_PointStore::truncate (const int size)
+{
+   if (size >= this->count ()) return;
+
+   this->time.resize (size);
+   this->value.resize (size);
+   this->severity.resize (size);
+   this->status.resize (size);
+   this->isDisplayable.resize (size);
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_PointStore::append (const QCaDataPoint& point)
+{
+   this->time.append (Rad_BinaryWriter::toEpochNanoSeconds (point.datetime));
+   this->value.append (point.value);
+   this->severity.append ((quint16) point.alarm.getSeverity ());
+   this->status.append ((quint16) point.alarm.getStatus ());
+   this->isDisplayable.append (point.isDisplayable ());
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_PointStore::append (const qint64 timeIn, const double valueIn,
+                             const quint16 severityIn, const quint16 statusIn)
+{
+   this->time.append (timeIn);
+   this->value.append (valueIn);
+   this->severity.append (severityIn);
+   this->status.append (statusIn);
+   this->isDisplayable.append (Rad_PointStore::isDisplayableSeverity (severityIn));
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_PointStore::append (const QCaDataPointList& points, const int first)
+{
+   const int number = points.count ();
+   if (first >= number) return;
+
+   this->reserve (this->count () + number - first);
+   for (int j = first; j < number; j++) {
+      this->append (points.value (j));
+   }
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_PointStore::append (const Rad_PointStore& other, const int first)
+{
+   const int number = other.count ();
+   if (first >= number) return;
+
+   if ((first == 0) && (this->count () == 0)) {
+      // Take a (implicitly shared) reference to the other's arrays.
+      //
+      *this = other;
+      return;
+   }
+
+   this->time += other.time.mid (first);
+   this->value += other.value.mid (first);
+   this->severity += other.severity.mid (first);
+   this->status += other.status.mid (first);
+   this->isDisplayable += other.isDisplayable.mid (first);
+}
+
+//------------------------------------------------------------------------------
+//
+qint64 Rad_PointStore::memoryUsage () const
+{
+   return (qint64) this->time.capacity () * sizeof (qint64) +
+          (qint64) this->value.capacity () * sizeof (double) +
+          (qint64) this->severity.capacity () * sizeof (quint16) +
+          (qint64) this->status.capacity () * sizeof (quint16) +
+          (qint64) this->isDisplayable.capacity () * sizeof (bool) +
+          sizeof (Rad_PointStore);
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_PointStore::appendPoint (const Rad_PointStore& other, const int j)
+{
+   this->time.append (other.time [j]);
+   this->value.append (other.value [j]);
+   this->severity.append (other.severity [j]);
+   this->status.append (other.status [j]);
+   this->isDisplayable.append (other.isDisplayable [j]);
+}
+
+//------------------------------------------------------------------------------
+//
+int Rad_PointStore::firstAfter (const qint64 t) const
+{
+   const qint64* times = this->time.constData ();
+   int low = 0;
+   int high = this->time.count ();
+
+   while (low < high) {
+      const int mid = low + (high - low) / 2;
+      if (times [mid] <= t) {
+         low = mid + 1;
+      } else {
+         high = mid;
+      }
+   }
+   return low;
+}
+
+//------------------------------------------------------------------------------
+//
+QCaDataPoint Rad_PointStore::point (const int j) const
+{
+   QCaDataPoint result;
+   result.datetime = Rad_Cache::fromEpochNanoSeconds (this->time [j]);
+   result.value = this->value [j];
+   result.alarm = QCaAlarmInfo (this->status [j], this->severity [j]);
+   return result;
+}
+
+//------------------------------------------------------------------------------
+//
+QCaDataPointList Rad_PointStore::toList () const
+{
+   QCaDataPointList result;
+   const int number = this->count ();
+   for (int j = 0; j < number; j++) {
+      result.append (this->point (j));
+   }
+   return result;
+}
+
+//------------------------------------------------------------------------------
+// static
+Rad_PointStore Rad_PointStore::fromList (const QCaDataPointList& points)
+{
+   Rad_PointStore result;
+   result.append (points);
+   return result;
+}
+
+// end
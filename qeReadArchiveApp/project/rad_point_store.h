@@ -0,0 +1,91 @@
+/* rad_point_store.h
+ *
+ * This file is part of the EPICS QT Framework, initially developed at the
+ * Australian Synchrotron.
+ *
+ * Copyright (c) 2025 Australian Synchrotron
+ *
+ * The EPICS QT Framework is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The EPICS QT Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author:
+ *    Andrew Starritt
+ * Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#ifndef RAD_POINT_STORE_H
+#define RAD_POINT_STORE_H
+
+#include <QVector>
+#include <QCaDateTime.h>
+#include <QCaDataPoint.h>
+
+// A compact store of archive data points, in structure of arrays form.
+//
+// A QCaDataPointList holds each point as a separately allocated QCaDataPoint,
+// i.e. a QCaDateTime, a QCaAlarmInfo and the value. Here each point occupies
+// 21 bytes across five contiguous arrays, so that scans over times or values
+// touch only the array(s) of interest. Times are nanoseconds since
+// 1970-01-01 00:00:00 UTC. Severity and status are held as is, i.e. including
+// the archive specific severities, so conversion back is lossless.
+//
+// Convert to a QCaDataPointList only where a framework API requires one.
+//
+class Rad_PointStore {
+public:
+   QVector<qint64> time;
+   QVector<double> value;
+   QVector<quint16> severity;
+   QVector<quint16> status;
+   QVector<bool> isDisplayable;
+
+   int count () const { return this->time.count (); }
+   void clear ();
+   void reserve (const int size);
+   void truncate (const int size);
+
+   // Allocated size in bytes, i.e. as per the array capacities.
+   //
+   qint64 memoryUsage () const;
+
+   void append (const QCaDataPoint& point);
+   void append (const qint64 time, const double value,
+                const quint16 severity, const quint16 status);
+
+   // Appends points from first onwards.
+   //
+   void append (const QCaDataPointList& points, const int first = 0);
+   void append (const Rad_PointStore& other, const int first = 0);
+
+   // Appends the other's j-th point.
+   //
+   void appendPoint (const Rad_PointStore& other, const int j);
+
+   // Returns the index of the first point after the given time, or count ()
+   // if none. Points must be in time order.
+   //
+   int firstAfter (const qint64 time) const;
+
+   QCaDataPoint point (const int j) const;
+
+   // As per QCaDataPoint::isDisplayable, which is a function of the alarm
+   // severity only, i.e. no, minor or major alarm (EPICS severities 0 to 2).
+   // Archive specific severities, e.g. disconnected, are not displayable.
+   //
+   static bool isDisplayableSeverity (const quint16 severity) { return severity <= 2; }
+   QCaDataPointList toList () const;
+   static Rad_PointStore fromList (const QCaDataPointList& points);
+};
+
+#endif  // RAD_POINT_STORE_H
@@ -0,0 +1,207 @@
+/*  rad_reducer.cpp
+ *
+ *  Copyright (c) 2025 Australian Synchrotron
+ *
+ *  The EPICS QT Framework is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The EPICS QT Framework is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Author:
+ *    Andrew Starritt
+ *  Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#include "rad_reducer.h"
+#include "rad_binary_writer.h"
+#include "rad_cache.h"
+
+#include <math.h>
+#include <QDebug>
+#include <QECommon.h>
+
+#define DEBUG qDebug () << "rad_reducer" << __LINE__ << __FUNCTION__ << "  "
+
+//------------------------------------------------------------------------------
+// static
+qint64 Rad_Reducer::binStart (const qint64 time, const qint64 binWidth)
+{
+   qint64 q = time / binWidth;
+   if ((time % binWidth != 0) && (time < 0)) q--;
+   return q * binWidth;
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_Reducer::Rad_Reducer (const Modes modeIn, const qint64 binWidthIn,
+                          const qint64 startTime, const qint64 endTime) :
+   mode (modeIn),
+   binWidth (MAX (binWidthIn, (qint64) 1)),
+   firstBin (Rad_Reducer::binStart (startTime, MAX (binWidthIn, (qint64) 1)))
+{
+   const qint64 number = (endTime > this->firstBin)
+                       ? (endTime - this->firstBin + this->binWidth - 1) / this->binWidth
+                       : 0;
+
+   Bin empty;
+   empty.count = 0;
+   empty.mean = 0.0;
+   empty.m2 = 0.0;
+   empty.minimum = 0.0;
+   empty.maximum = 0.0;
+   empty.minimumTime = 0;
+   empty.maximumTime = 0;
+   empty.severity = 0;
+   empty.status = 0;
+
+   this->bins.fill (empty, (int) number);
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_Reducer::~Rad_Reducer () { }
+
+//------------------------------------------------------------------------------
+//
+void Rad_Reducer::addPoints (const QCaDataPointList& points, const int first,
+                             const qint64 from, const qint64 until)
+{
+   const int number = points.count ();
+   const int numberBins = this->bins.count ();
+   Bin* bin = this->bins.data ();
+
+   for (int j = MAX (first, 0); j < number; j++) {
+      const QCaDataPoint point = points.value (j);
+      const qint64 time = Rad_BinaryWriter::toEpochNanoSeconds (point.datetime);
+
+      if (time < from) continue;
+      if (time >= until) break;      // points are in time order
+      if (!point.isDisplayable ()) continue;
+
+      const qint64 k = (time - this->firstBin) / this->binWidth;
+      if ((k < 0) || (k >= numberBins)) continue;
+
+      Bin& b = bin [k];
+      const double value = point.value;
+      const quint16 severity = (quint16) point.alarm.getSeverity ();
+
+      b.count++;
+      const double delta = value - b.mean;
+      b.mean += delta / (double) b.count;
+      b.m2 += delta * (value - b.mean);
+
+      if ((b.count == 1) || (value < b.minimum)) {
+         b.minimum = value;
+         b.minimumTime = time;
+      }
+      if ((b.count == 1) || (value > b.maximum)) {
+         b.maximum = value;
+         b.maximumTime = time;
+      }
+      if ((b.count == 1) || (severity > b.severity)) {
+         b.severity = severity;
+         b.status = (quint16) point.alarm.getStatus ();
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+//
+QCaDataPointList Rad_Reducer::result () const
+{
+   QCaDataPointList result;
+   const int numberBins = this->bins.count ();
+
+   for (int k = 0; k < numberBins; k++) {
+      const Bin& b = this->bins [k];
+      const qint64 start = this->firstBin + k * this->binWidth;
+      QCaDataPoint point;
+
+      if (b.count == 0 && this->mode != countMode) continue;
+
+      point.alarm = QCaAlarmInfo (b.status, b.severity);
+      point.datetime = Rad_Cache::fromEpochNanoSeconds (start);
+
+      switch (this->mode) {
+         case meanMode:
+            point.value = b.mean;
+            break;
+
+         case minMode:
+            point.value = b.minimum;
+            break;
+
+         case maxMode:
+            point.value = b.maximum;
+            break;
+
+         case countMode:
+            point.value = (double) b.count;
+            point.alarm = QCaAlarmInfo (0, 0);
+            break;
+
+         case stdMode:
+            point.value = sqrt (b.m2 / (double) b.count);
+            break;
+
+         case minMaxMode: {
+            QCaDataPoint other = point;
+            const bool minimumFirst = (b.minimumTime <= b.maximumTime);
+
+            point.value = minimumFirst ? b.minimum : b.maximum;
+            point.datetime = Rad_Cache::fromEpochNanoSeconds (minimumFirst ? b.minimumTime : b.maximumTime);
+            result.append (point);
+
+            if (b.minimumTime == b.maximumTime) continue;   // only one distinct point
+
+            other.value = minimumFirst ? b.maximum : b.minimum;
+            other.datetime = Rad_Cache::fromEpochNanoSeconds (minimumFirst ? b.maximumTime : b.minimumTime);
+            point = other;
+            break;
+         }
+      }
+
+      result.append (point);
+   }
+
+   return result;
+}
+
+//------------------------------------------------------------------------------
+// static
+bool Rad_Reducer::modeFromString (const QString& image, Modes& mode)
+{
+   if (image == "mean")   { mode = meanMode;   return true; }
+   if (image == "min")    { mode = minMode;    return true; }
+   if (image == "max")    { mode = maxMode;    return true; }
+   if (image == "minmax") { mode = minMaxMode; return true; }
+   if (image == "count")  { mode = countMode;  return true; }
+   if (image == "std")    { mode = stdMode;    return true; }
+   return false;
+}
+
+//------------------------------------------------------------------------------
+// static
+QString Rad_Reducer::serverOperator (const Modes mode)
+{
+   switch (mode) {
+      case meanMode:    return "mean";
+      case minMode:     return "min";
+      case maxMode:     return "max";
+      case countMode:   return "count";
+      case stdMode:     return "std";
+      case minMaxMode:  return "";      // no single operator
+   }
+   return "";
+}
+
+// end
@@ -0,0 +1,98 @@
+/* rad_reducer.h
+ *
+ * This file is part of the EPICS QT Framework, initially developed at the
+ * Australian Synchrotron.
+ *
+ * Copyright (c) 2025 Australian Synchrotron
+ *
+ * The EPICS QT Framework is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The EPICS QT Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author:
+ *    Andrew Starritt
+ * Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#ifndef RAD_REDUCER_H
+#define RAD_REDUCER_H
+
+#include <QString>
+#include <QVector>
+#include <QCaDataPoint.h>
+
+// Client side statistics/decimation of raw archive data into fixed width time
+// bins. Bins are aligned to multiples of the bin width since the epoch, as per
+// the Archive Appliance server side operators, e.g. mean_600.
+//
+// Pages are reduced as they arrive, in any order, in a single pass - so memory
+// is proportional to the number of bins, not the number of raw points.
+//
+class Rad_Reducer {
+public:
+   enum Modes {
+      meanMode,
+      minMode,
+      maxMode,
+      minMaxMode,    // the minimum and the maximum points, in time order
+      countMode,
+      stdMode        // population standard deviation
+   };
+
+   // Times are nano seconds since 1970-01-01 00:00:00 UTC.
+   //
+   explicit Rad_Reducer (const Modes mode, const qint64 binWidth,
+                         const qint64 startTime, const qint64 endTime);
+   ~Rad_Reducer ();
+
+   // Reduce the points, from index first, with times in [from, until).
+   // Points that are not displayable, e.g. archive disconnected, are ignored.
+   //
+   void addPoints (const QCaDataPointList& points, const int first,
+                   const qint64 from, const qint64 until);
+
+   // One point per non empty bin (count mode: one point per bin), two for
+   // minmax, time stamped at the bin start (minmax: actual sample times).
+   //
+   QCaDataPointList result () const;
+
+   static bool modeFromString (const QString& image, Modes& mode);
+
+   // The Archive Appliance operator name, or an empty string if none.
+   //
+   static QString serverOperator (const Modes mode);
+
+   // The start of the bin containing time.
+   //
+   static qint64 binStart (const qint64 time, const qint64 binWidth);
+
+private:
+   struct Bin {
+      qint64 count;
+      double mean;              // Welford running mean
+      double m2;                // and sum of squares of differences
+      double minimum;
+      double maximum;
+      qint64 minimumTime;
+      qint64 maximumTime;
+      quint16 severity;         // most severe alarm in the bin
+      quint16 status;
+   };
+
+   const Modes mode;
+   const qint64 binWidth;
+   const qint64 firstBin;      // start time of bins [0]
+   QVector<Bin> bins;
+};
+
+#endif  // RAD_REDUCER_H
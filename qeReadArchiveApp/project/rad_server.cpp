@@ -0,0 +1,608 @@
+/*  rad_server.cpp
+ *
+ *  Copyright (c) 2025 Australian Synchrotron
+ *
+ *  The EPICS QT Framework is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The EPICS QT Framework is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Author:
+ *    Andrew Starritt
+ *  Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#include "rad_server.h"
+#include "rad_archive_source.h"
+#include "rad_control.h"
+#include <iostream>
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTimer>
+
+#include <QECommon.h>
+
+#define DEBUG qDebug () << "rad_server" << __LINE__ << __FUNCTION__ << "  "
+
+static const int frameHeaderSize = 5;
+static const quint32 maxFrameSize = 64 * 1024 * 1024;
+static const qint64 chunkSize = 1024 * 1024;
+static const qint64 maxBytesToWrite = 4 * chunkSize;
+
+//------------------------------------------------------------------------------
+//
+static void putFrame (QLocalSocket* socket, const char type, const QByteArray& payload)
+{
+   QByteArray header;
+   QDataStream stream (&header, QIODevice::WriteOnly);
+   stream.setByteOrder (QDataStream::LittleEndian);
+   stream << (quint8) type << (quint32) payload.size ();
+
+   socket->write (header);
+   socket->write (payload);
+}
+
+//------------------------------------------------------------------------------
+// Removes the next complete frame from buffer. Returns false if there is no
+// complete frame as yet. An oversize frame is reported as type '?'.
+//
+static bool takeFrame (QByteArray& buffer, char& type, QByteArray& payload)
+{
+   if (buffer.size () < frameHeaderSize) return false;
+
+   QDataStream stream (buffer);
+   stream.setByteOrder (QDataStream::LittleEndian);
+   quint8 frameType;
+   quint32 size;
+   stream >> frameType >> size;
+
+   if (size > maxFrameSize) {
+      type = '?';
+      payload.clear ();
+      buffer.clear ();
+      return true;
+   }
+
+   if (buffer.size () < frameHeaderSize + (int) size) return false;
+
+   type = (char) frameType;
+   payload = buffer.mid (frameHeaderSize, (int) size);
+   buffer.remove (0, frameHeaderSize + (int) size);
+   return true;
+}
+
+//==============================================================================
+// Rad_Server
+//==============================================================================
+//
+Rad_Server::Rad_Server (Rad_ArchiveSource* source) : QObject (NULL)
+{
+   this->options = new QEOptions ();
+   this->server = NULL;
+   this->innerSource = source;
+   this->archiveSource = NULL;
+   this->numberRequests = 0;
+
+   // Start once the event loop is running.
+   //
+   QTimer::singleShot (0, this, SLOT (start ()));
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_Server::~Rad_Server ()
+{
+   delete this->options;
+}
+
+//------------------------------------------------------------------------------
+// static
+QString Rad_Server::defaultName ()
+{
+   QString user = QString::fromLocal8Bit (qgetenv ("USER"));
+   if (user.isEmpty ()) user = QString::fromLocal8Bit (qgetenv ("USERNAME"));
+   return QString ("qerad-%1").arg (user);
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Server::start ()
+{
+   QString name = this->options->getString ("serve", "");
+   if (name.isEmpty ()) name = Rad_Server::defaultName ();
+
+   int cacheSize = defaultCacheSize;
+   if (this->options->isSpecified ("serve-cache")) {
+      cacheSize = this->options->getInt ("serve-cache", -1);
+      if (cacheSize < 0) {
+         std::cerr << colour::red
+                   << "error: serve cache size must be at least 0 MB."
+                   << colour::reset << std::endl;
+         QCoreApplication::exit (1);
+         return;
+      }
+   }
+
+   // Refuse to displace a running server, but do remove a stale socket,
+   // e.g. left by a server that was killed.
+   //
+   QLocalSocket probe;
+   probe.connectToServer (name);
+   if (probe.waitForConnected (1000)) {
+      std::cerr << colour::red
+                << "error: a qerad server is already running as " << name.toLatin1 ().data ()
+                << colour::reset << std::endl;
+      QCoreApplication::exit (1);
+      return;
+   }
+   QLocalServer::removeServer (name);
+
+   this->server = new QLocalServer (this);
+   this->server->setSocketOptions (QLocalServer::UserAccessOption);
+   if (!this->server->listen (name)) {
+      std::cerr << colour::red
+                << "error: cannot listen as " << name.toLatin1 ().data () << ": "
+                << this->server->errorString ().toLatin1 ().data ()
+                << colour::reset << std::endl;
+      QCoreApplication::exit (1);
+      return;
+   }
+
+   QObject::connect (this->server, SIGNAL (newConnection ()),
+                     this,         SLOT   (newConnection ()));
+
+   // The one archive source for all requests - created up front so that the
+   // archiver interface is ready by the time of the first request.
+   //
+   if (!this->innerSource) {
+      this->innerSource = Rad_ArchiveSource::create (this->options, this);
+   }
+   this->archiveSource = new Rad_CachingArchiveSource (this->innerSource, cacheSize, this);
+
+   std::cout << "qerad server listening on "
+             << this->server->fullServerName ().toLatin1 ().data ()
+             << ", memory cache " << cacheSize << " MB" << std::endl;
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Server::newConnection ()
+{
+   while (this->server->hasPendingConnections ()) {
+      QLocalSocket* socket = this->server->nextPendingConnection ();
+      this->numberRequests++;
+
+      Rad_ServerSession* session = new Rad_ServerSession (socket, this->archiveSource,
+                                                          this->numberRequests, this);
+      QObject::connect (session, SIGNAL (finished ()),
+                        this,    SLOT   (requestFinished ()));
+   }
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Server::requestFinished ()
+{
+   QObject* session = this->sender ();
+   if (session) session->deleteLater ();
+
+   std::cout << this->archiveSource->statistics ().toLatin1 ().data () << std::endl;
+}
+
+//==============================================================================
+// Rad_ServerSession
+//==============================================================================
+//
+Rad_ServerSession::Rad_ServerSession (QLocalSocket* socketIn, Rad_ArchiveSource* source,
+                                      const int numberIn, QObject* parent) :
+   QObject (parent),
+   socket (socketIn),
+   archiveSource (source),
+   control (NULL),
+   number (numberIn),
+   status (-1),
+   isEnded (false)
+{
+   this->timer.start ();
+   this->socket->setParent (this);
+
+   QObject::connect (this->socket, SIGNAL (readyRead ()),
+                     this,         SLOT   (readyRead ()));
+   QObject::connect (this->socket, SIGNAL (bytesWritten (qint64)),
+                     this,         SLOT   (bytesWritten (qint64)));
+   QObject::connect (this->socket, SIGNAL (disconnected ()),
+                     this,         SLOT   (disconnected ()));
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_ServerSession::~Rad_ServerSession ()
+{
+   delete this->control;
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_ServerSession::message (const QString& text)
+{
+   putFrame (this->socket, 'M', text.toUtf8 ());
+}
+
+//------------------------------------------------------------------------------
+// The client's command line, less the program name. The output file is
+// redirected to the session's temporary directory.
+//
+bool Rad_ServerSession::startRequest (const QStringList& argumentsIn)
+{
+   QStringList arguments = argumentsIn;
+   int outputIndex = -1;
+
+   for (int j = 0; j < arguments.count (); j++) {
+      const QString argument = arguments.value (j);
+
+      if (argument.startsWith ("--serve") || argument.startsWith ("--client") ||
+          argument.startsWith ("--jobs") || argument.startsWith ("--follow") ||
+          argument.startsWith ("--poll") || argument.startsWith ("--help") ||
+          (argument == "-h"))
+      {
+         this->message (QString ("error: %1 not applicable to a server request")
+                        .arg (argument.section ('=', 0, 0)));
+         return false;
+      }
+
+      if (!argument.startsWith ("-") && (outputIndex < 0)) outputIndex = j;
+   }
+
+   if (outputIndex < 0) {
+      this->message ("error: missing output file");
+      return false;
+   }
+
+   if (!this->directory.isValid ()) {
+      this->message ("error: server cannot create a temporary directory");
+      return false;
+   }
+
+   const QString name = QFileInfo (arguments.value (outputIndex)).fileName ();
+   arguments [outputIndex] = this->directory.filePath (name);
+   arguments.prepend (QCoreApplication::arguments ().value (0));
+
+   std::cout << "\nrequest " << this->number << ": "
+             << argumentsIn.join (" ").toLatin1 ().data () << std::endl;
+
+   this->control = new Rad_Control (this->archiveSource, arguments);
+   QObject::connect (this->control, SIGNAL (finished (const int)),
+                     this,          SLOT   (controlFinished (const int)));
+   return true;
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_ServerSession::readyRead ()
+{
+   this->buffer.append (this->socket->readAll ());
+
+   // Only the one request per connection.
+   //
+   if (this->control || (this->status >= 0) || this->isEnded) return;
+
+   char type;
+   QByteArray payload;
+   if (!takeFrame (this->buffer, type, payload)) return;
+
+   if (type != 'R') {
+      this->message ("error: invalid request");
+      this->end (1);
+      return;
+   }
+
+   QStringList arguments;
+   QDataStream stream (payload);
+   stream >> arguments;
+
+   if (!this->startRequest (arguments)) {
+      this->end (1);
+   }
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_ServerSession::controlFinished (const int statusIn)
+{
+   this->status = statusIn;
+
+   // The control is still in the midst of emitting finished.
+   //
+   if (this->control) this->control->deleteLater ();
+   this->control = NULL;
+
+   std::cout << "request " << this->number << " complete, status " << this->status
+             << ", time " << QString::number (this->timer.nsecsElapsed () * 1.0e-9, 'f', 3).toLatin1 ().data ()
+             << " s" << std::endl;
+
+   // Client has gone away.
+   //
+   if (this->socket->state () != QLocalSocket::ConnectedState) {
+      emit this->finished ();
+      return;
+   }
+
+   // The output file name may have been qualified, e.g. by --compress.
+   //
+   const QFileInfoList files = QDir (this->directory.path ()).entryInfoList (QDir::Files);
+   if (!files.isEmpty ()) {
+      this->output.setFileName (files.value (0).absoluteFilePath ());
+      if (this->output.open (QIODevice::ReadOnly)) {
+         putFrame (this->socket, 'N', files.value (0).fileName ().toUtf8 ());
+         this->sendOutput ();
+         return;
+      }
+   }
+
+   this->end (this->status);
+}
+
+//------------------------------------------------------------------------------
+// Keep a bounded amount of data queued on the socket.
+//
+void Rad_ServerSession::sendOutput ()
+{
+   while (this->output.isOpen () && (this->socket->bytesToWrite () < maxBytesToWrite)) {
+      const QByteArray chunk = this->output.read (chunkSize);
+      if (chunk.isEmpty ()) {
+         this->output.close ();
+         this->end (this->status);
+         return;
+      }
+      putFrame (this->socket, 'F', chunk);
+   }
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_ServerSession::bytesWritten (qint64)
+{
+   if (this->output.isOpen ()) this->sendOutput ();
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_ServerSession::end (const int statusIn)
+{
+   if (this->isEnded) return;
+   this->isEnded = true;
+
+   putFrame (this->socket, 'E', QByteArray::number (statusIn));
+   this->socket->disconnectFromServer ();
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_ServerSession::disconnected ()
+{
+   // Let any running request complete - see controlFinished.
+   //
+   if (this->control) return;
+   emit this->finished ();
+}
+
+//==============================================================================
+// Rad_Client
+//==============================================================================
+//
+Rad_Client::Rad_Client () : QObject (NULL)
+{
+   this->options = new QEOptions ();
+   this->socket = NULL;
+   this->isEnded = false;
+
+   // Start once the event loop is running.
+   //
+   QTimer::singleShot (0, this, SLOT (start ()));
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_Client::~Rad_Client ()
+{
+   delete this->options;
+}
+
+//------------------------------------------------------------------------------
+// The command line less the program name and --client. Files named on the
+// command line are interpreted here, not by the server: PV files are read
+// and the PV names passed on, and other file names are made absolute.
+//
+bool Rad_Client::buildRequest (QStringList& arguments)
+{
+   const QStringList all = QCoreApplication::arguments ();
+   QStringList pvNames;
+
+   arguments.clear ();
+   for (int j = 1; j < all.count (); j++) {
+      QString argument = all.value (j);
+
+      if (argument.startsWith ("--client")) continue;
+
+      if (argument.startsWith ("--serve") || argument.startsWith ("--jobs") ||
+          argument.startsWith ("--follow") || argument.startsWith ("--poll"))
+      {
+         std::cerr << colour::red
+                   << "error: " << argument.section ('=', 0, 0).toLatin1 ().data ()
+                   << " not applicable with --client"
+                   << colour::reset << std::endl;
+         return false;
+      }
+
+      if (argument.startsWith ("--pv-file")) {
+         if (!Rad_Control::readPVFile (this->options->getString ("pv-file", ""), pvNames)) {
+            return false;
+         }
+         continue;
+      }
+
+      if (argument.startsWith ("--stats-json=") || argument.startsWith ("--cache-dir=")) {
+         const QString key = argument.section ('=', 0, 0);
+         const QString path = argument.section ('=', 1);
+         argument = QString ("%1=%2").arg (key).arg (QFileInfo (path).absoluteFilePath ());
+      }
+
+      if (!argument.startsWith ("-") && this->outputFile.isEmpty ()) {
+         this->outputFile = QFileInfo (argument).absoluteFilePath ();
+      }
+
+      arguments << argument;
+   }
+
+   arguments << pvNames;
+
+   if (this->outputFile.isEmpty ()) {
+      std::cerr << colour::red << "error: missing output file" << colour::reset << std::endl;
+      return false;
+   }
+   return true;
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Client::start ()
+{
+   QString name = this->options->getString ("client", "");
+   if (name.isEmpty ()) name = Rad_Server::defaultName ();
+
+   if (!this->buildRequest (this->arguments)) {
+      this->exit (1);
+      return;
+   }
+
+   this->socket = new QLocalSocket (this);
+   QObject::connect (this->socket, SIGNAL (connected ()),
+                     this,         SLOT   (connected ()));
+   QObject::connect (this->socket, SIGNAL (readyRead ()),
+                     this,         SLOT   (readyRead ()));
+   QObject::connect (this->socket, SIGNAL (disconnected ()),
+                     this,         SLOT   (disconnected ()));
+   QObject::connect (this->socket, SIGNAL (error (QLocalSocket::LocalSocketError)),
+                     this,         SLOT   (socketError ()));
+
+   this->socket->connectToServer (name);
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Client::connected ()
+{
+   QByteArray payload;
+   QDataStream stream (&payload, QIODevice::WriteOnly);
+   stream << this->arguments;
+   putFrame (this->socket, 'R', payload);
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Client::readyRead ()
+{
+   this->buffer.append (this->socket->readAll ());
+
+   char type;
+   QByteArray payload;
+   while (!this->isEnded && takeFrame (this->buffer, type, payload)) {
+      switch (type) {
+         case 'M':
+            std::cerr << colour::red << payload.constData () << colour::reset << std::endl;
+            break;
+
+         case 'N': {
+            // Written alongside the output file named on the command line.
+            //
+            const QString name = QFileInfo (QString::fromUtf8 (payload)).fileName ();
+            this->output.setFileName (QFileInfo (this->outputFile).absoluteDir ().filePath (name));
+            if (!this->output.open (QIODevice::WriteOnly | QIODevice::Truncate)) {
+               std::cerr << colour::red
+                         << "error: cannot open " << this->output.fileName ().toLatin1 ().data ()
+                         << colour::reset << std::endl;
+               this->exit (1);
+            }
+            break;
+         }
+
+         case 'F':
+            if (this->output.write (payload) != payload.size ()) {
+               std::cerr << colour::red
+                         << "error: write file " << this->output.fileName ().toLatin1 ().data ()
+                         << " failed" << colour::reset << std::endl;
+               this->exit (1);
+            }
+            break;
+
+         case 'E':
+            if (this->output.isOpen ()) {
+               this->output.close ();
+               std::cout << "Written " << this->output.fileName ().toLatin1 ().data () << std::endl;
+            }
+            this->exit (payload.toInt ());
+            break;
+
+         default:
+            std::cerr << colour::red << "error: invalid server response" << colour::reset << std::endl;
+            this->exit (1);
+            break;
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Client::disconnected ()
+{
+   if (this->isEnded) return;
+
+   // Process any trailing frames, e.g. the end frame.
+   //
+   this->readyRead ();
+   if (this->isEnded) return;
+
+   std::cerr << colour::red << "error: qerad server connection lost" << colour::reset << std::endl;
+   this->exit (1);
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Client::socketError ()
+{
+   if (this->isEnded) return;
+   if (this->socket->error () == QLocalSocket::PeerClosedError) return;   // see disconnected
+
+   std::cerr << colour::red
+             << "error: qerad server: " << this->socket->errorString ().toLatin1 ().data ()
+             << colour::reset << std::endl;
+   this->exit (1);
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Client::exit (const int status)
+{
+   if (this->isEnded) return;
+   this->isEnded = true;
+
+   if (this->output.isOpen ()) this->output.close ();
+   QCoreApplication::exit (status);
+}
+
+// end
@@ -0,0 +1,159 @@
+/* rad_server.h
+ *
+ * This file is part of the EPICS QT Framework, initially developed at the
+ * Australian Synchrotron.
+ *
+ * Copyright (c) 2025 Australian Synchrotron
+ *
+ * The EPICS QT Framework is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The EPICS QT Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author:
+ *    Andrew Starritt
+ * Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#ifndef RAD_SERVER_H
+#define RAD_SERVER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTemporaryDir>
+
+#include <QEOptions.h>
+
+class QLocalServer;
+class QLocalSocket;
+class Rad_ArchiveSource;
+class Rad_CachingArchiveSource;
+class Rad_Control;
+
+// Daemon mode, i.e. --serve. Keeps the one archiver interface, together with
+// an in-memory cache of recent archiver responses, and accepts extraction
+// requests from qerad --client over a local (Unix domain) socket.
+//
+// Each request is the client's command line, which is run as a Rad_Control,
+// as per a batch job, writing to a temporary file. The file is then streamed
+// back to the client, which writes it to the output file named on its own
+// command line.
+//
+// Messages on the socket are framed as a one byte type, a little endian
+// uint32 payload size and the payload:
+//
+//    R  client => server  request, a QDataStream serialised QStringList
+//    M  server => client  error message text (UTF-8)
+//    N  server => client  output file name, i.e. as qualified by --compress
+//    F  server => client  output file data, any number of frames
+//    E  server => client  end, the payload being the exit status as text
+//
+class Rad_Server : public QObject {
+Q_OBJECT
+public:
+   // When source is NULL, the QE framework archive access is used.
+   //
+   explicit Rad_Server (Rad_ArchiveSource* source = NULL);
+   ~Rad_Server ();
+
+   // The per user default server name.
+   //
+   static QString defaultName ();
+
+   static const int defaultCacheSize = 256;    // mega bytes
+
+private:
+   QEOptions* options;
+   QLocalServer* server;
+   Rad_ArchiveSource* innerSource;
+   Rad_CachingArchiveSource* archiveSource;
+   int numberRequests;
+
+private slots:
+   void start ();
+   void newConnection ();
+   void requestFinished ();
+};
+
+
+// One client connection of the --serve daemon.
+//
+class Rad_ServerSession : public QObject {
+Q_OBJECT
+public:
+   explicit Rad_ServerSession (QLocalSocket* socket, Rad_ArchiveSource* source,
+                               const int number, QObject* parent = NULL);
+   ~Rad_ServerSession ();
+
+signals:
+   void finished ();
+
+private:
+   bool startRequest (const QStringList& arguments);
+   void message (const QString& text);
+   void sendOutput ();
+   void end (const int status);
+
+   QLocalSocket* socket;
+   Rad_ArchiveSource* archiveSource;
+   Rad_Control* control;
+   const int number;
+   QByteArray buffer;            // received, not yet framed, data
+   QTemporaryDir directory;
+   QFile output;
+   int status;                   // -1 until the request is complete
+   bool isEnded;
+   QElapsedTimer timer;
+
+private slots:
+   void readyRead ();
+   void controlFinished (const int status);
+   void bytesWritten (qint64 bytes);
+   void disconnected ();
+};
+
+
+// Thin client mode, i.e. --client. Forwards the command line to the --serve
+// daemon, and writes the returned output to the output file. The exit status
+// is as per the request run by the server.
+//
+class Rad_Client : public QObject {
+Q_OBJECT
+public:
+   explicit Rad_Client ();
+   ~Rad_Client ();
+
+private:
+   bool buildRequest (QStringList& arguments);
+   void exit (const int status);
+
+   QEOptions* options;
+   QLocalSocket* socket;
+   QString outputFile;
+   QFile output;
+   QByteArray buffer;            // received, not yet framed, data
+   QStringList arguments;
+   bool isEnded;
+
+private slots:
+   void start ();
+   void connected ();
+   void readyRead ();
+   void disconnected ();
+   void socketError ();
+};
+
+#endif  // RAD_SERVER_H
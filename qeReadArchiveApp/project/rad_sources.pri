@@ -0,0 +1,68 @@
+# File: qeReadArchiveApp/project/rad_sources.pri
+#
+# This file is part of the EPICS QT Framework, initially developed at the
+# Australian Synchrotron.
+#
+# Copyright (c) 2025  Australian Synchrotron
+#
+# The EPICS QT Framework is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# The EPICS QT Framework is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with the EPICS QT Framework. If not, see <http://www.gnu.org/licenses/>.
+#
+# Author:
+#    Andrew Starritt
+# Contact details:
+#    andrew.starritt@synchrotron.org.au
+
+# Sources common to qerad and the qerad_bench benchmark, i.e. all but main.
+#
+HEADERS += \
+   ./rad_aligner.h \
+   ./rad_appliance_source.h \
+   ./rad_archive_source.h \
+   ./rad_binary_writer.h \
+   ./rad_cache.h \
+   ./rad_export.h \
+   ./rad_follow.h \
+   ./rad_gzip.h \
+   ./rad_jobs.h \
+   ./rad_point_store.h \
+   ./rad_reducer.h \
+   ./rad_server.h \
+   ./rad_control.h \
+   ./rad_statistics.h \
+   ./rad_text_formatter.h \
+   ./rad_waveform.h
+
+SOURCES += \
+   ./rad_aligner.cpp \
+   ./rad_appliance_source.cpp \
+   ./rad_archive_source.cpp \
+   ./rad_binary_writer.cpp \
+   ./rad_cache.cpp \
+   ./rad_export.cpp \
+   ./rad_follow.cpp \
+   ./rad_gzip.cpp \
+   ./rad_jobs.cpp \
+   ./rad_point_store.cpp \
+   ./rad_reducer.cpp \
+   ./rad_server.cpp \
+   ./rad_control.cpp \
+   ./rad_statistics.cpp \
+   ./rad_text_formatter.cpp \
+   ./rad_waveform.cpp
+
+# zlib - gzip compressed output, see rad_gzip.h
+#
+LIBS += -lz
+
+# end
@@ -0,0 +1,375 @@
+/*  rad_statistics.cpp
+ *
+ *  Copyright (c) 2025 Australian Synchrotron
+ *
+ *  The EPICS QT Framework is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The EPICS QT Framework is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Author:
+ *    Andrew Starritt
+ *  Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#include "rad_statistics.h"
+
+#if defined (Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+
+#include <QECommon.h>
+
+#define DEBUG qDebug () << "rad_statistics" << __LINE__ << __FUNCTION__ << "  "
+
+//------------------------------------------------------------------------------
+//
+Rad_Statistics::Rad_Statistics ()
+{
+   for (int p = 0; p < NumberPhases; p++) {
+      this->isRunning [p] = false;
+      this->accumulated [p] = 0;
+   }
+
+   for (int c = 0; c < NumberCounters; c++) {
+      this->counters [c] = 0;
+   }
+
+   for (int s = 0; s < NumberSamples; s++) {
+      this->samples [s].number = 0;
+      this->samples [s].sum = 0;
+      this->samples [s].minimum = 0;
+      this->samples [s].maximum = 0;
+   }
+
+   this->overall.start ();
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_Statistics::~Rad_Statistics () { }
+
+//------------------------------------------------------------------------------
+//
+void Rad_Statistics::start (const Phases phase)
+{
+   if (this->isRunning [phase]) return;
+   this->isRunning [phase] = true;
+   this->timers [phase].start ();
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Statistics::stop (const Phases phase)
+{
+   if (!this->isRunning [phase]) return;
+   this->isRunning [phase] = false;
+   this->accumulated [phase] += this->timers [phase].nsecsElapsed ();
+}
+
+//------------------------------------------------------------------------------
+//
+qint64 Rad_Statistics::elapsed (const Phases phase) const
+{
+   qint64 result = this->accumulated [phase];
+   if (this->isRunning [phase]) {
+      result += this->timers [phase].nsecsElapsed ();
+   }
+   return result;
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Statistics::increment (const Counters counter, const qint64 amount)
+{
+   this->counters [counter] += amount;
+}
+
+//------------------------------------------------------------------------------
+//
+qint64 Rad_Statistics::count (const Counters counter) const
+{
+   return this->counters [counter];
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Statistics::sample (const Samples kind, const qint64 value)
+{
+   Sample& item = this->samples [kind];
+   if ((item.number == 0) || (value < item.minimum)) item.minimum = value;
+   if ((item.number == 0) || (value > item.maximum)) item.maximum = value;
+   item.number++;
+   item.sum += value;
+}
+
+//------------------------------------------------------------------------------
+//
+qint64 Rad_Statistics::sampleCount (const Samples kind) const
+{
+   return this->samples [kind].number;
+}
+
+//------------------------------------------------------------------------------
+//
+qint64 Rad_Statistics::sampleMinimum (const Samples kind) const
+{
+   return this->samples [kind].minimum;
+}
+
+//------------------------------------------------------------------------------
+//
+qint64 Rad_Statistics::sampleMaximum (const Samples kind) const
+{
+   return this->samples [kind].maximum;
+}
+
+//------------------------------------------------------------------------------
+//
+qint64 Rad_Statistics::sampleMean (const Samples kind) const
+{
+   const Sample& item = this->samples [kind];
+   return (item.number > 0) ? item.sum / item.number : 0;
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Statistics::clearPVs ()
+{
+   this->pvEntries.clear ();
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Statistics::addPV (const QString& pvName, const int pages, const qint64 points)
+{
+   PVEntry entry;
+   entry.pvName = pvName;
+   entry.pages = pages;
+   entry.points = points;
+   this->pvEntries.append (entry);
+}
+
+//------------------------------------------------------------------------------
+//
+qint64 Rad_Statistics::total () const
+{
+   return this->overall.nsecsElapsed ();
+}
+
+//------------------------------------------------------------------------------
+// static
+QString Rad_Statistics::phaseName (const Phases phase)
+{
+   switch (phase) {
+      case ArchiverReady:  return "archiver ready";
+      case Fetch:          return "fetch";
+      case Ingest:         return "ingest/de-overlap";
+      case Resample:       return "resample";
+      case Format:         return "format";
+      case Write:          return "write";
+      default:             return "unknown";
+   }
+}
+
+//------------------------------------------------------------------------------
+// static
+QString Rad_Statistics::counterName (const Counters counter)
+{
+   switch (counter) {
+      case Requests:       return "requests";
+      case Responses:      return "responses";
+      case PointsReceived: return "points received";
+      case PointsWritten:  return "points written";
+      case BytesReceived:  return "bytes received";
+      case OverlapDropped: return "overlap dropped";
+      case Timeouts:       return "timeouts";
+      case Retries:        return "retries";
+      default:             return "unknown";
+   }
+}
+
+//------------------------------------------------------------------------------
+// static
+QString Rad_Statistics::sampleName (const Samples kind)
+{
+   switch (kind) {
+      case RoundTrip:      return "round trip";
+      default:             return "unknown";
+   }
+}
+
+//------------------------------------------------------------------------------
+// e.g. "ingest/de-overlap" => "ingest_de_overlap"
+//
+static QString jsonKey (const QString& name)
+{
+   QString result = name;
+   result.replace (QRegularExpression ("[^A-Za-z0-9]+"), "_");
+   return result;
+}
+
+//------------------------------------------------------------------------------
+// static
+qint64 Rad_Statistics::peakResidentKBytes ()
+{
+#if defined (Q_OS_UNIX)
+   struct rusage usage;
+   if (getrusage (RUSAGE_SELF, &usage) == 0) {
+#if defined (Q_OS_MACOS)
+      return (qint64) usage.ru_maxrss / 1024;   // bytes on macOS
+#else
+      return (qint64) usage.ru_maxrss;          // kBytes on Linux
+#endif
+   }
+#endif
+   return -1;
+}
+
+//------------------------------------------------------------------------------
+// Bytes received are only known for some archive sources, e.g. --appliance.
+//
+bool Rad_Statistics::isUnknown (const Counters counter) const
+{
+   return (counter == BytesReceived) && (this->count (counter) == 0);
+}
+
+//------------------------------------------------------------------------------
+//
+QString Rad_Statistics::report () const
+{
+   QString result;
+
+   result.append (QString ("%1 %2 s\n").arg ("total", -20)
+                  .arg (this->total () * 1.0e-9, 12, 'f', 6));
+
+   for (int p = 0; p < NumberPhases; p++) {
+      const Phases phase = Phases (p);
+      result.append (QString ("%1 %2 s\n").arg (Rad_Statistics::phaseName (phase), -20)
+                     .arg (this->elapsed (phase) * 1.0e-9, 12, 'f', 6));
+   }
+
+   for (int c = 0; c < NumberCounters; c++) {
+      const Counters counter = Counters (c);
+      if (this->isUnknown (counter)) continue;
+      result.append (QString ("%1 %2\n").arg (Rad_Statistics::counterName (counter), -20)
+                     .arg (this->count (counter), 12));
+   }
+
+   for (int s = 0; s < NumberSamples; s++) {
+      const Samples kind = Samples (s);
+      result.append (QString ("%1 %2 s (min) %3 s (mean) %4 s (max), %5 samples\n")
+                     .arg (Rad_Statistics::sampleName (kind), -20)
+                     .arg (this->sampleMinimum (kind) * 1.0e-9, 12, 'f', 6)
+                     .arg (this->sampleMean (kind) * 1.0e-9, 0, 'f', 6)
+                     .arg (this->sampleMaximum (kind) * 1.0e-9, 0, 'f', 6)
+                     .arg (this->sampleCount (kind)));
+   }
+
+   const int number = this->pvEntries.count ();
+   if (number > 0) {
+      int minimum = this->pvEntries.value (0).pages;
+      int maximum = minimum;
+      qint64 sum = 0;
+      for (int j = 0; j < number; j++) {
+         const int pages = this->pvEntries.value (j).pages;
+         minimum = MIN (minimum, pages);
+         maximum = MAX (maximum, pages);
+         sum += pages;
+      }
+      result.append (QString ("%1 %2 (min) %3 (mean) %4 (max), %5 PVs\n")
+                     .arg ("pages per PV", -20)
+                     .arg (minimum, 12)
+                     .arg ((double) sum / number, 0, 'f', 1)
+                     .arg (maximum)
+                     .arg (number));
+   }
+
+   result.append (QString ("%1 %2 kB\n").arg ("peak RSS", -20)
+                  .arg (Rad_Statistics::peakResidentKBytes (), 12));
+
+   return result;
+}
+
+//------------------------------------------------------------------------------
+//
+QByteArray Rad_Statistics::toJson () const
+{
+   QJsonObject root;
+   root.insert ("total", this->total () * 1.0e-9);
+
+   QJsonObject phases;
+   for (int p = 0; p < NumberPhases; p++) {
+      const Phases phase = Phases (p);
+      phases.insert (jsonKey (Rad_Statistics::phaseName (phase)), this->elapsed (phase) * 1.0e-9);
+   }
+   root.insert ("phases", phases);
+
+   QJsonObject counts;
+   for (int c = 0; c < NumberCounters; c++) {
+      const Counters counter = Counters (c);
+      if (this->isUnknown (counter)) continue;
+      counts.insert (jsonKey (Rad_Statistics::counterName (counter)), (double) this->count (counter));
+   }
+   root.insert ("counters", counts);
+
+   QJsonObject distributions;
+   for (int s = 0; s < NumberSamples; s++) {
+      const Samples kind = Samples (s);
+      QJsonObject item;
+      item.insert ("samples", (double) this->sampleCount (kind));
+      item.insert ("min", this->sampleMinimum (kind) * 1.0e-9);
+      item.insert ("mean", this->sampleMean (kind) * 1.0e-9);
+      item.insert ("max", this->sampleMaximum (kind) * 1.0e-9);
+      distributions.insert (jsonKey (Rad_Statistics::sampleName (kind)), item);
+   }
+   root.insert ("samples", distributions);
+
+   QJsonArray pvs;
+   for (int j = 0; j < this->pvEntries.count (); j++) {
+      const PVEntry& entry = this->pvEntries.at (j);
+      QJsonObject item;
+      item.insert ("name", entry.pvName);
+      item.insert ("pages", entry.pages);
+      item.insert ("points", (double) entry.points);
+      pvs.append (item);
+   }
+   root.insert ("pvs", pvs);
+
+   root.insert ("peak_rss_kb", (double) Rad_Statistics::peakResidentKBytes ());
+
+   return QJsonDocument (root).toJson (QJsonDocument::Indented);
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_Statistics::Timer::Timer (Rad_Statistics* statisticsIn, const Phases phaseIn) :
+   statistics (statisticsIn),
+   phase (phaseIn)
+{
+   this->statistics->start (this->phase);
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_Statistics::Timer::~Timer ()
+{
+   this->statistics->stop (this->phase);
+}
+
+// end
@@ -0,0 +1,149 @@
+/* rad_statistics.h
+ *
+ * This file is part of the EPICS QT Framework, initially developed at the
+ * Australian Synchrotron.
+ *
+ * Copyright (c) 2025 Australian Synchrotron
+ *
+ * The EPICS QT Framework is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The EPICS QT Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author:
+ *    Andrew Starritt
+ * Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#ifndef RAD_STATISTICS_H
+#define RAD_STATISTICS_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QString>
+
+// Accumulates per-phase elapsed times and simple counters for a qerad run.
+//
+class Rad_Statistics {
+public:
+   enum Phases {
+      ArchiverReady = 0,   // wait for archiver interface to be ready
+      Fetch,               // first request issued to last response received
+      Ingest,              // overlap removal and packing of received points
+      Resample,            // postProcess
+      Format,              // conversion to output representation
+      Write,               // writing to the output file
+      NumberPhases         // must be last
+   };
+
+   enum Counters {
+      Requests = 0,        // archiver requests issued
+      Responses,           // archiver responses received
+      PointsReceived,      // points received from the archiver
+      PointsWritten,       // rows written to the output file
+      BytesReceived,       // response bytes, where reported by the archive source
+      OverlapDropped,      // points dropped as overlapping earlier data
+      Timeouts,            // archiver requests that timed out
+      Retries,             // archiver requests re-issued after a failure/timeout
+      NumberCounters       // must be last
+   };
+
+   // Distributions of individual measurements.
+   //
+   enum Samples {
+      RoundTrip = 0,       // archiver request issued to response received
+      NumberSamples        // must be last
+   };
+
+   explicit Rad_Statistics ();
+   ~Rad_Statistics ();
+
+   // Phase times accumulate across multiple start/stop pairs.
+   // A start while the phase is already running is ignored.
+   //
+   void start (const Phases phase);
+   void stop (const Phases phase);
+   qint64 elapsed (const Phases phase) const;    // nano seconds
+
+   void increment (const Counters counter, const qint64 amount = 1);
+   qint64 count (const Counters counter) const;
+
+   void sample (const Samples kind, const qint64 value);     // nano seconds
+   qint64 sampleCount (const Samples kind) const;
+   qint64 sampleMinimum (const Samples kind) const;
+   qint64 sampleMaximum (const Samples kind) const;
+   qint64 sampleMean (const Samples kind) const;
+
+   // Per PV details, as of the most recent fetch.
+   //
+   void clearPVs ();
+   void addPV (const QString& pvName, const int pages, const qint64 points);
+
+   // Total time since construction, nano seconds.
+   //
+   qint64 total () const;
+
+   static QString phaseName (const Phases phase);
+   static QString counterName (const Counters counter);
+   static QString sampleName (const Samples kind);
+
+   // Peak resident set size in kBytes, or -1 if not available.
+   //
+   static qint64 peakResidentKBytes ();
+
+   // Multi-line human readable report.
+   //
+   QString report () const;
+
+   // The same as a JSON object. Times are in seconds, and JSON keys are as
+   // per the report names with spaces etc. replaced by '_'.
+   //
+   QByteArray toJson () const;
+
+   // Scoped phase timer.
+   //
+   class Timer {
+   public:
+      explicit Timer (Rad_Statistics* statistics, const Phases phase);
+      ~Timer ();
+   private:
+      Rad_Statistics* statistics;
+      Phases phase;
+   };
+
+private:
+   bool isUnknown (const Counters counter) const;
+
+   QElapsedTimer overall;
+   QElapsedTimer timers [NumberPhases];
+   bool isRunning [NumberPhases];
+   qint64 accumulated [NumberPhases];
+   qint64 counters [NumberCounters];
+
+   struct Sample {
+      qint64 number;
+      qint64 sum;
+      qint64 minimum;
+      qint64 maximum;
+   };
+   Sample samples [NumberSamples];
+
+   struct PVEntry {
+      QString pvName;
+      int pages;
+      qint64 points;
+   };
+   QList<PVEntry> pvEntries;
+};
+
+#endif  // RAD_STATISTICS_H
@@ -0,0 +1,608 @@
+/*  rad_text_formatter.cpp
+ *
+ *  Copyright (c) 2025 Australian Synchrotron
+ *
+ *  The EPICS QT Framework is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The EPICS QT Framework is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Author:
+ *    Andrew Starritt
+ *  Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#include "rad_text_formatter.h"
+
+#include <limits>
+#include <stdio.h>
+#include <string.h>
+#include <QDate>
+#include <QDebug>
+#include <QList>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <QTimeZone>
+#include <QtNumeric>
+#include <QECommon.h>
+#include <QCaAlarmInfo.h>
+
+#define DEBUG qDebug () << "rad_text_formatter" << __LINE__ << __FUNCTION__ << "  "
+
+static const qint64 secondsPerDay = 86400;
+static const qint64 nanoSecsPerSecond = 1000000000;
+
+// Used when the platform time zone data provides no transition details.
+//
+static const qint64 fallbackZonePeriod = 1800;
+
+//------------------------------------------------------------------------------
+// Floor division, i.e. rounds towards -infinity for pre-1970 times.
+//
+static inline qint64 floorDiv (const qint64 a, const qint64 b)
+{
+   qint64 q = a / b;
+   if ((a % b != 0) && ((a < 0) != (b < 0))) q--;
+   return q;
+}
+
+//------------------------------------------------------------------------------
+// Writes value right aligned, space padded, in width characters.
+//
+static inline char* putRight (char* p, quint64 value, const int width)
+{
+   char digits [24];
+   int n = 0;
+   do {
+      digits [n++] = (char) ('0' + (value % 10));
+      value /= 10;
+   } while (value > 0);
+
+   for (int j = n; j < width; j++) *p++ = ' ';
+   while (n > 0) *p++ = digits [--n];
+   return p;
+}
+
+//------------------------------------------------------------------------------
+//
+static inline char* putTwoDigits (char* p, const int value)
+{
+   *p++ = (char) ('0' + (value / 10));
+   *p++ = (char) ('0' + (value % 10));
+   return p;
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_TextFormatter::Rad_TextFormatter (const Qt::TimeSpec timeSpecIn) :
+   timeSpec (timeSpecIn),
+   origin (0),
+   zoneFrom (0),
+   zoneUntil (0),     // i.e. empty - forces initial lookup
+   zoneOffset (0),
+   cachedDay (std::numeric_limits<qint64>::min ())
+{
+   this->data.reserve (1 << 16);
+   memset (this->dateImage, ' ', sizeof (this->dateImage));
+   memset (this->isoDateImage, ' ', sizeof (this->isoDateImage));
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_TextFormatter::~Rad_TextFormatter () { }
+
+//------------------------------------------------------------------------------
+//
+void Rad_TextFormatter::setOrigin (const qint64 originIn)
+{
+   this->origin = originIn;
+}
+
+//------------------------------------------------------------------------------
+//
+const QByteArray& Rad_TextFormatter::buffer () const
+{
+   return this->data;
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_TextFormatter::clear ()
+{
+   this->data.resize (0);    // capacity is reserved, so is retained
+}
+
+//------------------------------------------------------------------------------
+// Extends the buffer by size bytes, and returns a pointer to the extension.
+// The caller trims any unused part via data.resize.
+//
+char* Rad_TextFormatter::reserve (const int size)
+{
+   const int used = this->data.size ();
+   if (used + size > this->data.capacity ()) {
+      this->data.reserve (2 * (used + size));
+   }
+   this->data.resize (used + size);
+   return this->data.data () + used;
+}
+
+//------------------------------------------------------------------------------
+// Determine the zone offset and abbreviation for the given UTC epoch seconds,
+// and the period over which they apply.
+//
+void Rad_TextFormatter::updateZone (const qint64 seconds)
+{
+   const QDateTime utc = QDateTime::fromMSecsSinceEpoch (seconds * 1000, Qt::UTC);
+   const QDateTime local = utc.toTimeSpec (this->timeSpec);
+
+   this->zoneOffset = local.offsetFromUtc ();
+   this->zoneName = QEUtilities::getTimeZoneTLA (local).toLatin1 ();
+
+   if (this->timeSpec == Qt::UTC) {
+      this->zoneIsoOffset = "Z";
+   } else {
+      const int magnitude = (int) (this->zoneOffset < 0 ? -this->zoneOffset : this->zoneOffset);
+      char image [8];
+      char* p = image;
+      *p++ = (this->zoneOffset < 0) ? '-' : '+';
+      p = putTwoDigits (p, magnitude / 3600);
+      *p++ = ':';
+      p = putTwoDigits (p, (magnitude / 60) % 60);
+      this->zoneIsoOffset = QByteArray (image, (int) (p - image));
+   }
+
+   if (this->timeSpec == Qt::UTC) {
+      this->zoneFrom = std::numeric_limits<qint64>::min ();
+      this->zoneUntil = std::numeric_limits<qint64>::max ();
+      return;
+   }
+
+   const QTimeZone zone = QTimeZone::systemTimeZone ();
+   if (zone.hasTransitions ()) {
+      // previousTransition is strictly before the given time.
+      //
+      const QTimeZone::OffsetData previous = zone.previousTransition (utc.addSecs (1));
+      const QTimeZone::OffsetData next = zone.nextTransition (utc);
+
+      this->zoneFrom = previous.atUtc.isValid () ? previous.atUtc.toMSecsSinceEpoch () / 1000
+                                                 : std::numeric_limits<qint64>::min ();
+      this->zoneUntil = next.atUtc.isValid () ? next.atUtc.toMSecsSinceEpoch () / 1000
+                                              : std::numeric_limits<qint64>::max ();
+   } else {
+      this->zoneFrom = floorDiv (seconds, fallbackZonePeriod) * fallbackZonePeriod;
+      this->zoneUntil = this->zoneFrom + fallbackZonePeriod;
+   }
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_TextFormatter::putDate (const qint64 day)
+{
+   const QDate date = QDate (1970, 1, 1).addDays (day);
+   char* p = this->dateImage;
+
+   p = putTwoDigits (p, date.day ());
+   *p++ = '/';
+   p = putTwoDigits (p, date.month ());
+   *p++ = '/';
+   const int year = date.year ();
+   p = putTwoDigits (p, (year / 100) % 100);
+   p = putTwoDigits (p, year % 100);
+
+   p = this->isoDateImage;
+   p = putTwoDigits (p, (year / 100) % 100);
+   p = putTwoDigits (p, year % 100);
+   *p++ = '-';
+   p = putTwoDigits (p, date.month ());
+   *p++ = '-';
+   p = putTwoDigits (p, date.day ());
+
+   this->cachedDay = day;
+}
+
+//------------------------------------------------------------------------------
+// Writes relative time (nano seconds) as seconds, fixed 3 decimal places, right
+// aligned in width characters. Rounded to nearest mSec, halves away from zero,
+// as per %.3f.
+//
+static char* putRelative (char* p, const qint64 relativeNanoSecs, const int width)
+{
+   const bool isNegative = (relativeNanoSecs < 0);
+   const quint64 magnitude = (quint64) (isNegative ? -relativeNanoSecs : relativeNanoSecs);
+   const quint64 mSecs = (magnitude + 500000) / 1000000;
+
+   char image [32];
+   char* q = image;
+   if (isNegative && (mSecs > 0)) *q++ = '-';
+   q = putRight (q, mSecs / 1000, 1);
+   *q++ = '.';
+   const int fraction = (int) (mSecs % 1000);
+   *q++ = (char) ('0' + fraction / 100);
+   q = putTwoDigits (q, fraction % 100);
+
+   const int imageLength = (int) (q - image);
+   for (int j = imageLength; j < width; j++) *p++ = ' ';
+   memcpy (p, image, imageLength);
+   return p + imageLength;
+}
+
+//------------------------------------------------------------------------------
+// Ensures the zone and date caches apply to the given time, and returns the
+// local epoch seconds.
+//
+qint64 Rad_TextFormatter::locate (const qint64 time)
+{
+   const qint64 seconds = floorDiv (time, nanoSecsPerSecond);
+   if ((seconds < this->zoneFrom) || (seconds >= this->zoneUntil)) {
+      this->updateZone (seconds);
+   }
+
+   const qint64 localSeconds = seconds + this->zoneOffset;
+   const qint64 day = floorDiv (localSeconds, secondsPerDay);
+   if (day != this->cachedDay) {
+      this->putDate (day);
+   }
+   return localSeconds;
+}
+
+//------------------------------------------------------------------------------
+// Writes "dd/MM/yyyy HH:mm:ss[.zzz] zone" - the caches must have been located.
+//
+char* Rad_TextFormatter::putTime (char* p, const qint64 time, const qint64 localSeconds,
+                                  const bool withMSecs) const
+{
+   const int secondOfDay = (int) (localSeconds - this->cachedDay * secondsPerDay);
+   memcpy (p, this->dateImage, sizeof (this->dateImage));
+   p += sizeof (this->dateImage);
+   *p++ = ' ';
+   p = putTwoDigits (p, secondOfDay / 3600);
+   *p++ = ':';
+   p = putTwoDigits (p, (secondOfDay / 60) % 60);
+   *p++ = ':';
+   p = putTwoDigits (p, secondOfDay % 60);
+
+   if (withMSecs) {
+      const int mSec = (int) ((time - floorDiv (time, nanoSecsPerSecond) * nanoSecsPerSecond) / 1000000);
+      *p++ = '.';
+      *p++ = (char) ('0' + mSec / 100);
+      p = putTwoDigits (p, mSec % 100);
+   }
+
+   *p++ = ' ';
+   memcpy (p, this->zoneName.constData (), this->zoneName.size ());
+   return p + this->zoneName.size ();
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_TextFormatter::appendIsoTime (QByteArray& target, const qint64 time)
+{
+   const qint64 localSeconds = this->locate (time);
+   const int secondOfDay = (int) (localSeconds - this->cachedDay * secondsPerDay);
+   const qint64 nanoSecs = time - floorDiv (time, nanoSecsPerSecond) * nanoSecsPerSecond;
+
+   char image [48];
+   char* p = image;
+   memcpy (p, this->isoDateImage, sizeof (this->isoDateImage));
+   p += sizeof (this->isoDateImage);
+   *p++ = 'T';
+   p = putTwoDigits (p, secondOfDay / 3600);
+   *p++ = ':';
+   p = putTwoDigits (p, (secondOfDay / 60) % 60);
+   *p++ = ':';
+   p = putTwoDigits (p, secondOfDay % 60);
+   *p++ = '.';
+
+   // Nine digits, zero padded.
+   //
+   qint64 work = nanoSecs;
+   for (int j = 8; j >= 0; j--) {
+      p [j] = (char) ('0' + (work % 10));
+      work /= 10;
+   }
+   p += 9;
+
+   memcpy (p, this->zoneIsoOffset.constData (), this->zoneIsoOffset.size ());
+   p += this->zoneIsoOffset.size ();
+
+   target.append (image, (int) (p - image));
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_TextFormatter::beginRow (const int row, const qint64 time)
+{
+   const qint64 localSeconds = this->locate (time);
+
+   const int maximum = 24 + 3 + 20 + 1 + this->zoneName.size () + 1 + 32 + 1;
+   char* start = this->reserve (maximum);
+   char* p = start;
+
+   // Row number, width 6, then 3 spaces.
+   //
+   p = putRight (p, (quint64) MAX (row, 0), 6);
+   *p++ = ' ';
+   *p++ = ' ';
+   *p++ = ' ';
+
+   // Date time, width 20, i.e. one leading space, then zone.
+   //
+   *p++ = ' ';
+   p = this->putTime (p, time, localSeconds, false);
+   *p++ = ' ';
+
+   // Relative time, width 12.
+   //
+   p = putRelative (p, time - this->origin, 12);
+   *p++ = ' ';
+
+   this->data.resize (this->data.size () - (maximum - (int) (p - start)));
+}
+
+//------------------------------------------------------------------------------
+// As per QString::arg (value, 16, 'e', 8) - which is always in the C locale.
+//
+void Rad_TextFormatter::appendValue (const double value)
+{
+   char image [40];
+   int length;
+
+   if (qIsNaN (value)) {
+      length = snprintf (image, sizeof (image), "nan");
+   } else if (qIsInf (value)) {
+      length = snprintf (image, sizeof (image), value < 0.0 ? "-inf" : "inf");
+   } else {
+      length = snprintf (image, sizeof (image), "%.8e", value);
+
+      // printf honours LC_NUMERIC, which QCoreApplication sets from the
+      // environment - so ensure a '.' decimal point.
+      //
+      for (int j = 0; j < length; j++) {
+         if ((image [j] < '0' || image [j] > '9') && image [j] != '-' &&
+             image [j] != '+' && image [j] != 'e' && image [j] != '.') {
+            image [j] = '.';
+         }
+      }
+   }
+
+   length = MIN (length, (int) sizeof (image) - 1);
+   const int width = MAX (16, length);
+   char* p = this->reserve (1 + width);
+   *p++ = ' ';
+   for (int j = length; j < 16; j++) *p++ = ' ';
+   memcpy (p, image, length);
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_TextFormatter::appendNil ()
+{
+   static const char nil [] = "              nil";   // space + width 16
+   char* p = this->reserve (sizeof (nil) - 1);
+   memcpy (p, nil, sizeof (nil) - 1);
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_TextFormatter::endRow ()
+{
+   char* p = this->reserve (1);
+   *p = '\n';
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_TextFormatter::appendRows (const Rad_Aligner::Table& table,
+                                    const int first, const int last)
+{
+   const int numberColumns = table.columns.count ();
+
+   for (int j = first; j < last; j++) {
+      this->beginRow (j, table.time [j]);
+
+      for (int n = 0; n < numberColumns; n++) {
+         const Rad_Aligner::Column& column = table.columns [n];
+         if (column.isDisplayable [j]) {
+            this->appendValue (column.value [j]);
+         } else {
+            this->appendNil ();
+         }
+      }
+
+      this->endRow ();
+   }
+}
+
+//------------------------------------------------------------------------------
+//
+const QByteArray& Rad_TextFormatter::alarmImage (const quint16 severity, const quint16 status)
+{
+   const quint32 key = ((quint32) severity << 16) | status;
+
+   QHash<quint32, QByteArray>::const_iterator it = this->alarmImages.constFind (key);
+   if (it != this->alarmImages.constEnd ()) return it.value ();
+
+   const QCaAlarmInfo alarm (status, severity);
+   const bool isValid = Rad_PointStore::isDisplayableSeverity (severity);
+   const QString image = QString ("  %1  %2  %3")
+         .arg (isValid ? "True " : "False")
+         .arg (alarm.severityName (), -10)
+         .arg (alarm.statusName ());
+
+   return this->alarmImages.insert (key, image.toLatin1 ()).value ();
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_TextFormatter::appendPointRow (const int row, const qint64 time, const double value,
+                                        const quint16 severity, const quint16 status)
+{
+   const qint64 localSeconds = this->locate (time);
+
+   const int maximum = 24 + 2 + 23 + 1 + this->zoneName.size () + 1 + 32;
+   char* start = this->reserve (maximum);
+   char* p = start;
+
+   // Row number, width 6, then 2 spaces.
+   //
+   p = putRight (p, (quint64) MAX (row, 0), 6);
+   *p++ = ' ';
+   *p++ = ' ';
+
+   p = this->putTime (p, time, localSeconds, true);
+   *p++ = ' ';
+
+   // Relative time, width 16.
+   //
+   p = putRelative (p, time - this->origin, 16);
+
+   this->data.resize (this->data.size () - (maximum - (int) (p - start)));
+
+   this->appendValue (value);   // includes the leading space
+
+   const QByteArray& alarm = this->alarmImage (severity, status);
+   p = this->reserve (alarm.size () + 1);
+   memcpy (p, alarm.constData (), alarm.size ());
+   p [alarm.size ()] = '\n';
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_TextFormatter::appendPoints (const Rad_PointStore& points,
+                                      const int first, const int last,
+                                      const int firstRow)
+{
+   for (int j = first; j < last; j++) {
+      this->appendPointRow (firstRow + (j - first), points.time [j], points.value [j],
+                            points.severity [j], points.status [j]);
+   }
+}
+
+//==============================================================================
+// Formats one chunk of rows. Not auto deleted - the writer waits for, writes
+// out and then deletes each task in row order.
+//
+class Rad_FormatTask : public QRunnable {
+public:
+   explicit Rad_FormatTask (const Qt::TimeSpec timeSpec, const qint64 origin,
+                            const Rad_Aligner::Table* table,
+                            const int first, const int last);
+   ~Rad_FormatTask ();
+
+   void run ();
+   void wait ();
+   const QByteArray& buffer () const { return this->formatter.buffer (); }
+
+private:
+   Rad_TextFormatter formatter;
+   const Rad_Aligner::Table* table;
+   const int first;
+   const int last;
+   QSemaphore done;
+};
+
+//------------------------------------------------------------------------------
+//
+Rad_FormatTask::Rad_FormatTask (const Qt::TimeSpec timeSpec, const qint64 origin,
+                                const Rad_Aligner::Table* tableIn,
+                                const int firstIn, const int lastIn) :
+   QRunnable (),
+   formatter (timeSpec),
+   table (tableIn),
+   first (firstIn),
+   last (lastIn),
+   done (0)
+{
+   this->setAutoDelete (false);
+   this->formatter.setOrigin (origin);
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_FormatTask::~Rad_FormatTask () { }
+
+//------------------------------------------------------------------------------
+//
+void Rad_FormatTask::run ()
+{
+   this->formatter.appendRows (*this->table, this->first, this->last);
+   this->done.release ();
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_FormatTask::wait ()
+{
+   this->done.acquire ();
+}
+
+//==============================================================================
+//
+Rad_TableTextWriter::Rad_TableTextWriter (const Qt::TimeSpec timeSpecIn,
+                                          const qint64 originIn) :
+   timeSpec (timeSpecIn),
+   origin (originIn)
+{
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_TableTextWriter::~Rad_TableTextWriter () { }
+
+//------------------------------------------------------------------------------
+//
+bool Rad_TableTextWriter::write (QIODevice* device, const Rad_Aligner::Table& table,
+                                 Rad_Statistics* statistics) const
+{
+   QThreadPool* pool = QThreadPool::globalInstance ();
+   const int number = table.numberRows;
+   const int window = 2 * MAX (pool->maxThreadCount (), 1);
+
+   QList<Rad_FormatTask*> queue;
+   int next = 0;          // first row not yet queued
+   bool okay = true;
+
+   while ((next < number) || !queue.isEmpty ()) {
+      // Keep the pool busy - stop queueing on error, but still wait for the
+      // queued tasks as they reference the table.
+      //
+      while (okay && (next < number) && (queue.count () < window)) {
+         const int last = MIN (next + chunkRows, number);
+         Rad_FormatTask* task = new Rad_FormatTask (this->timeSpec, this->origin,
+                                                    &table, next, last);
+         queue.append (task);
+         pool->start (task);
+         next = last;
+      }
+
+      if (queue.isEmpty ()) break;
+      Rad_FormatTask* task = queue.takeFirst ();
+
+      if (statistics) statistics->start (Rad_Statistics::Format);
+      task->wait ();
+      if (statistics) statistics->stop (Rad_Statistics::Format);
+
+      if (okay) {
+         const QByteArray& buffer = task->buffer ();
+         if (statistics) statistics->start (Rad_Statistics::Write);
+         okay = (device->write (buffer) == buffer.size ());
+         if (statistics) statistics->stop (Rad_Statistics::Write);
+      }
+
+      delete task;
+   }
+
+   return okay;
+}
+
+// end
@@ -0,0 +1,161 @@
+/* rad_text_formatter.h
+ *
+ * This file is part of the EPICS QT Framework, initially developed at the
+ * Australian Synchrotron.
+ *
+ * Copyright (c) 2025 Australian Synchrotron
+ *
+ * The EPICS QT Framework is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The EPICS QT Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author:
+ *    Andrew Starritt
+ * Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#ifndef RAD_TEXT_FORMATTER_H
+#define RAD_TEXT_FORMATTER_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QIODevice>
+
+#include "rad_aligner.h"
+#include "rad_point_store.h"
+#include "rad_statistics.h"
+
+// Formats multiple PV text output rows, i.e. the same layout as:
+//
+//   QString ("%1   %2 %3 %4 ").arg (row, 6).arg (time.toString ("dd/MM/yyyy HH:mm:ss"), 20)
+//                             .arg (zone).arg (relative, 12, 'f', 3)
+//
+// followed by QString (" %1").arg (value, 16, 'e', 8) or " nil" (width 16)
+// per column, but without any per row heap allocation or time zone lookup.
+//
+// Also formats single PV text output rows, i.e. one row per point:
+//
+//   QString ("%1  %2 %3 %4 %5  %6  %7  %8").arg (row, 6)
+//           .arg (time.toString ("dd/MM/yyyy HH:mm:ss.zzz")).arg (zone)
+//           .arg (relative, 16, 'f', 3).arg (value, 16, 'e', 8)
+//           .arg (valid ? "True " : "False").arg (severityName, -10).arg (statusName)
+//
+// The zone abbreviation and UTC offset are cached for the current daylight
+// saving period, the date part is re-formatted only when the day changes,
+// and all digits are written directly into a re-usable buffer.
+//
+class Rad_TextFormatter {
+public:
+   explicit Rad_TextFormatter (const Qt::TimeSpec timeSpec);
+   ~Rad_TextFormatter ();
+
+   // Relative times are with respect to origin - nano seconds since epoch.
+   //
+   void setOrigin (const qint64 origin);
+
+   // A row comprises beginRow, one appendValue/appendNil per column, endRow.
+   // Time is nano seconds since 1970-01-01 00:00:00 UTC.
+   //
+   void beginRow (const int row, const qint64 time);
+   void appendValue (const double value);
+   void appendNil ();
+   void endRow ();
+
+   // Formats rows [first, last) of an aligned table - nil for any value that
+   // is not displayable.
+   //
+   void appendRows (const Rad_Aligner::Table& table, const int first, const int last);
+
+   // Formats one single PV row.
+   //
+   void appendPointRow (const int row, const qint64 time, const double value,
+                        const quint16 severity, const quint16 status);
+
+   // Formats points [first, last) as single PV rows, numbered from firstRow.
+   //
+   void appendPoints (const Rad_PointStore& points, const int first, const int last,
+                      const int firstRow);
+
+   // Appends time as ISO 8601 with nano second resolution to target, e.g.
+   // 2025-05-26T17:13:05.123456789+10:00, or ...Z for UTC. Uses the same zone
+   // and date caches as the rows, i.e. no per call allocation or zone lookup.
+   //
+   void appendIsoTime (QByteArray& target, const qint64 time);
+
+   // Formatted rows since last clear. Clear retains the allocated capacity.
+   //
+   const QByteArray& buffer () const;
+   void clear ();
+
+private:
+   const Qt::TimeSpec timeSpec;
+   qint64 origin;
+   QByteArray data;
+
+   // Zone cache, valid for UTC epoch seconds in [zoneFrom, zoneUntil).
+   //
+   qint64 zoneFrom;
+   qint64 zoneUntil;
+   qint64 zoneOffset;          // seconds
+   QByteArray zoneName;
+   QByteArray zoneIsoOffset;   // e.g. "+10:00", or "Z" for UTC
+
+   // Date cache - local day number and its "dd/MM/yyyy" and "yyyy-MM-dd" images.
+   //
+   qint64 cachedDay;
+   char dateImage [10];
+   char isoDateImage [10];
+
+   // Alarm cache - the single PV row "valid  severity  status" image for each
+   // severity/status pair seen, keyed on (severity << 16) | status.
+   //
+   QHash<quint32, QByteArray> alarmImages;
+
+   char* reserve (const int size);
+   void updateZone (const qint64 seconds);
+   void putDate (const qint64 day);
+   qint64 locate (const qint64 time);
+   char* putTime (char* p, const qint64 time, const qint64 localSeconds,
+                  const bool withMSecs) const;
+   const QByteArray& alarmImage (const quint16 severity, const quint16 status);
+};
+
+// Formats the rows of an aligned table in chunks on the global thread pool,
+// each chunk into its own buffer with its own Rad_TextFormatter, and writes
+// the buffers to the device in row order. Rows depend only on the row index
+// and the origin, so the output is identical to formatting the rows serially.
+//
+// At most a window of chunks are formatted ahead of the chunk being written,
+// which bounds the memory used irrespective of the number of rows.
+//
+class Rad_TableTextWriter {
+public:
+   explicit Rad_TableTextWriter (const Qt::TimeSpec timeSpec, const qint64 origin);
+   ~Rad_TableTextWriter ();
+
+   // Waiting for formatted chunks is accumulated as Format time and writing
+   // as Write time, when statistics is specified. Returns false if a write
+   // fails, in which case no further chunks are written.
+   //
+   bool write (QIODevice* device, const Rad_Aligner::Table& table,
+               Rad_Statistics* statistics = NULL) const;
+
+   static const int chunkRows = 4096;
+
+private:
+   const Qt::TimeSpec timeSpec;
+   const qint64 origin;
+};
+
+#endif  // RAD_TEXT_FORMATTER_H
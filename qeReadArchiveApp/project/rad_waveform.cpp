@@ -0,0 +1,165 @@
+/*  rad_waveform.cpp
+ *
+ *  Copyright (c) 2025 Australian Synchrotron
+ *
+ *  The EPICS QT Framework is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  The EPICS QT Framework is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *  Author:
+ *    Andrew Starritt
+ *  Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#include "rad_waveform.h"
+
+#include <QDebug>
+#include <QtNumeric>
+
+#include <QECommon.h>
+
+#define DEBUG qDebug () << "rad_waveform" << __LINE__ << __FUNCTION__ << "  "
+
+// Target block size, i.e. 8 MB. A block holds at least one row.
+//
+static const int blockValues = 1 << 20;
+
+//------------------------------------------------------------------------------
+//
+Rad_Waveform::Rad_Waveform (const int numberElements) :
+   elements (numberElements),
+   rowsPerBlock (MAX (1, blockValues / MAX (1, numberElements))),
+   isDefined (false)
+{
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_Waveform::~Rad_Waveform () { }
+
+//------------------------------------------------------------------------------
+//
+void Rad_Waveform::clear ()
+{
+   this->isDefined = false;
+   this->times.clear ();
+   this->blocks.clear ();
+   this->severities.clear ();
+   this->statuses.clear ();
+   this->displayable.clear ();
+}
+
+//------------------------------------------------------------------------------
+//
+int Rad_Waveform::addElement (const int element, const Rad_PointStore& points)
+{
+   const int number = points.count ();
+   if ((element < 0) || (element >= this->elements)) return number;
+   if (number == 0) return 0;
+
+   if (!this->isDefined) {
+      // Implicitly shared with the element's data set.
+      //
+      this->times = points.time;
+      this->severities = points.severity;
+      this->statuses = points.status;
+      this->displayable = points.isDisplayable;
+
+      for (int first = 0; first < number; first += this->rowsPerBlock) {
+         const int rows = MIN (this->rowsPerBlock, number - first);
+         this->blocks.append (QVector<double> (rows * this->elements, qQNaN ()));
+      }
+      this->isDefined = true;
+   }
+
+   // Both sets of times are in ascending order - a single merge pass.
+   //
+   const int numberRows = this->times.count ();
+   const qint64* rowTime = this->times.constData ();
+   const qint64* time = points.time.constData ();
+   const double* value = points.value.constData ();
+   int unmatched = 0;
+   int r = 0;
+
+   QVector<double*> target (this->blocks.count ());
+   for (int b = 0; b < this->blocks.count (); b++) {
+      target [b] = this->blocks [b].data () + element;
+   }
+
+   for (int p = 0; p < number; p++) {
+      while ((r < numberRows) && (rowTime [r] < time [p])) r++;
+      if ((r < numberRows) && (rowTime [r] == time [p])) {
+         target [r / this->rowsPerBlock] [(r % this->rowsPerBlock) * this->elements] = value [p];
+      } else {
+         unmatched++;
+      }
+   }
+
+   return unmatched;
+}
+
+//------------------------------------------------------------------------------
+//
+void Rad_Waveform::appendRow (const qint64 time, const double* values,
+                              const quint16 severity, const quint16 status)
+{
+   if ((this->times.count () % this->rowsPerBlock) == 0) {
+      this->blocks.append (QVector<double> ());
+   }
+
+   QVector<double>& block = this->blocks.last ();
+   const int at = block.count ();
+   block.resize (at + this->elements);
+   double* target = block.data () + at;
+   for (int e = 0; e < this->elements; e++) {
+      target [e] = values [e];
+   }
+
+   this->times.append (time);
+   this->severities.append (severity);
+   this->statuses.append (status);
+   this->displayable.append (Rad_PointStore::isDisplayableSeverity (severity));
+   this->isDefined = true;
+}
+
+//------------------------------------------------------------------------------
+//
+Rad_PointStore Rad_Waveform::elementPoints (const int element) const
+{
+   Rad_PointStore result;
+   if ((element < 0) || (element >= this->elements)) return result;
+
+   const int numberRows = this->times.count ();
+
+   result.time = this->times;
+   result.severity = this->severities;
+   result.status = this->statuses;
+   result.isDisplayable = this->displayable;
+   result.value.resize (numberRows);
+
+   double* value = result.value.data ();
+   for (int j = 0; j < numberRows; j++) {
+      value [j] = this->row (j) [element];
+   }
+   return result;
+}
+
+//------------------------------------------------------------------------------
+//
+const double* Rad_Waveform::row (const int j) const
+{
+   return this->blocks [j / this->rowsPerBlock].constData () +
+          (j % this->rowsPerBlock) * this->elements;
+}
+
+// end
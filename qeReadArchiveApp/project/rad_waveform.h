@@ -0,0 +1,98 @@
+/* rad_waveform.h
+ *
+ * This file is part of the EPICS QT Framework, initially developed at the
+ * Australian Synchrotron.
+ *
+ * Copyright (c) 2025 Australian Synchrotron
+ *
+ * The EPICS QT Framework is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * The EPICS QT Framework is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with the EPICS QT Framework.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Author:
+ *    Andrew Starritt
+ * Contact details:
+ *    andrews@ansto.gov.au
+ */
+
+#ifndef RAD_WAVEFORM_H
+#define RAD_WAVEFORM_H
+
+#include <QVector>
+
+#include "rad_point_store.h"
+
+// The data set of one array (waveform) PV: one row per archived sample, each
+// row a contiguous block of the sample's element values. The values are held
+// row major in blocks of whole rows, so that the overall size is not limited
+// by the maximum QVector allocation. There are no per element objects.
+//
+// The archiver interface delivers one element per request, so the data set is
+// built up one element at a time - see addElement. Each element's data set is
+// added, and may then be discarded, as soon as it is complete. The first
+// non-empty element data set defines the rows, i.e. the sample times and
+// per sample alarm; the values of subsequent elements are matched on time.
+// Values not (yet) available are NaN. Alternatively, when whole samples are
+// decoded, e.g. from an Archive Appliance response, the data set is built up
+// one row at a time - see appendRow.
+//
+// Times are nanoseconds since 1970-01-01 00:00:00 UTC.
+//
+class Rad_Waveform {
+public:
+   explicit Rad_Waveform (const int numberElements = 0);
+   ~Rad_Waveform ();
+
+   void clear ();
+
+   // Adds the data set of one element, element being in the range 0 to
+   // numberElements - 1. Returns the number of points that did not match
+   // the time of any row, and were therefore dropped.
+   //
+   int addElement (const int element, const Rad_PointStore& points);
+
+   // Appends a row, values being numberElements () element values. Rows must
+   // be appended in time order, and not mixed with addElement.
+   //
+   void appendRow (const qint64 time, const double* values,
+                   const quint16 severity, const quint16 status);
+
+   // The data set of one element, i.e. as per addElement. The times and
+   // alarms are implicitly shared with the waveform.
+   //
+   Rad_PointStore elementPoints (const int element) const;
+
+   int numberElements () const { return this->elements; }
+   int numberRows () const { return this->times.count (); }
+
+   const QVector<qint64>& time () const { return this->times; }
+
+   // Row j element values - numberElements () of them.
+   //
+   const double* row (const int j) const;
+
+   quint16 severity (const int j) const { return this->severities [j]; }
+   quint16 status (const int j) const { return this->statuses [j]; }
+   bool isDisplayable (const int j) const { return this->displayable [j]; }
+
+private:
+   int elements;
+   int rowsPerBlock;
+   bool isDefined;               // rows defined by the first non-empty element
+   QVector<qint64> times;
+   QVector<QVector<double> > blocks;   // rowsPerBlock x numberElements, row major
+   QVector<quint16> severities;  // per row - from the defining element
+   QVector<quint16> statuses;
+   QVector<bool> displayable;
+};
+
+#endif  // RAD_WAVEFORM_H